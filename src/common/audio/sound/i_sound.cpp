@@ -246,7 +246,7 @@ void I_InitSound ()
 {
 	FModule_SetProgDir(progdir);
 	/* Get command line options: */
-	nosound = !!Args->CheckParm ("-nosound");
+	if (Args->CheckParm ("-nosound")) nosound = true;	// may already be set by batch or benchmark mode
 	nosfx = !!Args->CheckParm ("-nosfx");
 
 	GSnd = NULL;
@@ -42,6 +42,8 @@
 #include <stdlib.h>
 #include <stdio.h>
 #include <errno.h>
+#include <thread>
+#include <vector>
 #include "c_console.h"
 #include "c_dispatch.h"
 #include "engineerrors.h"
@@ -52,6 +54,10 @@
 #include "version.h"
 #include "findfile.h"
 #include "md5.h"
+#include "name.h"
+#include "superfasthash.h"
+#include "stats.h"
+#include "templates.h"
 
 extern FILE* Logfile;
 
@@ -336,3 +342,191 @@ CCMD(printlocalized)
 	}
 
 }
+
+//==========================================================================
+//
+// CCMD bench_names [threads]
+//
+// Compares lookups and inserts of the name table against the single-
+// threaded hash chain table it replaced, on private copies filled with
+// the names that currently exist plus made-up ones. Then checks how both
+// scale over several threads and that concurrent inserts of the same
+// names agree on their indices.
+//
+//==========================================================================
+
+class FNameBenchmark
+{
+	// The name table as it was before it became thread-safe.
+	struct FLegacyTable
+	{
+		enum { HASH_SIZE = 1024, BLOCK_SIZE = 4096 };
+
+		struct FEntry
+		{
+			char *Text;
+			unsigned int Hash;
+			int NextHash;
+		};
+
+		TArray<FEntry> Entries;
+		TArray<char *> Blocks;
+		size_t NextAlloc = BLOCK_SIZE;
+		int Buckets[HASH_SIZE];
+
+		FLegacyTable()
+		{
+			memset(Buckets, -1, sizeof(Buckets));
+		}
+
+		~FLegacyTable()
+		{
+			for (auto block : Blocks) delete[] block;
+		}
+
+		int FindName(const char *text, size_t textLen, bool noCreate)
+		{
+			unsigned int hash = MakeKey(text, textLen);
+			unsigned int bucket = hash % HASH_SIZE;
+			for (int scanner = Buckets[bucket]; scanner >= 0; scanner = Entries[scanner].NextHash)
+			{
+				auto &entry = Entries[scanner];
+				if (entry.Hash == hash && strnicmp(entry.Text, text, textLen) == 0 && entry.Text[textLen] == '\0')
+				{
+					return scanner;
+				}
+			}
+			if (noCreate) return 0;
+
+			if (NextAlloc + textLen + 1 > BLOCK_SIZE)
+			{
+				Blocks.Push(new char[std::max<size_t>(BLOCK_SIZE, textLen + 1)]);
+				NextAlloc = 0;
+			}
+			char *textstore = Blocks.Last() + NextAlloc;
+			memcpy(textstore, text, textLen);
+			textstore[textLen] = '\0';
+			NextAlloc += textLen + 1;
+			Entries.Push({ textstore, hash, Buckets[bucket] });
+			return Buckets[bucket] = Entries.Size() - 1;
+		}
+	};
+
+	template<class Func>
+	static double RunThreads(int numthreads, Func func)
+	{
+		cycle_t timer;
+		timer.Reset();
+		timer.Clock();
+		std::vector<std::thread> threads;
+		for (int i = 0; i < numthreads; i++)
+		{
+			threads.push_back(std::thread([=]() { func(i); }));
+		}
+		for (auto &thread : threads) thread.join();
+		timer.Unclock();
+		return timer.TimeMS();
+	}
+
+public:
+	static void Run(int numthreads)
+	{
+		enum { PASSES = 10, NEW_NAMES = 100000 };
+
+		TArray<FString> keys;
+		for (int i = 0; i < FName::GetNumNames(); i++)
+		{
+			keys.Push(FName(ENamedName(i)).GetChars());
+		}
+		unsigned numexisting = keys.Size();
+		for (int i = 0; i < NEW_NAMES; i++)
+		{
+			keys.Push(FStringf("BenchName%d", i));
+		}
+		Printf("%u names, %u of them new\n", keys.Size(), keys.Size() - numexisting);
+
+		auto legacy = new FLegacyTable;
+		auto table = new FName::NameManager();
+		cycle_t oldtime, newtime;
+
+		oldtime.Reset();
+		oldtime.Clock();
+		for (auto &key : keys) legacy->FindName(key.GetChars(), key.Len(), false);
+		oldtime.Unclock();
+		newtime.Reset();
+		newtime.Clock();
+		for (auto &key : keys) table->FindName(key.GetChars(), key.Len(), false);
+		newtime.Unclock();
+		Printf("insert:            old %8.2f ms, new %8.2f ms\n", oldtime.TimeMS(), newtime.TimeMS());
+
+		int sum = 0;
+		oldtime.Reset();
+		oldtime.Clock();
+		for (int pass = 0; pass < PASSES; pass++)
+		{
+			for (auto &key : keys) sum += legacy->FindName(key.GetChars(), key.Len(), true);
+		}
+		oldtime.Unclock();
+		newtime.Reset();
+		newtime.Clock();
+		for (int pass = 0; pass < PASSES; pass++)
+		{
+			for (auto &key : keys) sum -= table->FindName(key.GetChars(), key.Len(), true);
+		}
+		newtime.Unclock();
+		double lookups = double(keys.Size()) * PASSES;
+		Printf("lookup:            old %8.2f ns, new %8.2f ns per name%s\n", oldtime.TimeMS() * 1e6 / lookups, newtime.TimeMS() * 1e6 / lookups,
+			sum != 0 ? " (index mismatch!)" : "");
+
+		// Reading the old table from several threads is fine as long as nothing gets added.
+		lookups *= numthreads;
+		double oldms = RunThreads(numthreads, [&keys, legacy](int)
+		{
+			for (int pass = 0; pass < PASSES; pass++)
+			{
+				for (auto &key : keys) legacy->FindName(key.GetChars(), key.Len(), true);
+			}
+		});
+		double newms = RunThreads(numthreads, [&keys, table](int)
+		{
+			for (int pass = 0; pass < PASSES; pass++)
+			{
+				for (auto &key : keys) table->FindName(key.GetChars(), key.Len(), true);
+			}
+		});
+		Printf("lookup, %2d threads: old %8.2f, new %8.2f million names/s\n", numthreads, lookups / (oldms * 1000), lookups / (newms * 1000));
+		delete legacy;
+		delete table;
+
+		// Every thread adds all names, starting at a different place, so that most
+		// inserts race with another thread adding the same name.
+		table = new FName::NameManager();
+		table->FindName("None", true);	// sets up the table before the threads race to do it
+		TArray<int> indices(keys.Size(), true);
+		newms = RunThreads(numthreads, [&keys, &indices, table, numthreads](int thread)
+		{
+			unsigned count = keys.Size();
+			unsigned start = count / numthreads * thread;
+			for (unsigned i = 0; i < count; i++)
+			{
+				unsigned k = (start + i) % count;
+				int index = table->FindName(keys[k].GetChars(), keys[k].Len(), false);
+				if (thread == 0) indices[k] = index;
+			}
+		});
+		int errors = 0;
+		for (unsigned i = 0; i < keys.Size(); i++)
+		{
+			if (table->FindName(keys[i].GetChars(), keys[i].Len(), true) != indices[i] || stricmp(table->GetEntry(indices[i]).Text, keys[i].GetChars()) != 0) errors++;
+		}
+		if (table->NumNames != int(keys.Size())) errors++;
+		Printf("insert, %2d threads: new %8.2f ms, %d errors\n", numthreads, newms, errors);
+		delete table;
+	}
+};
+
+CCMD(bench_names)
+{
+	int numthreads = argv.argc() > 1 ? atoi(argv[1]) : std::thread::hardware_concurrency();
+	FNameBenchmark::Run(clamp(numthreads, 1, 64));
+}
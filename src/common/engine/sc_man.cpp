@@ -37,6 +37,7 @@
 
 #include <string.h>
 #include <stdlib.h>
+#include <string>
 #include "engineerrors.h"
 #include "sc_man.h"
 #include "cmdlib.h"
@@ -281,6 +282,7 @@ void FScanner::OpenString (const char *name, FString buffer)
 void FScanner :: OpenLumpNum (int lump)
 {
 	Close ();
+	if (!TakePrescannedScript(lump, ScriptBuffer, Prescanned))
 	{
 		FileData mem = fileSystem.ReadFile(lump);
 		ScriptBuffer = mem.GetString();
@@ -300,22 +302,7 @@ void FScanner :: OpenLumpNum (int lump)
 
 void FScanner::PrepareScript ()
 {
-	// The scanner requires the file to end with a '\n', so add one if
-	// it doesn't already.
-	if (ScriptBuffer.Len() == 0 || ScriptBuffer.Back() != '\n')
-	{
-		// If the last character in the buffer is a null character, change
-		// it to a newline. Otherwise, append a newline to the end.
-		if (ScriptBuffer.Len() > 0 && ScriptBuffer.Back() == '\0')
-		{
-			ScriptBuffer.LockBuffer()[ScriptBuffer.Len() - 1] = '\n';
-			ScriptBuffer.UnlockBuffer();
-		}
-		else
-		{
-			ScriptBuffer += '\n';
-		}
-	}
+	TerminateScript(ScriptBuffer);
 
 	ScriptPtr = &ScriptBuffer[0];
 	ScriptEndPtr = &ScriptBuffer[ScriptBuffer.Len()];
@@ -348,6 +335,10 @@ void FScanner::Close ()
 	BigStringBuffer = "";
 	StringBuffer[0] = '\0';
 	String = StringBuffer;
+	Prescanned[0].Tokens.Reset();
+	Prescanned[0].Strings.Reset();
+	Prescanned[1].Tokens.Reset();
+	Prescanned[1].Strings.Reset();
 }
 
 //==========================================================================
@@ -400,6 +391,347 @@ void FScanner::RestorePos (const FScanner::SavedPos &pos)
 	Crossed = false;
 }
 
+//==========================================================================
+//
+// FScanner :: TerminateScript
+//
+// The scanner requires the file to end with a '\n', so add one if
+// it doesn't already.
+//
+//==========================================================================
+
+void FScanner::TerminateScript(FString &buffer)
+{
+	if (buffer.Len() == 0 || buffer.Back() != '\n')
+	{
+		// If the last character in the buffer is a null character, change
+		// it to a newline. Otherwise, append a newline to the end.
+		if (buffer.Len() > 0 && buffer.Back() == '\0')
+		{
+			buffer.LockBuffer()[buffer.Len() - 1] = '\n';
+			buffer.UnlockBuffer();
+		}
+		else
+		{
+			buffer += '\n';
+		}
+	}
+}
+
+//==========================================================================
+//
+// ParseTokenValue
+//
+// Sets Number, BigNumber and Float for a token that was just scanned.
+// Shared by FScanner and FScanAheadLexer.
+//
+//==========================================================================
+
+template<class Scanner> static void ParseTokenValue(Scanner &sc)
+{
+	if (sc.TokenType == TK_IntConst)
+	{
+		char *stopper;
+		// Check for unsigned
+		if (sc.String[sc.StringLen - 1] == 'u' || sc.String[sc.StringLen - 1] == 'U' ||
+			sc.String[sc.StringLen - 2] == 'u' || sc.String[sc.StringLen - 2] == 'U')
+		{
+			sc.TokenType = TK_UIntConst;
+			sc.BigNumber = (int64_t)strtoull(sc.String, &stopper, 0);
+			sc.Number = (int)sc.BigNumber;// clamp<int64_t>(BigNumber, 0, UINT_MAX);
+			sc.Float = (unsigned)sc.Number;
+		}
+		else
+		{
+			sc.BigNumber = strtoll(sc.String, &stopper, 0);
+			sc.Number = (int)sc.BigNumber;// clamp<int64_t>(BigNumber, 0, UINT_MAX);
+			sc.Float = sc.Number;
+		}
+	}
+	else if (sc.TokenType == TK_FloatConst)
+	{
+		char *stopper;
+		sc.Float = strtod(sc.String, &stopper);
+	}
+	else if (sc.TokenType == TK_StringConst)
+	{
+		sc.StringLen = strbin(sc.String);
+	}
+}
+
+//==========================================================================
+//
+// FScanAheadLexer
+//
+// Runs the generated scanner for ScanAhead. FScanner cannot be used on
+// a worker thread because creating and destroying FStrings there races
+// on the reference count that all empty strings share, so this keeps
+// its state in plain buffers and only reads the script text.
+//
+//==========================================================================
+
+struct FScanAheadError
+{
+};
+
+class FScanAheadLexer
+{
+public:
+	FScanAheadLexer(const char *script, int length, bool cmode, bool escape, VersionInfo version)
+	{
+		ScriptPtr = script;
+		ScriptEndPtr = script + length;
+		CMode = cmode;
+		Escape = escape;
+		ParseVersion = version;
+		String = StringBuffer;
+		StringBuffer[0] = '\0';
+	}
+
+	bool GetString()
+	{
+		return ScanString(false);
+	}
+
+	bool GetToken()
+	{
+		if (ScanString(true))
+		{
+			ParseTokenValue(*this);
+			return true;
+		}
+		return false;
+	}
+
+	// Errors are left to the scanner that does the actual parsing.
+	void ScriptError(const char *message, ...)
+	{
+		throw FScanAheadError();
+	}
+
+	char *String;
+	int StringLen = 0;
+	int TokenType = 0;
+	int Number = 0;
+	int64_t BigNumber = 0;
+	double Float = 0;
+	int Line = 1;
+	bool Crossed = false;
+	const char *ScriptPtr;
+
+private:
+	// Must match FScanner::MAX_STRING_SIZE.
+	static const int MAX_STRING_SIZE = 128;
+
+	const char *ScriptEndPtr;
+	char StringBuffer[MAX_STRING_SIZE];
+	std::string BigStringBuffer;
+	bool CMode;
+	uint8_t StateMode = 0;
+	bool StateOptions = false;
+	bool Escape;
+	VersionInfo ParseVersion;
+
+	void SetBigString(const char *text, int len) { BigStringBuffer.assign(text, len); }
+	void ClearBigString() { BigStringBuffer.clear(); }
+	void AppendBigString(const char *text, int len) { BigStringBuffer.append(text, len); }
+	int BigStringLen() const { return int(BigStringBuffer.size()); }
+	char *LockBigString() { return &BigStringBuffer[0]; }
+
+	bool ScanString(bool tokens)
+	{
+		const char *marker, *tok;
+		bool return_val;
+
+		Crossed = false;
+		if (ScriptPtr >= ScriptEndPtr)
+		{
+			return false;
+		}
+
+		// In case the generated scanner does not use marker, avoid compiler warnings.
+		marker;
+#include "sc_man_scanner.h"
+		return return_val;
+	}
+};
+
+//==========================================================================
+//
+// FScanner :: ScanAhead
+//
+// Tokenizes the entire script with FScanAheadLexer, so this can run on
+// a worker thread while the scanner itself is idle.
+// State mode is controlled by the parser so it cannot be predicted here,
+// which is why ReplayToken only uses these tokens outside of it. Errors
+// are not reported: the scan simply stops there and the scanner that
+// does the actual parsing will run into the same error on its own.
+//
+// With strings set this records GetString results instead, which
+// ScanString replays when the scanner is in the same C mode.
+//
+//==========================================================================
+
+void FScanner::ScanAhead(FScannedScript &out, bool strings) const
+{
+	ScanAhead(ScriptBuffer.GetChars(), (int)ScriptBuffer.Len(), CMode, Escape, ParseVersion, out, strings);
+}
+
+//==========================================================================
+//
+// FScanner :: ScanAhead (static)
+//
+// The same for a script that is not open in a scanner. The text must
+// have been passed through TerminateScript and must stay unchanged
+// while this runs. Nothing here touches an FString, so it is safe to
+// call from any thread.
+//
+//==========================================================================
+
+void FScanner::ScanAhead(const char *script, int length, bool cmode, bool escape, VersionInfo version, FScannedScript &out, bool strings)
+{
+	FScanAheadLexer sc(script, length, cmode, escape, version);
+
+	out.Tokens.Clear();
+	out.Strings.Clear();
+	out.Next = 0;
+
+	try
+	{
+		const char *base = script;
+		while (true)
+		{
+			FScannedToken token;
+			token.Start = int(sc.ScriptPtr - base);
+			token.StartLine = sc.Line;
+			// String scans only set the token type for some characters. -1 tells the replay to leave it alone.
+			if (strings) sc.TokenType = -1;
+			if (!(strings ? sc.GetString() : sc.GetToken())) break;
+			token.End = int(sc.ScriptPtr - base);
+			token.Line = sc.Line;
+			token.TokenType = sc.TokenType;
+			token.StringStart = out.Strings.Size();
+			token.StringLen = sc.StringLen;
+			token.Number = sc.Number;
+			token.BigNumber = sc.BigNumber;
+			token.Float = sc.Float;
+			token.Crossed = sc.Crossed;
+			out.Strings.Resize(token.StringStart + sc.StringLen);
+			memcpy(out.Strings.Data() + token.StringStart, sc.String, sc.StringLen);
+			out.Tokens.Push(token);
+		}
+	}
+	catch (FScanAheadError &)
+	{
+	}
+}
+
+//==========================================================================
+//
+// FScanner :: FindScanned
+//
+// Returns the scanned token that starts at the current position, if any.
+//
+//==========================================================================
+
+const FScannedToken *FScanner::FindScanned(FScannedScript &in) const
+{
+	const char *base = ScriptBuffer.GetChars();
+	int pos = int(ScriptPtr - base);
+	auto &tokens = in.Tokens;
+	while (in.Next < tokens.Size() && tokens[in.Next].Start < pos)
+	{
+		in.Next++;
+	}
+	if (in.Next >= tokens.Size() || tokens[in.Next].Start != pos || tokens[in.Next].StartLine != Line)
+	{
+		return nullptr;
+	}
+	return &tokens[in.Next++];
+}
+
+//==========================================================================
+//
+// FScanner :: ApplyScanned
+//
+// Moves past a scanned token and sets the string as the scanner would.
+//
+//==========================================================================
+
+void FScanner::ApplyScanned(const FScannedScript &in, const FScannedToken &token)
+{
+	LastGotPtr = ScriptPtr;
+	LastGotLine = Line;
+	ScriptPtr = ScriptBuffer.GetChars() + token.End;
+	Line = token.Line;
+	Crossed = token.Crossed;
+	End = false;
+	StringLen = token.StringLen;
+	if (StringLen < MAX_STRING_SIZE)
+	{
+		memcpy(StringBuffer, in.Strings.Data() + token.StringStart, StringLen);
+		StringBuffer[StringLen] = '\0';
+		String = StringBuffer;
+	}
+	else
+	{
+		SetBigString(in.Strings.Data() + token.StringStart, StringLen);
+		String = LockBigString();
+	}
+}
+
+//==========================================================================
+//
+// FScanner :: ReplayToken
+//
+// Gets the next token from a ScanAhead result if that is possible at
+// the current position. If it returns false, GetToken must be used.
+//
+//==========================================================================
+
+bool FScanner::ReplayToken(FScannedScript &in)
+{
+	CheckOpen();
+	if (AlreadyGot || StateMode != 0 || StateOptions)
+	{
+		return false;
+	}
+
+	auto token = FindScanned(in);
+	if (token == nullptr)
+	{
+		return false;
+	}
+	ApplyScanned(in, *token);
+	LastGotToken = true;
+	TokenType = token->TokenType;
+	Number = token->Number;
+	BigNumber = token->BigNumber;
+	Float = token->Float;
+	return true;
+}
+
+//==========================================================================
+//
+// FScanner :: ReplayString
+//
+// The GetString counterpart of ReplayToken, called by ScanString.
+//
+//==========================================================================
+
+bool FScanner::ReplayString(FScannedScript &in)
+{
+	auto token = FindScanned(in);
+	if (token == nullptr)
+	{
+		return false;
+	}
+	ApplyScanned(in, *token);
+	LastGotToken = false;
+	if (token->TokenType != -1) TokenType = token->TokenType;
+	return true;
+}
+
 //==========================================================================
 //
 // FScanner :: isText
@@ -510,6 +842,12 @@ bool FScanner::ScanString (bool tokens)
 		return false;
 	}
 
+	// The prescan used the default escape handling.
+	if (!tokens && Escape && Prescanned[CMode].Tokens.Size() > 0 && ReplayString(Prescanned[CMode]))
+	{
+		return true;
+	}
+
 	LastGotPtr = ScriptPtr;
 	LastGotLine = Line;
 
@@ -594,34 +932,7 @@ bool FScanner::GetToken ()
 {
 	if (ScanString (true))
 	{
-		if (TokenType == TK_IntConst)
-		{
-			char *stopper;
-			// Check for unsigned
-			if (String[StringLen - 1] == 'u' || String[StringLen - 1] == 'U' ||
-				String[StringLen - 2] == 'u' || String[StringLen - 2] == 'U')
-			{
-				TokenType = TK_UIntConst;
-				BigNumber = (int64_t)strtoull(String, &stopper, 0);
-				Number = (int)BigNumber;// clamp<int64_t>(BigNumber, 0, UINT_MAX);
-				Float = (unsigned)Number;
-			}
-			else
-			{
-				BigNumber = strtoll(String, &stopper, 0);
-				Number = (int)BigNumber;// clamp<int64_t>(BigNumber, 0, UINT_MAX);
-				Float = Number;
-			}
-		}
-		else if (TokenType == TK_FloatConst)
-		{
-			char *stopper;
-			Float = strtod(String, &stopper);
-		}
-		else if (TokenType == TK_StringConst)
-		{
-			StringLen = strbin(String);
-		}
+		ParseTokenValue(*this);
 		return true;
 	}
 	return false;
@@ -37,6 +37,26 @@ inline VersionInfo MakeVersion(unsigned int ma, unsigned int mi, unsigned int re
 }
 
 
+// Tokens of a script that got scanned in advance, see FScanner::ScanAhead.
+struct FScannedToken
+{
+	int Start, End;			// offsets into the script buffer
+	int StartLine, Line;
+	int TokenType;
+	int StringStart, StringLen;
+	int Number;
+	int64_t BigNumber;
+	double Float;
+	bool Crossed;
+};
+
+struct FScannedScript
+{
+	TArray<FScannedToken> Tokens;
+	TArray<char> Strings;
+	unsigned Next = 0;
+};
+
 class FScanner
 {
 public:
@@ -75,6 +95,10 @@ public:
 	void DisableStateOptions();
 	const SavedPos SavePos();
 	void RestorePos(const SavedPos &pos);
+	void ScanAhead(FScannedScript &out, bool strings = false) const;
+	static void ScanAhead(const char *script, int length, bool cmode, bool escape, VersionInfo version, FScannedScript &out, bool strings = false);
+	static void TerminateScript(FString &buffer);
+	bool ReplayToken(FScannedScript &in);
 
 	static FString TokenName(int token, const char *string=NULL);
 
@@ -133,6 +157,16 @@ protected:
 	void PrepareScript();
 	void CheckOpen();
 	bool ScanString(bool tokens);
+	const FScannedToken *FindScanned(FScannedScript &in) const;
+	void ApplyScanned(const FScannedScript &in, const FScannedToken &token);
+	bool ReplayString(FScannedScript &in);
+
+	// The generated scanner goes through these, see FScanAheadLexer.
+	void SetBigString(const char *text, int len) { BigStringBuffer = FString(text, len); }
+	void ClearBigString() { BigStringBuffer = ""; }
+	void AppendBigString(const char *text, int len) { BigStringBuffer.AppendCStrPart(text, len); }
+	int BigStringLen() const { return int(BigStringBuffer.Len()); }
+	char *LockBigString() { return BigStringBuffer.LockBuffer(); }
 
 	// Strings longer than this minus one will be dynamically allocated.
 	static const int MAX_STRING_SIZE = 128;
@@ -153,6 +187,7 @@ protected:
 	bool StateOptions;
 	bool Escape;
 	VersionInfo ParseVersion = { 0, 0, 0 };	// no ZScript extensions by default
+	FScannedScript Prescanned[2];	// GetString results without and with C mode, see sc_prescan.cpp
 
 
 	bool ScanValue(bool allowfloat);
@@ -223,5 +258,11 @@ struct FScriptPosition
 
 int ParseHex(const char* hex, FScriptPosition* sc);
 
+// sc_prescan.cpp
+void PrescanScripts(const TArray<int> &lumps);
+void PrescanScripts(const char **names);
+bool TakePrescannedScript(int lump, FString &text, FScannedScript *scanned);
+void ClearPrescannedScripts();
+
 
 #endif //__SC_MAN_H__
@@ -0,0 +1,250 @@
+//-----------------------------------------------------------------------------
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see http://www.gnu.org/licenses/
+//
+//-----------------------------------------------------------------------------
+//
+// DESCRIPTION:
+//		Tokenizes definition lumps on worker threads ahead of parsing.
+//
+//		The lumps are read on the calling thread because the file system
+//		is not thread-safe. The workers record the GetString results for
+//		both C modes with the static FScanner::ScanAhead, since the parsers
+//		switch modes as they go. The workers must not create or destroy
+//		any FString, so all of them are owned by the calling thread and
+//		the workers only read the text of their job. FScanner::OpenLumpNum takes over a lump's text
+//		together with the finished scans, waits for a lump that is being
+//		scanned and scans a still queued lump itself. The parsers keep
+//		running one after another in their usual order, so only the
+//		lexing overlaps with the rest of the startup.
+//
+//-----------------------------------------------------------------------------
+
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <vector>
+
+#include "sc_man.h"
+#include "filesystem.h"
+#include "templates.h"
+
+class FScriptPrescanner
+{
+	enum
+	{
+		MAX_PENDING_BYTES = 64 << 20
+	};
+
+	struct FJob
+	{
+		FString Text;
+		FScannedScript Scanned[2];
+		bool Started;
+		bool Done;
+	};
+
+	std::mutex Mutex;
+	std::condition_variable WorkAvailable;
+	std::condition_variable WorkDone;
+	std::vector<std::thread> Threads;
+	TMap<int, FJob *> Jobs;
+	TArray<FJob *> Queue;
+	unsigned QueueHead = 0;
+	size_t PendingBytes = 0;
+	bool StopWorkers = false;
+
+	void StartThreads()
+	{
+		int numthreads = clamp<int>(std::thread::hardware_concurrency() - 1, 1, 4);
+		for (int i = 0; i < numthreads; i++)
+		{
+			Threads.push_back(std::thread([=]() { WorkerMain(); }));
+		}
+	}
+
+	void WorkerMain()
+	{
+		std::unique_lock<std::mutex> lock(Mutex);
+		while (true)
+		{
+			WorkAvailable.wait(lock, [&]() { return StopWorkers || QueueHead < Queue.Size(); });
+			if (StopWorkers) break;
+
+			FJob *job = Queue[QueueHead++];
+			if (QueueHead == Queue.Size())
+			{
+				Queue.Clear();
+				QueueHead = 0;
+			}
+			if (job == nullptr) continue;	// taken over before a worker got to it.
+			job->Started = true;
+			lock.unlock();
+
+			// Same settings as a freshly opened scanner.
+			for (int cmode = 0; cmode < 2; cmode++)
+			{
+				FScanner::ScanAhead(job->Text.GetChars(), (int)job->Text.Len(), !!cmode, true, { 0, 0, 0 }, job->Scanned[cmode], true);
+			}
+
+			lock.lock();
+			job->Done = true;
+			WorkDone.notify_all();
+		}
+	}
+
+	// Removes a job. Must be called with the mutex held and the job not running.
+	void Remove(int lump, FJob *job)
+	{
+		for (unsigned i = QueueHead; i < Queue.Size(); i++)
+		{
+			if (Queue[i] == job) Queue[i] = nullptr;
+		}
+		Jobs.Remove(lump);
+		PendingBytes -= job->Text.Len();
+		delete job;
+	}
+
+public:
+	~FScriptPrescanner()
+	{
+		{
+			std::lock_guard<std::mutex> lock(Mutex);
+			StopWorkers = true;
+		}
+		WorkAvailable.notify_all();
+		for (auto &thread : Threads) thread.join();
+
+		decltype(Jobs)::Iterator it(Jobs);
+		decltype(Jobs)::Pair *pair;
+		while (it.NextPair(pair))
+		{
+			delete pair->Value;
+		}
+	}
+
+	void Add(int lump)
+	{
+		std::unique_lock<std::mutex> lock(Mutex);
+		if (Jobs.CheckKey(lump) != nullptr || PendingBytes >= MAX_PENDING_BYTES) return;
+		lock.unlock();
+
+		auto job = new FJob;
+		job->Text = fileSystem.ReadFile(lump).GetString();
+		FScanner::TerminateScript(job->Text);
+		job->Started = job->Done = false;
+
+		lock.lock();
+		if (Threads.empty()) StartThreads();
+		PendingBytes += job->Text.Len();
+		Jobs[lump] = job;
+		Queue.Push(job);
+		WorkAvailable.notify_one();
+	}
+
+	bool Take(int lump, FString &text, FScannedScript *scanned)
+	{
+		std::unique_lock<std::mutex> lock(Mutex);
+		auto pjob = Jobs.CheckKey(lump);
+		if (pjob == nullptr) return false;
+		FJob *job = *pjob;
+
+		if (job->Started)
+		{
+			WorkDone.wait(lock, [=]() { return job->Done; });
+		}
+		text = job->Text;
+		for (int i = 0; i < 2; i++)
+		{
+			scanned[i] = std::move(job->Scanned[i]);
+		}
+		Remove(lump, job);
+		return true;
+	}
+
+	void Clear()
+	{
+		std::unique_lock<std::mutex> lock(Mutex);
+		TArray<int> lumps;
+		decltype(Jobs)::Iterator it(Jobs);
+		decltype(Jobs)::Pair *pair;
+		while (it.NextPair(pair))
+		{
+			lumps.Push(pair->Key);
+		}
+		for (auto lump : lumps)
+		{
+			FJob *job = Jobs[lump];
+			if (job->Started)
+			{
+				WorkDone.wait(lock, [=]() { return job->Done; });
+			}
+			Remove(lump, job);
+		}
+	}
+};
+
+static FScriptPrescanner ScriptPrescanner;
+
+//==========================================================================
+//
+// Reads the given lumps and queues them for tokenizing.
+//
+//==========================================================================
+
+void PrescanScripts(const TArray<int> &lumps)
+{
+	for (auto lump : lumps)
+	{
+		ScriptPrescanner.Add(lump);
+	}
+}
+
+void PrescanScripts(const char **names)
+{
+	TArray<int> lumps;
+	for (int i = 0; names[i] != nullptr; i++)
+	{
+		int lump, lastlump = 0;
+		while ((lump = fileSystem.FindLump(names[i], &lastlump)) != -1)
+		{
+			lumps.Push(lump);
+		}
+	}
+	PrescanScripts(lumps);
+}
+
+//==========================================================================
+//
+// Hands a queued lump's text and scan results to FScanner::OpenLumpNum.
+// The results are empty if no worker got to the lump yet.
+//
+//==========================================================================
+
+bool TakePrescannedScript(int lump, FString &text, FScannedScript *scanned)
+{
+	return ScriptPrescanner.Take(lump, text, scanned);
+}
+
+//==========================================================================
+//
+// Drops all lumps that were not taken. Must be called before the lump
+// numbers change.
+//
+//==========================================================================
+
+void ClearPrescannedScripts()
+{
+	ScriptPrescanner.Clear();
+}
@@ -34,6 +34,7 @@
 */
 
 #include <time.h>
+#include <memory>
 #include "file_zip.h"
 #include "cmdlib.h"
 #include "templates.h"
@@ -41,6 +42,8 @@
 #include "w_zip.h"
 
 #include "ancientzip.h"
+#include "md5.h"
+#include "i_specialpaths.h"
 
 #define BUFREADCOMMENT (0x400)
 
@@ -172,6 +175,8 @@ FZipFile::FZipFile(const char * filename, FileReader &file)
 
 bool FZipFile::Open(bool quiet, LumpFilterInfo* filter)
 {
+	if (LoadIndex(filter)) return true;
+
 	uint32_t centraldir = Zip_FindCentralDir(Reader);
 	FZipEndOfCentralDirectory info;
 	int skipped = 0;
@@ -339,9 +344,213 @@ bool FZipFile::Open(bool quiet, LumpFilterInfo* filter)
 
 	GenerateHash();
 	PostProcessArchive(&Lumps[0], sizeof(FZipLump), filter);
+	SaveIndex(filter);
+	return true;
+}
+
+//==========================================================================
+//
+// Directory index cache
+//
+// Large zips get their final lump table, i.e. after sorting and filtering,
+// written to the cache directory so that the next start can skip reading
+// and parsing the central directory. An index is only used if the zip's
+// size and modification time and the lump filter are the same as when it
+// was written. Zips inside other archives have no file of their own and
+// are not cached.
+//
+//==========================================================================
+
+enum
+{
+	MIN_INDEXED_LUMPS = 1000
+};
+
+static const char IndexMagic[4] = { 'Z', 'I', 'D', 'X' };
+static const uint32_t IndexVersion = 1;
+
+struct FZipIndexHeader
+{
+	char Magic[4];
+	uint32_t Version;
+	uint64_t FileSize;
+	int64_t FileTime;
+	uint8_t Key[16];
+	uint8_t Digest[16];
+	uint32_t NumLumps;
+	uint32_t BodySize;
+};
+
+struct FZipIndexEntry
+{
+	uint32_t LumpSize;
+	uint32_t CompressedSize;
+	uint32_t Position;
+	uint32_t CRC32;
+	uint16_t GPFlags;
+	uint8_t Method;
+	uint8_t Flags;
+	uint32_t NameLength;
+};
+
+FString FZipFile::IndexName(LumpFilterInfo *filter, uint8_t *key)
+{
+	// The filter affects which lumps are kept and how they are named.
+	MD5Context md5;
+	auto add = [&](const FString &str) { md5.Update((const uint8_t *)str.GetChars(), (unsigned)str.Len() + 1); };
+	add(FileName);
+	if (filter != nullptr)
+	{
+		for (auto &str : filter->gameTypeFilter) add(str);
+		add("|");
+		add(filter->dotFilter);
+		add("|");
+		for (auto &str : filter->reservedFolders) add(str);
+		add("|");
+		for (auto &str : filter->requiredPrefixes) add(str);
+	}
+	md5.Final(key);
+
+	uint8_t namedigest[16];
+	MD5Context md5name;
+	md5name.Update((const uint8_t *)FileName.GetChars(), (unsigned)FileName.Len());
+	md5name.Final(namedigest);
+
+	FString path = M_GetCachePath(false);
+	path << "/archives/";
+	for (auto c : namedigest) path.AppendFormat("%02x", c);
+	path << ".zidx";
+	return path;
+}
+
+bool FZipFile::LoadIndex(LumpFilterInfo *filter)
+{
+	size_t size;
+	time_t mtime;
+	if (!GetFileInfo(FileName, &size, &mtime) || size != (size_t)Reader.GetLength()) return false;
+
+	uint8_t key[16];
+	FileReader fr;
+	if (!fr.OpenFile(IndexName(filter, key))) return false;
+
+	FZipIndexHeader header;
+	if (fr.Read(&header, sizeof(header)) != sizeof(header) ||
+		memcmp(header.Magic, IndexMagic, 4) != 0 || header.Version != IndexVersion ||
+		header.FileSize != size || header.FileTime != (int64_t)mtime || memcmp(header.Key, key, 16) != 0 ||
+		header.BodySize != fr.GetLength() - sizeof(header))
+	{
+		return false;
+	}
+
+	TArray<uint8_t> body = fr.Read(header.BodySize);
+	if (body.Size() != header.BodySize) return false;
+
+	uint8_t digest[16];
+	MD5Context md5;
+	md5.Update(body.Data(), body.Size());
+	md5.Final(digest);
+	if (memcmp(digest, header.Digest, 16) != 0) return false;
+
+	const uint8_t *pos = body.Data();
+	const uint8_t *end = pos + body.Size();
+	auto readstring = [&](uint32_t len, FString &str)
+	{
+		if (len > size_t(end - pos)) return false;
+		str = FString((const char *)pos, len);
+		pos += len;
+		return true;
+	};
+
+	uint32_t hashlen;
+	if (size_t(end - pos) < sizeof(hashlen)) return false;
+	memcpy(&hashlen, pos, sizeof(hashlen));
+	pos += sizeof(hashlen);
+	FString hash;
+	if (!readstring(hashlen, hash)) return false;
+
+	auto lumps = new FZipLump[header.NumLumps];
+	for (uint32_t i = 0; i < header.NumLumps; i++)
+	{
+		FZipIndexEntry entry;
+		FString name;
+		if (size_t(end - pos) < sizeof(entry))
+		{
+			delete[] lumps;
+			return false;
+		}
+		memcpy(&entry, pos, sizeof(entry));
+		pos += sizeof(entry);
+		if (!readstring(entry.NameLength, name))
+		{
+			delete[] lumps;
+			return false;
+		}
+
+		auto lump_p = &lumps[i];
+		lump_p->LumpNameSetup(name);
+		lump_p->LumpSize = entry.LumpSize;
+		lump_p->Owner = this;
+		lump_p->Flags = entry.Flags;
+		lump_p->NeedFileStart = true;
+		lump_p->Method = entry.Method;
+		lump_p->GPFlags = entry.GPFlags;
+		lump_p->CRC32 = entry.CRC32;
+		lump_p->CompressedSize = entry.CompressedSize;
+		lump_p->Position = entry.Position;
+	}
+
+	Lumps = lumps;
+	NumLumps = header.NumLumps;
+	Hash = hash;
 	return true;
 }
 
+void FZipFile::SaveIndex(LumpFilterInfo *filter)
+{
+	size_t size;
+	time_t mtime;
+	if (NumLumps < MIN_INDEXED_LUMPS || !GetFileInfo(FileName, &size, &mtime) || size != (size_t)Reader.GetLength()) return;
+
+	TArray<uint8_t> body;
+	auto write = [&](const void *data, size_t len)
+	{
+		unsigned p = body.Reserve((unsigned)len);
+		if (len > 0) memcpy(&body[p], data, len);
+	};
+
+	uint32_t hashlen = (uint32_t)Hash.Len();
+	write(&hashlen, sizeof(hashlen));
+	write(Hash.GetChars(), hashlen);
+	for (uint32_t i = 0; i < NumLumps; i++)
+	{
+		auto &lump = Lumps[i];
+		const char *name = lump.getName();
+		FZipIndexEntry entry = { (uint32_t)lump.LumpSize, (uint32_t)lump.CompressedSize, (uint32_t)lump.Position, lump.CRC32, lump.GPFlags, lump.Method, lump.Flags, (uint32_t)strlen(name) };
+		write(&entry, sizeof(entry));
+		write(name, entry.NameLength);
+	}
+
+	FZipIndexHeader header;
+	memcpy(header.Magic, IndexMagic, 4);
+	header.Version = IndexVersion;
+	header.FileSize = size;
+	header.FileTime = (int64_t)mtime;
+	FString indexname = IndexName(filter, header.Key);
+	MD5Context md5;
+	md5.Update(body.Data(), body.Size());
+	md5.Final(header.Digest);
+	header.NumLumps = NumLumps;
+	header.BodySize = body.Size();
+
+	CreatePath(M_GetCachePath(true) + "/archives");
+	std::unique_ptr<FileWriter> fw(FileWriter::Open(indexname));
+	if (fw)
+	{
+		fw->Write(&header, sizeof(header));
+		fw->Write(body.Data(), body.Size());
+	}
+}
+
 //==========================================================================
 //
 // Zip file
@@ -419,7 +628,7 @@ int FZipLump::FillCache()
 	if (NeedFileStart) SetLumpAddress();
 	const char *buffer;
 
-	if (Method == METHOD_STORED && (buffer = Owner->Reader.GetBuffer()) != NULL)
+	if (Method == METHOD_STORED && (buffer = Owner->Reader.GetBuffer()) != NULL && Position + LumpSize <= Owner->Reader.GetLength())
 	{
 		// This is an in-memory file so the cache can point directly to the file's data.
 		Cache = const_cast<char*>(buffer) + Position;
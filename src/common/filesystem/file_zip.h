@@ -20,6 +20,7 @@ struct FZipLump : public FResourceLump
 
 	virtual FileReader *GetReader();
 	virtual int FillCache();
+	int GetCompressionMethod() const override { return Method; }
 
 private:
 	void SetLumpAddress();
@@ -38,6 +39,10 @@ class FZipFile : public FResourceFile
 {
 	FZipLump *Lumps;
 
+	FString IndexName(LumpFilterInfo *filter, uint8_t *key);
+	bool LoadIndex(LumpFilterInfo *filter);
+	void SaveIndex(LumpFilterInfo *filter);
+
 public:
 	FZipFile(const char * filename, FileReader &file);
 	virtual ~FZipFile();
@@ -301,7 +301,11 @@ void FileSystem::AddFile (const char *filename, FileReader *filer, bool quiet, L
 
 		if (!isdir)
 		{
-			if (!filereader.OpenFile(filename))
+			// Archives get mapped into memory if possible so that uncompressed lumps can be
+			// used in place and the pages get shared by every process that loads the same file.
+			static const bool nommap = Args->CheckParm("-nommap") > 0;
+			bool mapped = !nommap && filereader.OpenMappedFile(filename);
+			if (!mapped && !filereader.OpenFile(filename))
 			{ // Didn't find file
 				if (!quiet)
 				{
@@ -860,16 +864,17 @@ void FileSystem::InitHashChains (void)
 		// Do the same for the full paths
 		if (FileInfo[i].longName.IsNotEmpty())
 		{
-			j = MakeKey(FileInfo[i].longName) % NumEntries;
+			auto &longName = FileInfo[i].longName;
+			j = MakeKey(longName.GetChars(), longName.Len()) % NumEntries;
 			NextLumpIndex_FullName[i] = FirstLumpIndex_FullName[j];
 			FirstLumpIndex_FullName[j] = i;
 
-			FString nameNoExt = FileInfo[i].longName;
-			auto dot = nameNoExt.LastIndexOf('.');
-			auto slash = nameNoExt.LastIndexOf('/');
-			if (dot > slash) nameNoExt.Truncate(dot);
+			// Hash the name without extension in place instead of creating a truncated copy.
+			auto dot = longName.LastIndexOf('.');
+			auto slash = longName.LastIndexOf('/');
+			size_t noextlen = dot > slash ? dot : longName.Len();
 
-			j = MakeKey(nameNoExt) % NumEntries;
+			j = MakeKey(longName.GetChars(), noextlen) % NumEntries;
 			NextLumpIndex_NoExt[i] = FirstLumpIndex_NoExt[j];
 			FirstLumpIndex_NoExt[j] = i;
 
@@ -1368,6 +1373,7 @@ FileReader FileSystem::OpenFileReader(int lump)
 	{
 		FileReader rdr;
 		rdr.OpenFilePart(*rd, rl->GetFileOffset(), rl->LumpSize);
+		CountLumpBytesRead(rl->LumpSize);
 		return rdr;
 	}
 	return rl->NewReader();	// This always gets a reader to the cache
@@ -1390,6 +1396,7 @@ FileReader FileSystem::ReopenFileReader(int lump, bool alwayscache)
 		FileReader fr;
 		if (fr.OpenFile(filename, rl->GetFileOffset(), rl->LumpSize))
 		{
+			CountLumpBytesRead(rl->LumpSize);
 			return fr;
 		}
 	}
@@ -1403,6 +1410,49 @@ FileReader FileSystem::OpenFileReader(const char* name)
 	else return OpenFileReader(lump);
 }
 
+//==========================================================================
+//
+// PrefetchFiles
+//
+// Queues lumps for decompression on worker threads so that inflating them
+// overlaps with whatever the caller does until it reads them. Reading a
+// lump that is still being decompressed waits for it. Lumps which are
+// not compressed or already cached are ignored.
+//
+//==========================================================================
+
+void FileSystem::PrefetchFiles(const TArray<int> &lumps)
+{
+	TArray<FResourceLump *> list(lumps.Size());
+	for (auto lump : lumps)
+	{
+		if ((unsigned)lump < (unsigned)FileInfo.Size() && (FileInfo[lump].lump->Flags & LUMPF_COMPRESSED))
+		{
+			list.Push(FileInfo[lump].lump);
+		}
+	}
+	if (list.Size() > 0) PrefetchLumps(list.Data(), list.Size());
+}
+
+void FileSystem::PrefetchFiles(const char **names)
+{
+	TArray<int> lumps;
+	for (int i = 0; names[i] != nullptr; i++)
+	{
+		int lump, lastlump = 0;
+		while ((lump = FindLump(names[i], &lastlump)) != -1)
+		{
+			lumps.Push(lump);
+		}
+	}
+	PrefetchFiles(lumps);
+}
+
+void FileSystem::ClearPrefetched()
+{
+	ClearPrefetchedLumps();
+}
+
 //==========================================================================
 //
 // GetFileReader
@@ -1673,7 +1723,7 @@ const void *FileSystem::Get(int lump)
 	if ((size_t)lump >= FileInfo.Size()) return nullptr;
 	auto lumpp = FileInfo[lump].lump;
 	auto p = lumpp->Lock();
-	lumpp->RefCount = INT_MAX/2; // lock forever.
+	if (lumpp->RefCount > 0) lumpp->RefCount = INT_MAX/2; // lock forever. In-memory lumps do not own their data.
 	return p;
 }
 
@@ -1699,7 +1749,7 @@ const void *FileSystem::Load(FResourceLump *lump)
 	if (lump)
 	{
 		auto p = lump->Lock();
-		lump->RefCount = INT_MAX/2; // lock forever.
+		if (lump->RefCount > 0) lump->RefCount = INT_MAX/2; // lock forever.
 		return p;
 	}
 	else return nullptr;
@@ -144,6 +144,10 @@ public:
 	FileReader ReopenFileReader(int lump, bool alwayscache = false);		// opens an independent reader.
 	FileReader OpenFileReader(const char* name);
 
+	void PrefetchFiles(const TArray<int> &lumps);	// starts decompressing the given lumps in the background.
+	void PrefetchFiles(const char **names);			// same for all lumps with one of the given short names.
+	void ClearPrefetched();							// frees all prefetched lumps that were not read.
+
 	int FindLump (const char *name, int *lastlump, bool anyns=false);		// [RH] Find lumps with duplication
 	int FindLumpMulti (const char **names, int *lastlump, bool anyns = false, int *nameindex = NULL); // same with multiple possible names
 	int FindLumpFullName(const char* name, int* lastlump, bool noext = false);
@@ -0,0 +1,274 @@
+//-----------------------------------------------------------------------------
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see http://www.gnu.org/licenses/
+//
+//-----------------------------------------------------------------------------
+//
+// DESCRIPTION:
+//		Decompresses lumps on worker threads ahead of their use.
+//
+//		The compressed data is read on the calling thread because the
+//		archive's reader is shared by all its lumps. Only the inflating
+//		happens on the workers, from a private memory buffer. Lock takes
+//		over a finished buffer as the lump's cache, waits for one that is
+//		being decompressed and decompresses a still queued lump itself.
+//		Whatever nobody took gets freed by ClearPrefetchedLumps, which the
+//		callers of FileSystem::PrefetchFiles have to call once they are
+//		done with their lumps.
+//
+//-----------------------------------------------------------------------------
+
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <vector>
+#include <stdexcept>
+
+#include "resourcefile.h"
+#include "templates.h"
+
+class FLumpPrefetcher
+{
+	enum
+	{
+		MAX_PENDING_BYTES = 256 << 20
+	};
+
+	struct FJob
+	{
+		FResourceLump *Lump;
+		FCompressedBuffer Raw;
+		char *Data;
+		size_t Bytes;
+		bool Started;
+		bool Done;
+	};
+
+	std::mutex Mutex;
+	std::condition_variable WorkAvailable;
+	std::condition_variable WorkDone;
+	std::vector<std::thread> Threads;
+	TMap<FResourceLump *, FJob *> Jobs;
+	TArray<FJob *> Queue;
+	unsigned QueueHead = 0;
+	size_t PendingBytes = 0;
+	bool StopWorkers = false;
+
+	void StartThreads()
+	{
+		int numthreads = clamp<int>(std::thread::hardware_concurrency() - 1, 1, 4);
+		for (int i = 0; i < numthreads; i++)
+		{
+			Threads.push_back(std::thread([=]() { WorkerMain(); }));
+		}
+	}
+
+	void WorkerMain()
+	{
+		std::unique_lock<std::mutex> lock(Mutex);
+		while (true)
+		{
+			WorkAvailable.wait(lock, [&]() { return StopWorkers || QueueHead < Queue.Size(); });
+			if (StopWorkers) break;
+
+			FJob *job = Queue[QueueHead++];
+			if (QueueHead == Queue.Size())
+			{
+				Queue.Clear();
+				QueueHead = 0;
+			}
+			if (job == nullptr) continue;	// taken over by Lock before a worker got to it.
+			job->Started = true;
+			lock.unlock();
+
+			char *data = new char[job->Lump->LumpSize];
+			try
+			{
+				// Without an error callback the decompressors throw, which keeps errors away from the console on this thread.
+				FileReader mr;
+				mr.OpenMemory(job->Raw.mBuffer, job->Raw.mCompressedSize);
+				FileReader frz;
+				if (!frz.OpenDecompressor(mr, job->Raw.mSize, job->Raw.mMethod, false, nullptr) ||
+					frz.Read(data, job->Raw.mSize) != (FileReader::Size)job->Raw.mSize)
+				{
+					delete[] data;
+					data = nullptr;
+				}
+			}
+			catch (const std::exception &)
+			{
+				delete[] data;
+				data = nullptr;
+			}
+
+			lock.lock();
+			job->Data = data;
+			job->Done = true;
+			WorkDone.notify_all();
+		}
+	}
+
+	// Removes a job from the table. Must be called with the mutex held and the job not running.
+	// The decompressed data is not freed here because Take passes it on to the lump.
+	void Remove(FJob *job)
+	{
+		for (unsigned i = QueueHead; i < Queue.Size(); i++)
+		{
+			if (Queue[i] == job) Queue[i] = nullptr;
+		}
+		Jobs.Remove(job->Lump);
+		PendingBytes -= job->Bytes;
+		job->Lump->Flags &= ~LUMPF_PREFETCHING;
+		job->Raw.Clean();
+		delete job;
+	}
+
+public:
+	~FLumpPrefetcher()
+	{
+		{
+			std::lock_guard<std::mutex> lock(Mutex);
+			StopWorkers = true;
+		}
+		WorkAvailable.notify_all();
+		for (auto &thread : Threads) thread.join();
+
+		// The file system may outlive this object so no lump must be left pointing here.
+		decltype(Jobs)::Iterator it(Jobs);
+		decltype(Jobs)::Pair *pair;
+		while (it.NextPair(pair))
+		{
+			pair->Key->Flags &= ~LUMPF_PREFETCHING;
+			pair->Value->Raw.Clean();
+			delete[] pair->Value->Data;
+			delete pair->Value;
+		}
+	}
+
+	void Add(FResourceLump *lump)
+	{
+		// BZip2 is left out because its error handling goes through a global.
+		int method = lump->GetCompressionMethod();
+		if (method != METHOD_DEFLATE && method != METHOD_LZMA) return;
+		if (lump->Cache != nullptr || (lump->Flags & LUMPF_PREFETCHING) || lump->LumpSize <= 0) return;
+
+		std::unique_lock<std::mutex> lock(Mutex);
+		if (PendingBytes >= MAX_PENDING_BYTES) return;
+		lock.unlock();
+
+		auto job = new FJob{ lump, lump->GetRawData(), nullptr, 0, false, false };
+		job->Bytes = job->Raw.mCompressedSize + lump->LumpSize;
+
+		lock.lock();
+		if (Threads.empty()) StartThreads();
+		PendingBytes += job->Bytes;
+		Jobs[lump] = job;
+		Queue.Push(job);
+		lump->Flags |= LUMPF_PREFETCHING;
+		WorkAvailable.notify_one();
+	}
+
+	// Returns the decompressed data for the lump or nullptr if the caller has to read it itself.
+	char *Take(FResourceLump *lump)
+	{
+		std::unique_lock<std::mutex> lock(Mutex);
+		auto pjob = Jobs.CheckKey(lump);
+		if (pjob == nullptr) return nullptr;
+		FJob *job = *pjob;
+
+		if (job->Started)
+		{
+			WorkDone.wait(lock, [=]() { return job->Done; });
+		}
+		char *data = job->Data;
+		Remove(job);
+		return data;
+	}
+
+	// Called when a lump gets destroyed so that no worker is left with a dangling pointer.
+	void Forget(FResourceLump *lump)
+	{
+		std::unique_lock<std::mutex> lock(Mutex);
+		auto pjob = Jobs.CheckKey(lump);
+		if (pjob == nullptr) return;
+		FJob *job = *pjob;
+
+		if (job->Started)
+		{
+			WorkDone.wait(lock, [=]() { return job->Done; });
+		}
+		delete[] job->Data;
+		Remove(job);
+	}
+
+	void Clear()
+	{
+		std::unique_lock<std::mutex> lock(Mutex);
+		TArray<FJob *> jobs;
+		decltype(Jobs)::Iterator it(Jobs);
+		decltype(Jobs)::Pair *pair;
+		while (it.NextPair(pair))
+		{
+			jobs.Push(pair->Value);
+		}
+		for (auto job : jobs)
+		{
+			if (job->Started)
+			{
+				WorkDone.wait(lock, [=]() { return job->Done; });
+			}
+			delete[] job->Data;
+			Remove(job);
+		}
+	}
+};
+
+static FLumpPrefetcher LumpPrefetcher;
+
+//==========================================================================
+//
+// Queues the given lumps for decompression. Lumps that are not compressed
+// in a way the workers can handle are skipped and will be read on demand.
+//
+//==========================================================================
+
+void PrefetchLumps(FResourceLump **lumps, unsigned count)
+{
+	for (unsigned i = 0; i < count; i++)
+	{
+		LumpPrefetcher.Add(lumps[i]);
+	}
+}
+
+char *TakePrefetchedLump(FResourceLump *lump)
+{
+	return LumpPrefetcher.Take(lump);
+}
+
+void ForgetPrefetchedLump(FResourceLump *lump)
+{
+	LumpPrefetcher.Forget(lump);
+}
+
+//==========================================================================
+//
+// Frees all prefetched lumps that were not read, so that they neither
+// stay in memory nor count against the limit for later prefetches.
+//
+//==========================================================================
+
+void ClearPrefetchedLumps()
+{
+	LumpPrefetcher.Clear();
+}
@@ -38,6 +38,8 @@
 #include "resourcefile.h"
 #include "cmdlib.h"
 #include "md5.h"
+#include "c_cvars.h"
+#include "stats.h"
 
 
 //==========================================================================
@@ -65,6 +67,80 @@ public:
 };
 
 
+//==========================================================================
+//
+// Lump cache
+//
+// When the last lock on a lump goes away its data is kept around in an
+// LRU list instead of being freed right away, so that lumps which get read
+// over and over, e.g. on every map start, do not have to be read and
+// decompressed again each time. The cache shares its memory budget with
+// the image precache data, which makes room for itself by calling
+// TrimLumpCache. cache_budget is in megabytes, 0 disables the cache.
+//
+//==========================================================================
+
+static size_t TrimLumpCacheTo(size_t limit);
+
+CUSTOM_CVAR(Int, cache_budget, 128, CVAR_ARCHIVE | CVAR_GLOBALCONFIG)
+{
+	if (self < 0) self = 0;
+	else TrimLumpCacheTo(size_t(self) << 20);
+}
+
+static FResourceLump *CacheHead, *CacheTail;	// most and least recently used
+static size_t CacheBytes;
+static unsigned CacheLumps, CacheHits, CacheMisses, CacheEvictions;
+static size_t LumpBytesRead;
+
+size_t GetLumpBytesRead()
+{
+	return LumpBytesRead;
+}
+
+void CountLumpBytesRead(size_t bytes)
+{
+	LumpBytesRead += bytes;
+}
+
+static void UnlinkCachedLump(FResourceLump *lump)
+{
+	if (lump->CachePrev) lump->CachePrev->CacheNext = lump->CacheNext;
+	else CacheHead = lump->CacheNext;
+	if (lump->CacheNext) lump->CacheNext->CachePrev = lump->CachePrev;
+	else CacheTail = lump->CachePrev;
+	lump->CachePrev = lump->CacheNext = NULL;
+	CacheBytes -= lump->LumpSize;
+	CacheLumps--;
+}
+
+static size_t TrimLumpCacheTo(size_t limit)
+{
+	while (CacheBytes > limit && CacheTail != NULL)
+	{
+		auto lump = CacheTail;
+		UnlinkCachedLump(lump);
+		delete[] lump->Cache;
+		lump->Cache = NULL;
+		CacheEvictions++;
+	}
+	return CacheBytes;
+}
+
+size_t TrimLumpCache(size_t reserve)
+{
+	size_t budget = size_t(*cache_budget) << 20;
+	return TrimLumpCacheTo(reserve < budget ? budget - reserve : 0);
+}
+
+ADD_STAT(lumpcache)
+{
+	FString out;
+	out.Format("Lumps: %u  Size: %zuK  Budget: %dK  Hits: %u  Misses: %u  Evictions: %u",
+		CacheLumps, (CacheBytes + 1023) >> 10, *cache_budget << 10, CacheHits, CacheMisses, CacheEvictions);
+	return out;
+}
+
 //==========================================================================
 //
 // Base class for resource lumps
@@ -73,6 +149,8 @@ public:
 
 FResourceLump::~FResourceLump()
 {
+	if (Flags & LUMPF_PREFETCHING) ForgetPrefetchedLump(this);
+	if (Cache != NULL && RefCount == 0) UnlinkCachedLump(this);
 	if (Cache != NULL && RefCount >= 0)
 	{
 		delete [] Cache;
@@ -199,10 +277,32 @@ void *FResourceLump::Lock()
 	if (Cache != NULL)
 	{
 		if (RefCount > 0) RefCount++;
+		else if (RefCount == 0)
+		{
+			// Revive the data from the lump cache.
+			UnlinkCachedLump(this);
+			RefCount = 1;
+			CacheHits++;
+		}
 	}
 	else if (LumpSize > 0)
 	{
-		FillCache();
+		if (Flags & LUMPF_PREFETCHING)
+		{
+			Cache = TakePrefetchedLump(this);
+			if (Cache != nullptr)
+			{
+				RefCount = 1;
+				CacheMisses++;
+				LumpBytesRead += LumpSize;
+				return Cache;
+			}
+		}
+		if (FillCache() > 0)
+		{
+			CacheMisses++;
+			LumpBytesRead += LumpSize;
+		}
 	}
 	return Cache;
 }
@@ -219,8 +319,24 @@ int FResourceLump::Unlock()
 	{
 		if (--RefCount == 0)
 		{
-			delete [] Cache;
-			Cache = NULL;
+			size_t budget = size_t(*cache_budget) << 20;
+			if ((size_t)LumpSize <= budget / 4)
+			{
+				// Keep the data as the most recently used entry of the lump cache.
+				CachePrev = NULL;
+				CacheNext = CacheHead;
+				if (CacheHead) CacheHead->CachePrev = this;
+				else CacheTail = this;
+				CacheHead = this;
+				CacheBytes += LumpSize;
+				CacheLumps++;
+				TrimLumpCacheTo(budget);
+			}
+			else
+			{
+				delete [] Cache;
+				Cache = NULL;
+			}
 		}
 	}
 	return RefCount;
@@ -601,7 +717,7 @@ int FUncompressedLump::FillCache()
 {
 	const char * buffer = Owner->Reader.GetBuffer();
 
-	if (buffer != NULL)
+	if (buffer != NULL && Position + LumpSize <= Owner->Reader.GetLength())
 	{
 		// This is an in-memory file so the cache can point directly to the file's data.
 		Cache = const_cast<char*>(buffer) + Position;
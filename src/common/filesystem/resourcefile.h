@@ -58,6 +58,7 @@ enum ELumpFlags
 	LUMPF_EMBEDDED = 4,		// marks an embedded resource file for later processing.
 	LUMPF_SHORTNAME = 8,	// the stored name is a short extension-less name
 	LUMPF_COMPRESSED = 16,	// compressed or encrypted, i.e. cannot be read with the container file's reader.
+	LUMPF_PREFETCHING = 32,	// queued for decompression on a worker thread. See lumpprefetch.cpp.
 };
 
 // This holds a compresed Zip entry with all needed info to decompress it.
@@ -96,12 +97,17 @@ public:
 	char *			Cache;
 	FResourceFile *	Owner;
 
+	// Links in the lump cache's LRU list while the cache is kept with a RefCount of 0.
+	FResourceLump *	CachePrev;
+	FResourceLump *	CacheNext;
+
 	FResourceLump()
 	{
 		Cache = NULL;
 		Owner = NULL;
 		Flags = 0;
 		RefCount = 0;
+		CachePrev = CacheNext = NULL;
 	}
 
 	virtual ~FResourceLump();
@@ -113,6 +119,7 @@ public:
 	void LumpNameSetup(FString iname);
 	void CheckEmbedded();
 	virtual FCompressedBuffer GetRawData();
+	virtual int GetCompressionMethod() const { return -1; }	// -1 means the data cannot be decompressed on its own.
 
 	void *Lock(); // validates the cache and increases the refcount.
 	int Unlock(); // decreases the refcount and frees the buffer
@@ -126,6 +133,19 @@ protected:
 
 };
 
+// Makes room for the given number of bytes of other cached data within the cache budget. See resourcefile.cpp.
+size_t TrimLumpCache(size_t reserve);
+
+// Bytes of lump data read from the archives, either into the cache or through a reader of their own.
+size_t GetLumpBytesRead();
+void CountLumpBytesRead(size_t bytes);
+
+// Lump prefetching, see lumpprefetch.cpp.
+void PrefetchLumps(FResourceLump **lumps, unsigned count);
+char *TakePrefetchedLump(FResourceLump *lump);
+void ForgetPrefetchedLump(FResourceLump *lump);
+void ClearPrefetchedLumps();
+
 class FResourceFile
 {
 public:
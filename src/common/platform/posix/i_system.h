@@ -52,6 +52,12 @@ bool I_WriteIniFailed ();
 class FGameTexture;
 bool I_SetCursor(FGameTexture *);
 
+// Peak resident memory of the process in bytes, or 0 if unknown.
+size_t I_GetPeakMemoryUsage();
+
+// User and kernel time used by all threads of the process in seconds.
+double I_GetProcessCPUTime();
+
 static inline char *strlwr(char *str)
 {
 	char *ptr = str;
@@ -29,6 +29,7 @@
 **
 */
 #include <fnmatch.h>
+#include <sys/resource.h>
 
 #ifdef __APPLE__
 #include <AvailabilityMacros.h>
@@ -51,3 +52,23 @@ TArray<FString> I_GetGogPaths()
 	// GOG's Doom games are Windows only at the moment
 	return TArray<FString>();
 }
+
+size_t I_GetPeakMemoryUsage()
+{
+	rusage usage;
+	if (getrusage(RUSAGE_SELF, &usage) != 0)
+		return 0;
+#ifdef __APPLE__
+	return size_t(usage.ru_maxrss);			// already in bytes
+#else
+	return size_t(usage.ru_maxrss) * 1024;	// in kilobytes
+#endif
+}
+
+double I_GetProcessCPUTime()
+{
+	rusage usage;
+	if (getrusage(RUSAGE_SELF, &usage) != 0)
+		return 0;
+	return usage.ru_utime.tv_sec + usage.ru_stime.tv_sec + (usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) * 1e-6;
+}
@@ -60,6 +60,7 @@
 #include <richedit.h>
 #include <wincrypt.h>
 #include <shlwapi.h>
+#include <psapi.h>
 
 #include "hardware.h"
 #include "printf.h"
@@ -1058,6 +1059,23 @@ static void SetupNumaNodes()
 	}
 }
 
+size_t I_GetPeakMemoryUsage()
+{
+	PROCESS_MEMORY_COUNTERS counters;
+	if (!GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+		return 0;
+	return counters.PeakWorkingSetSize;
+}
+
+double I_GetProcessCPUTime()
+{
+	FILETIME creation, exit, kernel, user;
+	if (!GetProcessTimes(GetCurrentProcess(), &creation, &exit, &kernel, &user))
+		return 0;
+	auto ticks = [](const FILETIME &ft) { return (uint64_t(ft.dwHighDateTime) << 32) | ft.dwLowDateTime; };
+	return (ticks(kernel) + ticks(user)) * 1e-7;	// in 100 ns units
+}
+
 int I_GetNumaNodeCount()
 {
 	SetupNumaNodes();
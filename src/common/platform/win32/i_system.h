@@ -75,6 +75,12 @@ FString I_GetLongPathName(const FString &shortpath);
 #define PATH_MAX 260
 #endif
 
+// Peak resident memory of the process in bytes, or 0 if unknown.
+size_t I_GetPeakMemoryUsage();
+
+// User and kernel time used by all threads of the process in seconds.
+double I_GetProcessCPUTime();
+
 int I_GetNumaNodeCount();
 int I_GetNumaNodeThreadCount(int numaNode);
 void I_SetThreadNumaNode(std::thread &thread, int numaNode);
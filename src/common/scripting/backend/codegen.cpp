@@ -6652,6 +6652,26 @@ FxExpression *FxCVar::Resolve(FCompileContext &ctx)
 	return this;
 }
 
+//==========================================================================
+//
+// The address Emit loads a CVar's value from. Flag and mask CVars have
+// no storage of their own, they read another CVar's value.
+//
+//==========================================================================
+
+void *FxCVar::GetValueAddress(FBaseCVar *cvar)
+{
+	switch (cvar->GetRealType())
+	{
+	case CVAR_Int:		return &static_cast<FIntCVar *>(cvar)->Value;
+	case CVAR_Color:	return &static_cast<FColorCVar *>(cvar)->Value;
+	case CVAR_Float:	return &static_cast<FFloatCVar *>(cvar)->Value;
+	case CVAR_Bool:		return &static_cast<FBoolCVar *>(cvar)->Value;
+	case CVAR_String:	return &static_cast<FStringCVar *>(cvar)->mValue;
+	default:			return nullptr;
+	}
+}
+
 ExpEmit FxCVar::Emit(VMFunctionBuilder *build)
 {
 	ExpEmit dest(build, CVar->GetRealType() == CVAR_String ? REGT_STRING : ValueType->GetRegType());
@@ -8782,6 +8802,106 @@ FxExpression *FxVMFunctionCall::Resolve(FCompileContext& ctx)
 //
 //==========================================================================
 
+//==========================================================================
+//
+// Class hierarchy analysis for virtual calls: all classes are known once
+// code generation starts, so if no descendant of the receiver's static
+// type overrides a virtual function, the call can be bound statically.
+// Classes Dehacked creates later only copy their parent's table.
+//
+//==========================================================================
+
+static TMap<PClass *, TArray<VMFunction *>> DevirtualizedTables;
+
+static VMFunction *Devirtualize(PClass *cls, unsigned index)
+{
+	if (cls == nullptr || index >= cls->Virtuals.Size()) return nullptr;
+
+	auto table = DevirtualizedTables.CheckKey(cls);
+	if (table == nullptr)
+	{
+		table = &DevirtualizedTables[cls];
+		*table = cls->Virtuals;
+		for (auto sub : PClass::AllClasses)
+		{
+			if (sub == cls || !sub->IsDescendantOf(cls)) continue;
+			for (unsigned i = 0; i < table->Size(); i++)
+			{
+				if (i >= sub->Virtuals.Size() || sub->Virtuals[i] != (*table)[i]) (*table)[i] = nullptr;
+			}
+		}
+	}
+	return (*table)[index];
+}
+
+void ResetDevirtualization()
+{
+	DevirtualizedTables.Clear();
+}
+
+//==========================================================================
+//
+// Checks if a method does nothing but return a constant or a field of
+// self, so that the call can be replaced by what the function does.
+//
+//==========================================================================
+
+static const VMOP *GetInlineableCode(VMFunction *func, int &regtype)
+{
+	if (func->VarFlags & (VARF_Native | VARF_Action | VARF_VarArg)) return nullptr;
+
+	auto sfunc = static_cast<VMScriptFunction *>(func);
+	if (sfunc->Code == nullptr || sfunc->NumArgs != 1 || sfunc->ImplicitArgs != 1) return nullptr;
+
+	const VMOP *code = sfunc->Code;
+	if (sfunc->CodeSize == 1 && code[0].op == OP_RETI && code[0].a == RET_FINAL)
+	{
+		regtype = REGT_INT;
+		return code;
+	}
+	if (sfunc->CodeSize != 2 || code[0].b != 0) return nullptr;
+
+	switch (code[0].op)
+	{
+	case OP_LB: case OP_LBU: case OP_LH: case OP_LHU: case OP_LW:
+		regtype = REGT_INT;
+		break;
+	case OP_LSP: case OP_LDP:
+		regtype = REGT_FLOAT;
+		break;
+	case OP_LS:
+		regtype = REGT_STRING;
+		break;
+	case OP_LO: case OP_LP:
+		regtype = REGT_POINTER;
+		break;
+	default:
+		return nullptr;
+	}
+	if (code[1].op != OP_RET || code[1].a != RET_FINAL || code[1].b != regtype || code[1].c != code[0].a) return nullptr;
+	return code;
+}
+
+//==========================================================================
+//
+// An inlined call skips the UI-only scope check of OP_CALL and the JIT,
+// so play functions are only inlined into play functions. Those never
+// run with the UI-only marker set because their own call was checked.
+//
+//==========================================================================
+
+static bool MayInlineScope(PFunction *caller, VMFunction *callee)
+{
+	if (!(callee->VarFlags & VARF_Play)) return true;
+	return caller != nullptr && (caller->Variants[0].Flags & VARF_Play);
+}
+
+//==========================================================================
+//
+//
+//
+//==========================================================================
+
 ExpEmit FxVMFunctionCall::Emit(VMFunctionBuilder *build)
 {
 	assert(build->Registers[REGT_POINTER].GetMostUsed() >= build->NumImplicits);
@@ -8801,6 +8921,16 @@ ExpEmit FxVMFunctionCall::Emit(VMFunctionBuilder *build)
 	VMFunction *vmfunc = Function->Variants[0].Implementation;
 	bool staticcall = ((vmfunc->VarFlags & VARF_Final) || vmfunc->VirtualIndex == ~0u || NoVirtual);
 
+	if (!staticcall && (Function->Variants[0].Flags & VARF_Method) && Self->ValueType->isObjectPointer())
+	{
+		auto target = Devirtualize(static_cast<PObjectPointer *>(Self->ValueType)->PointedClass(), vmfunc->VirtualIndex);
+		if (target != nullptr)
+		{
+			vmfunc = target;
+			staticcall = true;
+		}
+	}
+
 	count = 0;
 	FunctionCallEmitter emitters(vmfunc);
 	// Emit code to pass implied parameters
@@ -8829,6 +8959,20 @@ ExpEmit FxVMFunctionCall::Emit(VMFunctionBuilder *build)
 			}
 		}
 
+		int regtype;
+		const VMOP *inlinecode;
+		if (staticcall && AssignCount <= 1 && ArgList.Size() == 0 && vmfunc->DefaultArgs.Size() <= 1 && vmfunc->Proto->ReturnTypes.Size() == 1 &&
+			MayInlineScope(CallingFunction, vmfunc) && (inlinecode = GetInlineableCode(vmfunc, regtype)) != nullptr)
+		{
+			ExpEmit dest(build, regtype);
+			if (inlinecode[0].op == OP_RETI) build->EmitLoadInt(dest.RegNum, inlinecode[0].i16);
+			else build->Emit(inlinecode[0].op, dest.RegNum, selfemit.RegNum, build->GetConstantInt(static_cast<VMScriptFunction *>(vmfunc)->KonstD[inlinecode[0].c]));
+			selfemit.Free(build);
+			ArgList.DeleteAndClear();
+			ArgList.ShrinkToFit();
+			return dest;
+		}
+
 		emitters.AddParameter(selfemit, (selfemit.Fixed && selfemit.Target) || selfemit.RegType == REGT_STRING);
 		if (Function->Variants[0].Flags & VARF_Action)
 		{
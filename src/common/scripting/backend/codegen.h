@@ -1366,6 +1366,7 @@ public:
 	FxCVar(FBaseCVar*, const FScriptPosition&);
 	FxExpression *Resolve(FCompileContext&);
 	ExpEmit Emit(VMFunctionBuilder *build);
+	static void *GetValueAddress(FBaseCVar *cvar);
 };
 
 
@@ -1687,6 +1688,8 @@ public:
 //
 //==========================================================================
 
+void ResetDevirtualization();
+
 class FxVMFunctionCall : public FxExpression
 {
 	friend class FxMultiAssign;
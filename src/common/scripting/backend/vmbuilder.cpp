@@ -37,6 +37,7 @@
 #include "m_argv.h"
 #include "c_cvars.h"
 #include "jit.h"
+#include "vmcodecache.h"
 
 CVAR(Bool, strictdecorate, false, CVAR_GLOBALCONFIG | CVAR_ARCHIVE)
 
@@ -250,6 +251,10 @@ unsigned VMFunctionBuilder::GetConstantFloat(double val)
 //
 //==========================================================================
 
+// Identical string constants share one buffer across all functions of a
+// build, so loading them never copies and comparing them is a pointer test.
+static TMap<FString, FString> InternedStringConstants;
+
 unsigned VMFunctionBuilder::GetConstantString(FString val)
 {
 	unsigned *locp = StringConstantMap.CheckKey(val);
@@ -259,6 +264,9 @@ unsigned VMFunctionBuilder::GetConstantString(FString val)
 	}
 	else
 	{
+		FString *interned = InternedStringConstants.CheckKey(val);
+		if (interned != nullptr) val = *interned;
+		else InternedStringConstants.Insert(val, val);
 		unsigned loc = StringConstantList.Push(val);
 		StringConstantMap.Insert(val, loc);
 		return loc;
@@ -289,6 +297,23 @@ unsigned VMFunctionBuilder::GetConstantAddress(void *ptr)
 	}
 }
 
+//==========================================================================
+//
+// VMFunctionBuilder :: GetConstantBlob
+//
+// Copies a block of constant data into the class data arena and returns
+// a constant register pointing to it.
+//
+//==========================================================================
+
+unsigned VMFunctionBuilder::GetConstantBlob(const void *data, unsigned size)
+{
+	void *blob = ClassDataAllocator.Alloc(size);	// Allocate in the arena so that the pointer does not need to be maintained.
+	memcpy(blob, data, size);
+	BlobSizes[blob] = size;
+	return GetConstantAddress(blob);
+}
+
 //==========================================================================
 //
 // VMFunctionBuilder :: AllocConstants*
@@ -813,10 +838,27 @@ void FFunctionBuildList::Build()
 {
 	VMDisassemblyDumper disasmdump(VMDisassemblyDumper::Overwrite);
 
-	for (auto &item : mItems)
+	TArray<FString> itemnames(mItems.Size(), true);
+	for (unsigned i = 0; i < mItems.Size(); i++)
+	{
+		itemnames[i] = mItems[i].PrintableName;
+	}
+	VMCodeCache.BeginBuild(itemnames);
+
+	for (unsigned index = 0; index < mItems.Size(); index++)
 	{
+		auto &item = mItems[index];
 		assert(item.Code != NULL);
 
+		// Code from the cache does not need to be resolved and emitted again.
+		if (VMCodeCache.Restore(index, item.PrintableName, item.Function, item.Func->Variants[0].Proto, item.Func->Variants[0].ArgFlags))
+		{
+			disasmdump.Write(item.Function, item.PrintableName);
+			delete item.Code;
+			disasmdump.Flush();
+			continue;
+		}
+
 		// We don't know the return type in advance for anonymous functions.
 		FCompileContext ctx(item.CurGlobals, item.Func, item.Func->SymbolName == NAME_None ? nullptr : item.Func->Variants[0].Proto, item.FromDecorate, item.StateIndex, item.StateCount, item.Lump, item.Version);
 
@@ -901,6 +943,7 @@ void FFunctionBuildList::Build()
 				disasmdump.Write(sfunc, item.PrintableName);
 
 				sfunc->Unsafe = ctx.Unsafe;
+				VMCodeCache.Store(index, item.PrintableName, sfunc, &buildit, item.Func->SymbolName == NAME_None ? item.Proto : nullptr);
 			}
 			catch (CRecoverableError &err)
 			{
@@ -912,6 +955,9 @@ void FFunctionBuildList::Build()
 		disasmdump.Flush();
 	}
 	VMFunction::CreateRegUseInfo();
+	VMCodeCache.EndBuild(FScriptPosition::ErrorCounter == 0);
+	ResetDevirtualization();
+	InternedStringConstants.Clear();
 	FScriptPosition::StrictErrors = strictdecorate;
 
 	if (FScriptPosition::ErrorCounter == 0 && Args->CheckParm("-dumpjit")) DumpJit();
@@ -1065,9 +1111,7 @@ ExpEmit FunctionCallEmitter::EmitCall(VMFunctionBuilder *build, TArray<ExpEmit>
 	{
 		// Pass a hidden type information parameter to vararg functions.
 		// It would really be nicer to actually pass real types but that'd require a far more complex interface on the compiler side than what we have.
-		uint8_t *regbuffer = (uint8_t*)ClassDataAllocator.Alloc(reginfo.Size());	// Allocate in the arena so that the pointer does not need to be maintained.
-		memcpy(regbuffer, reginfo.Data(), reginfo.Size());
-		build->Emit(OP_PARAM, REGT_POINTER | REGT_KONST, build->GetConstantAddress(regbuffer));
+		build->Emit(OP_PARAM, REGT_POINTER | REGT_KONST, build->GetConstantBlob(reginfo.Data(), reginfo.Size()));
 		paramcount++;
 	}
 
@@ -64,6 +64,7 @@ public:
 	unsigned GetConstantFloat(double val);
 	unsigned GetConstantAddress(void *ptr);
 	unsigned GetConstantString(FString str);
+	unsigned GetConstantBlob(const void *data, unsigned size);
 
 	unsigned AllocConstantsInt(unsigned int count, int *values);
 	unsigned AllocConstantsFloat(unsigned int count, double *values);
@@ -105,6 +106,9 @@ public:
 	ExpEmit FramePointer;
 	TArray<FxLocalVariableDeclaration *> ConstructedStructs;
 
+	// sizes of the data blocks allocated by GetConstantBlob, for the code cache.
+	TMap<void *, unsigned> BlobSizes;
+
 private:
 	TArray<FStatementInfo> LineNumbers;
 	TArray<FxExpression *> StatementStack;
@@ -0,0 +1,689 @@
+//-----------------------------------------------------------------------------
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see http://www.gnu.org/licenses/
+//
+//-----------------------------------------------------------------------------
+//
+// DESCRIPTION:
+//		Cache for the script compiler's generated code.
+//
+//-----------------------------------------------------------------------------
+
+#include <memory>
+
+#include "vmcodecache.h"
+#include "vmbuilder.h"
+#include "codegen.h"
+#include "vmintern.h"
+#include "types.h"
+#include "dobjtype.h"
+#include "filesystem.h"
+#include "files.h"
+#include "cmdlib.h"
+#include "i_specialpaths.h"
+#include "c_cvars.h"
+#include "printf.h"
+#include "engineerrors.h"
+#include "textures.h"
+#include "texturemanager.h"
+#include "version.h"
+#include "s_soundinternal.h"
+
+CVAR(Bool, vm_codecache, true, CVAR_ARCHIVE | CVAR_GLOBALCONFIG)
+EXTERN_CVAR(Bool, vm_jit)
+
+FVMCodeCache VMCodeCache;
+
+static const char CacheMagic[4] = { 'Z', 'S', 'C', 'C' };
+static const uint32_t CacheVersion = 1;
+
+enum EAddressKind : uint8_t
+{
+	AK_Value,		// null or a small integer stored as a pointer, e.g. a field offset
+	AK_Function,	// index into VMFunction::AllFunctions
+	AK_Class,		// index into PClass::AllClasses
+	AK_CVar,		// value of a console variable
+	AK_Blob,		// constant data allocated by the code generator
+	AK_Range,		// inside one of the registered address ranges
+};
+
+// Return types an anonymous function's prototype can be restored with.
+static PType *BasicType(unsigned index)
+{
+	PType *const types[] = { TypeSInt32, TypeUInt32, TypeBool, TypeFloat64, TypeString, TypeName, TypeSound, TypeColor, TypeState, TypeTextureID, TypeSpriteID, TypeVector2, TypeVector3 };
+	return index < countof(types) ? types[index] : nullptr;
+}
+
+//==========================================================================
+//
+// serialization helpers
+//
+//==========================================================================
+
+static void WriteBytes(TArray<uint8_t> &out, const void *data, size_t len)
+{
+	unsigned pos = out.Reserve((unsigned)len);
+	if (len > 0) memcpy(&out[pos], data, len);
+}
+
+template<class T> static void WriteValue(TArray<uint8_t> &out, T value)
+{
+	WriteBytes(out, &value, sizeof(T));
+}
+
+static void WriteString(TArray<uint8_t> &out, const char *str)
+{
+	uint32_t len = (uint32_t)strlen(str);
+	WriteValue(out, len);
+	WriteBytes(out, str, len);
+}
+
+class FCacheReader
+{
+	const uint8_t *Pos, *End;
+
+public:
+	FCacheReader(const uint8_t *data, size_t len) : Pos(data), End(data + len) {}
+
+	const uint8_t *Bytes(size_t len)
+	{
+		if (len > size_t(End - Pos)) throw CRecoverableError("Unexpected end of code cache data");
+		auto p = Pos;
+		Pos += len;
+		return p;
+	}
+
+	template<class T> T Value()
+	{
+		T value;
+		memcpy(&value, Bytes(sizeof(T)), sizeof(T));
+		return value;
+	}
+
+	FString String()
+	{
+		uint32_t len = Value<uint32_t>();
+		return FString((const char *)Bytes(len), len);
+	}
+
+	bool AtEnd() const { return Pos == End; }
+};
+
+static FString CreateCacheName(bool create)
+{
+	FString path = M_GetCachePath(create);
+	if (create) CreatePath(path);
+	path << "/zscript.zscc";
+	return path;
+}
+
+//==========================================================================
+//
+// FVMCodeCache :: AddSource
+//
+// Every script lump the parsers read goes into the cache key.
+//
+//==========================================================================
+
+void FVMCodeCache::AddSource(int lump)
+{
+	FString name = fileSystem.GetFileFullPath(lump);
+	auto data = fileSystem.ReadFile(lump);
+	SourceHash.Update((const uint8_t *)name.GetChars(), name.Len() + 1);
+	SourceHash.Update((const uint8_t *)data.GetMem(), (unsigned)data.GetSize());
+}
+
+//==========================================================================
+//
+// FVMCodeCache :: AddAddressRange
+//
+// Registers a block of game data that generated code may point into,
+// like an actor's states.
+//
+//==========================================================================
+
+void FVMCodeCache::AddAddressRange(const char *name, void *base, size_t size)
+{
+	if (base != nullptr && size > 0)
+	{
+		Ranges.Push({ name, (uint8_t *)base, size });
+	}
+}
+
+//==========================================================================
+//
+// FVMCodeCache :: BeginBuild
+//
+// The front end must have created exactly the same names, functions and
+// classes in exactly the same order as when the cache was written. Only
+// then are the indices stored in the cache valid for this run.
+//
+//==========================================================================
+
+void FVMCodeCache::BeginBuild(const TArray<FString> &items)
+{
+	Active = vm_codecache;
+	if (!Active) return;
+
+	// Bounds checks on texture IDs read the current texture count.
+	auto textures = (FArray *)&TexMan.Textures;
+	AddAddressRange("TexMan.Textures.Count", &textures->Count, sizeof(textures->Count));
+
+	NamesAtStart = FName::GetNumNames();
+	FunctionsAtStart = VMFunction::AllFunctions.Size();
+	ClassesAtStart = PClass::AllClasses.Size();
+
+	MD5Context md5;
+	MD5Context sources = SourceHash;
+	uint8_t digest[16];
+
+	md5.Update((const uint8_t *)CacheMagic, 4);
+	md5.Update((const uint8_t *)&CacheVersion, sizeof(CacheVersion));
+	md5.Update((const uint8_t *)GetVersionString(), (unsigned)strlen(GetVersionString()));
+	md5.Update((const uint8_t *)GetGitHash(), (unsigned)strlen(GetGitHash()));
+	uint8_t jit = vm_jit, ptrsize = sizeof(void *);
+	md5.Update(&jit, 1);
+	md5.Update(&ptrsize, 1);
+	sources.Final(digest);
+	md5.Update(digest, 16);
+	for (int i = 0; i < NamesAtStart; i++)
+	{
+		const char *name = FName(ENamedName(i)).GetChars();
+		md5.Update((const uint8_t *)name, (unsigned)strlen(name) + 1);
+	}
+	// Color names are turned into constants with this lump.
+	int rgblump = fileSystem.CheckNumForName("X11R6RGB");
+	if (rgblump >= 0)
+	{
+		FString name = fileSystem.GetFileFullPath(rgblump);
+		auto data = fileSystem.ReadFile(rgblump);
+		md5.Update((const uint8_t *)name.GetChars(), name.Len() + 1);
+		md5.Update((const uint8_t *)data.GetMem(), (unsigned)data.GetSize());
+	}
+	// Sound constants are stored as indices into the sound table.
+	if (soundEngine != nullptr)
+	{
+		auto &sounds = soundEngine->GetSounds();
+		uint32_t numsounds = sounds.Size();
+		md5.Update((const uint8_t *)&numsounds, sizeof(numsounds));
+		for (auto &sfx : sounds)
+		{
+			md5.Update((const uint8_t *)sfx.name.GetChars(), (unsigned)sfx.name.Len() + 1);
+		}
+	}
+	md5.Update((const uint8_t *)&FunctionsAtStart, sizeof(FunctionsAtStart));
+	md5.Update((const uint8_t *)&ClassesAtStart, sizeof(ClassesAtStart));
+	for (auto &item : items)
+	{
+		md5.Update((const uint8_t *)item.GetChars(), item.Len() + 1);
+	}
+	md5.Final(Fingerprint);
+
+	Output.Clear();
+	NumOutput = 0;
+	Dirty = false;
+	Restored = Compiled = 0;
+	Load();
+}
+
+//==========================================================================
+//
+// FVMCodeCache :: Load
+//
+//==========================================================================
+
+void FVMCodeCache::Load()
+{
+	Loaded.Clear();
+	LoadedEntries.Clear();
+
+	try
+	{
+		FileReader fr;
+		if (!fr.OpenFile(CreateCacheName(false)))
+		{
+			Dirty = true;
+			return;
+		}
+
+		Loaded = fr.Read();
+		FCacheReader header(Loaded.Data(), Loaded.Size());
+
+		if (memcmp(header.Bytes(4), CacheMagic, 4) != 0 || header.Value<uint32_t>() != CacheVersion || memcmp(header.Bytes(16), Fingerprint, 16) != 0)
+		{
+			throw CRecoverableError("Code cache is out of date");
+		}
+
+		uint8_t digest[16];
+		memcpy(digest, header.Bytes(16), 16);
+		size_t start = 4 + sizeof(uint32_t) + 32;
+		MD5Context md5;
+		md5.Update(Loaded.Data() + start, unsigned(Loaded.Size() - start));
+		uint8_t check[16];
+		md5.Final(check);
+		if (memcmp(check, digest, 16) != 0)
+		{
+			throw CRecoverableError("Code cache is damaged");
+		}
+
+		FCacheReader fr2(Loaded.Data() + start, Loaded.Size() - start);
+		uint32_t numnames = fr2.Value<uint32_t>();
+		TArray<FString> names(numnames, true);
+		for (auto &name : names) name = fr2.String();
+
+		struct FLoadedEntry
+		{
+			unsigned Index;
+			FEntry Entry;
+		};
+		TArray<FLoadedEntry> entries;
+		uint32_t numentries = fr2.Value<uint32_t>();
+		for (uint32_t i = 0; i < numentries; i++)
+		{
+			unsigned index = fr2.Value<uint32_t>();
+			unsigned size = fr2.Value<uint32_t>();
+			unsigned offset = unsigned(fr2.Bytes(size) - Loaded.Data());
+			entries.Push({ index, { offset, size } });
+		}
+
+		// The cached code refers to the names the compiler created by their index.
+		// Creating them in the same order as before reproduces these indices.
+		if (FName::GetNumNames() != NamesAtStart)
+		{
+			throw CRecoverableError("Name table has changed");
+		}
+		for (unsigned i = 0; i < numnames; i++)
+		{
+			if (FName(names[i]).GetIndex() != NamesAtStart + (int)i)
+			{
+				throw CRecoverableError("Name table has changed");
+			}
+		}
+		for (auto &e : entries)
+		{
+			LoadedEntries[e.Index] = e.Entry;
+		}
+	}
+	catch (CRecoverableError &err)
+	{
+		DPrintf(DMSG_NOTIFY, "Not using the script code cache: %s\n", err.GetMessage());
+		Loaded.Clear();
+		LoadedEntries.Clear();
+		Dirty = true;
+	}
+}
+
+//==========================================================================
+//
+// FVMCodeCache :: Save
+//
+//==========================================================================
+
+void FVMCodeCache::Save()
+{
+	TArray<uint8_t> body;
+	uint32_t numnames = FName::GetNumNames() - NamesAtStart;
+	WriteValue(body, numnames);
+	for (int i = NamesAtStart; i < FName::GetNumNames(); i++)
+	{
+		WriteString(body, FName(ENamedName(i)).GetChars());
+	}
+	WriteValue(body, NumOutput);
+	WriteBytes(body, Output.Data(), Output.Size());
+
+	uint8_t digest[16];
+	MD5Context md5;
+	md5.Update(body.Data(), body.Size());
+	md5.Final(digest);
+
+	std::unique_ptr<FileWriter> fw(FileWriter::Open(CreateCacheName(true)));
+	if (fw)
+	{
+		fw->Write(CacheMagic, 4);
+		fw->Write(&CacheVersion, sizeof(CacheVersion));
+		fw->Write(Fingerprint, 16);
+		fw->Write(digest, 16);
+		fw->Write(body.Data(), body.Size());
+	}
+}
+
+//==========================================================================
+//
+// FVMCodeCache :: BuildAddressMaps
+//
+//==========================================================================
+
+void FVMCodeCache::BuildAddressMaps()
+{
+	if (FunctionIndices.CountUsed() > 0 || ClassIndices.CountUsed() > 0) return;
+
+	for (unsigned i = 0; i < FunctionsAtStart; i++)
+	{
+		FunctionIndices[VMFunction::AllFunctions[i]] = i;
+	}
+	for (unsigned i = 0; i < ClassesAtStart; i++)
+	{
+		ClassIndices[PClass::AllClasses[i]] = i;
+	}
+	for (FBaseCVar *cvar = CVars; cvar != nullptr; cvar = cvar->GetNext())
+	{
+		void *addr = FxCVar::GetValueAddress(cvar);
+		if (addr != nullptr) CVarAddresses[addr] = cvar;
+	}
+}
+
+//==========================================================================
+//
+// FVMCodeCache :: WriteAddress
+//
+//==========================================================================
+
+bool FVMCodeCache::WriteAddress(TArray<uint8_t> &out, void *ptr, const TMap<void *, unsigned> &blobs)
+{
+	if ((uintptr_t)ptr <= 0xffff)
+	{
+		WriteValue(out, (uint8_t)AK_Value);
+		WriteValue(out, (uint32_t)(uintptr_t)ptr);
+		return true;
+	}
+	if (auto index = FunctionIndices.CheckKey(ptr))
+	{
+		WriteValue(out, (uint8_t)AK_Function);
+		WriteValue(out, (uint32_t)*index);
+		return true;
+	}
+	if (auto index = ClassIndices.CheckKey(ptr))
+	{
+		WriteValue(out, (uint8_t)AK_Class);
+		WriteValue(out, (uint32_t)*index);
+		return true;
+	}
+	if (auto cvar = CVarAddresses.CheckKey(ptr))
+	{
+		WriteValue(out, (uint8_t)AK_CVar);
+		WriteValue(out, (uint8_t)(*cvar)->GetRealType());
+		WriteString(out, (*cvar)->GetName());
+		return true;
+	}
+	if (auto size = blobs.CheckKey(ptr))
+	{
+		WriteValue(out, (uint8_t)AK_Blob);
+		WriteValue(out, (uint32_t)*size);
+		WriteBytes(out, ptr, *size);
+		return true;
+	}
+	for (auto &range : Ranges)
+	{
+		if ((uint8_t *)ptr >= range.Base && (uint8_t *)ptr < range.Base + range.Size)
+		{
+			WriteValue(out, (uint8_t)AK_Range);
+			WriteString(out, range.Name);
+			WriteValue(out, (uint32_t)((uint8_t *)ptr - range.Base));
+			return true;
+		}
+	}
+	return false;
+}
+
+//==========================================================================
+//
+// FVMCodeCache :: Store
+//
+// Adds a freshly compiled function to the cache. retproto is only passed
+// for anonymous functions, whose prototype depends on what the code returns.
+//
+//==========================================================================
+
+void FVMCodeCache::Store(unsigned index, const FString &name, VMScriptFunction *func, VMFunctionBuilder *build, PPrototype *retproto)
+{
+	if (!Active) return;
+	Compiled++;
+
+	// Stack objects that need construction refer to types, which cannot be restored.
+	if (func->SpecialInits.Size() > 0) return;
+
+	TArray<uint8_t> out;
+	WriteString(out, name);
+	WriteValue(out, (uint8_t)func->Unsafe);
+	if (retproto == nullptr)
+	{
+		WriteValue(out, (int32_t)-1);
+	}
+	else
+	{
+		WriteValue(out, (int32_t)retproto->ReturnTypes.Size());
+		for (auto type : retproto->ReturnTypes)
+		{
+			unsigned i = 0;
+			while (BasicType(i) != nullptr && BasicType(i) != type) i++;
+			if (BasicType(i) == nullptr) return;
+			WriteValue(out, (uint8_t)i);
+		}
+	}
+	WriteString(out, func->SourceFileName);
+	WriteValue(out, func->NumRegD);
+	WriteValue(out, func->NumRegF);
+	WriteValue(out, func->NumRegS);
+	WriteValue(out, func->NumRegA);
+	WriteValue(out, func->MaxParam);
+	WriteValue(out, func->NumArgs);
+	WriteValue(out, (int32_t)func->ExtraSpace);
+
+	WriteValue(out, (uint32_t)func->CodeSize);
+	WriteBytes(out, func->Code, func->CodeSize * sizeof(VMOP));
+	WriteValue(out, (uint32_t)func->LineInfoCount);
+	WriteBytes(out, func->LineInfo, func->LineInfoCount * sizeof(FStatementInfo));
+	WriteValue(out, (uint32_t)func->NumKonstD);
+	WriteBytes(out, func->KonstD, func->NumKonstD * sizeof(int));
+	WriteValue(out, (uint32_t)func->NumKonstF);
+	WriteBytes(out, func->KonstF, func->NumKonstF * sizeof(double));
+	WriteValue(out, (uint32_t)func->NumKonstS);
+	for (unsigned i = 0; i < func->NumKonstS; i++)
+	{
+		WriteString(out, func->KonstS[i]);
+	}
+
+	BuildAddressMaps();
+	WriteValue(out, (uint32_t)func->NumKonstA);
+	for (unsigned i = 0; i < func->NumKonstA; i++)
+	{
+		if (!WriteAddress(out, func->KonstA[i].v, build->BlobSizes)) return;
+	}
+
+	WriteValue(Output, (uint32_t)index);
+	WriteValue(Output, (uint32_t)out.Size());
+	WriteBytes(Output, out.Data(), out.Size());
+	NumOutput++;
+	Dirty = true;
+}
+
+//==========================================================================
+//
+// FVMCodeCache :: Restore
+//
+// Fills in a function from the cache. Nothing gets changed unless all of
+// the cached data could be relocated.
+//
+//==========================================================================
+
+bool FVMCodeCache::Restore(unsigned index, const FString &name, VMScriptFunction *func, PPrototype *argproto, const TArray<uint32_t> &argflags)
+{
+	if (!Active) return false;
+	auto entry = LoadedEntries.CheckKey(index);
+	if (entry == nullptr) return false;
+
+	try
+	{
+		FCacheReader fr(Loaded.Data() + entry->Offset, entry->Size);
+		if (fr.String().Compare(name) != 0) return false;
+
+		bool unsafe = !!fr.Value<uint8_t>();
+		int numrets = fr.Value<int32_t>();
+		TArray<PType *> rettypes;
+		for (int i = 0; i < numrets; i++)
+		{
+			PType *type = BasicType(fr.Value<uint8_t>());
+			if (type == nullptr) return false;
+			rettypes.Push(type);
+		}
+		FString sourcefile = fr.String();
+		auto numregd = fr.Value<VM_UBYTE>();
+		auto numregf = fr.Value<VM_UBYTE>();
+		auto numregs = fr.Value<VM_UBYTE>();
+		auto numrega = fr.Value<VM_UBYTE>();
+		auto maxparam = fr.Value<VM_UHALF>();
+		auto numargs = fr.Value<VM_UBYTE>();
+		int extraspace = fr.Value<int32_t>();
+
+		unsigned codesize = fr.Value<uint32_t>();
+		auto code = fr.Bytes(codesize * sizeof(VMOP));
+		unsigned numlines = fr.Value<uint32_t>();
+		auto lines = fr.Bytes(numlines * sizeof(FStatementInfo));
+		unsigned numkonstd = fr.Value<uint32_t>();
+		auto konstd = fr.Bytes(numkonstd * sizeof(int));
+		unsigned numkonstf = fr.Value<uint32_t>();
+		auto konstf = fr.Bytes(numkonstf * sizeof(double));
+		unsigned numkonsts = fr.Value<uint32_t>();
+		TArray<FString> konsts(numkonsts, true);
+		for (auto &s : konsts) s = fr.String();
+
+		unsigned numkonsta = fr.Value<uint32_t>();
+		TArray<void *> konsta(numkonsta, true);
+		for (auto &a : konsta)
+		{
+			switch (fr.Value<uint8_t>())
+			{
+			case AK_Value:
+				a = (void *)(uintptr_t)fr.Value<uint32_t>();
+				break;
+
+			case AK_Function:
+			{
+				unsigned i = fr.Value<uint32_t>();
+				if (i >= FunctionsAtStart) return false;
+				a = VMFunction::AllFunctions[i];
+				break;
+			}
+
+			case AK_Class:
+			{
+				unsigned i = fr.Value<uint32_t>();
+				if (i >= ClassesAtStart) return false;
+				a = PClass::AllClasses[i];
+				break;
+			}
+
+			case AK_CVar:
+			{
+				int type = fr.Value<uint8_t>();
+				FBaseCVar *cvar = FindCVar(fr.String(), nullptr);
+				if (cvar == nullptr || cvar->GetRealType() != type) return false;
+				a = FxCVar::GetValueAddress(cvar);
+				if (a == nullptr) return false;
+				break;
+			}
+
+			case AK_Blob:
+			{
+				unsigned size = fr.Value<uint32_t>();
+				a = ClassDataAllocator.Alloc(size);
+				memcpy(a, fr.Bytes(size), size);
+				break;
+			}
+
+			case AK_Range:
+			{
+				FString rangename = fr.String();
+				unsigned offset = fr.Value<uint32_t>();
+				a = nullptr;
+				for (auto &range : Ranges)
+				{
+					if (range.Name.Compare(rangename) == 0 && offset < range.Size)
+					{
+						a = range.Base + offset;
+						break;
+					}
+				}
+				if (a == nullptr) return false;
+				break;
+			}
+
+			default:
+				return false;
+			}
+		}
+		if (!fr.AtEnd() || codesize == 0) return false;
+		if (func->Proto == nullptr && numrets < 0) return false;
+
+		func->Alloc(codesize, numkonstd, numkonstf, numkonsts, numkonsta, numlines);
+		memcpy(func->Code, code, codesize * sizeof(VMOP));
+		if (numlines > 0) memcpy(func->LineInfo, lines, numlines * sizeof(FStatementInfo));
+		if (numkonstd > 0) memcpy(func->KonstD, konstd, numkonstd * sizeof(int));
+		if (numkonstf > 0) memcpy(func->KonstF, konstf, numkonstf * sizeof(double));
+		for (unsigned i = 0; i < numkonsts; i++) func->KonstS[i] = konsts[i];
+		for (unsigned i = 0; i < numkonsta; i++) func->KonstA[i].v = konsta[i];
+
+		if (func->Proto == nullptr)
+		{
+			func->Proto = NewPrototype(rettypes, argproto->ArgumentTypes);
+			func->ArgFlags = argflags;
+		}
+		func->SourceFileName = sourcefile;
+		func->NumRegD = numregd;
+		func->NumRegF = numregf;
+		func->NumRegS = numregs;
+		func->NumRegA = numrega;
+		func->MaxParam = maxparam;
+		func->NumArgs = numargs;
+		func->ExtraSpace = extraspace;
+		func->StackSize = VMFrame::FrameSize(numregd, numregf, numregs, numrega, maxparam, extraspace);
+		func->Unsafe = unsafe;
+	}
+	catch (CRecoverableError &)
+	{
+		return false;
+	}
+
+	// Keep the entry for the next cache file.
+	WriteValue(Output, (uint32_t)index);
+	WriteValue(Output, (uint32_t)entry->Size);
+	WriteBytes(Output, Loaded.Data() + entry->Offset, entry->Size);
+	NumOutput++;
+	Restored++;
+	return true;
+}
+
+//==========================================================================
+//
+// FVMCodeCache :: EndBuild
+//
+//==========================================================================
+
+void FVMCodeCache::EndBuild(bool success)
+{
+	if (Active)
+	{
+		DPrintf(DMSG_NOTIFY, "Script code cache: %d functions restored, %d compiled\n", Restored, Compiled);
+		if (success && Dirty) Save();
+	}
+	Active = false;
+	Loaded.Reset();
+	LoadedEntries.Clear();
+	Output.Reset();
+	FunctionIndices.Clear();
+	ClassIndices.Clear();
+	CVarAddresses.Clear();
+	Ranges.Reset();
+	SourceHash.Init();
+}
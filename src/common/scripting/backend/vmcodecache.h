@@ -0,0 +1,77 @@
+#pragma once
+
+#include "tarray.h"
+#include "zstring.h"
+#include "md5.h"
+
+class VMScriptFunction;
+class VMFunctionBuilder;
+class PPrototype;
+class FBaseCVar;
+
+//==========================================================================
+//
+// Cache for the code generated by the script compiler.
+//
+// The front end still has to run on every start because it creates all
+// the types, classes and defaults, but resolving and emitting function
+// bodies can be skipped if the cached code was generated from the same
+// sources by the same engine. Address constants are stored as references
+// to functions, classes, CVARs or registered address ranges and get
+// relocated on load. Functions which use anything that cannot be
+// relocated are simply compiled each time.
+//
+//==========================================================================
+
+class FVMCodeCache
+{
+	struct FRange
+	{
+		FString Name;
+		uint8_t *Base;
+		size_t Size;
+	};
+
+	struct FEntry
+	{
+		unsigned Offset;
+		unsigned Size;
+	};
+
+	MD5Context SourceHash;
+	TArray<FRange> Ranges;
+
+	uint8_t Fingerprint[16];
+	TArray<uint8_t> Loaded;
+	TMap<unsigned, FEntry> LoadedEntries;
+	TArray<uint8_t> Output;
+	unsigned NumOutput = 0;
+
+	int NamesAtStart = 0;
+	unsigned FunctionsAtStart = 0;
+	unsigned ClassesAtStart = 0;
+	TMap<void *, unsigned> FunctionIndices;
+	TMap<void *, unsigned> ClassIndices;
+	TMap<void *, FBaseCVar *> CVarAddresses;
+
+	bool Active = false;
+	bool Dirty = false;
+
+	void Load();
+	void Save();
+	void BuildAddressMaps();
+	bool WriteAddress(TArray<uint8_t> &out, void *ptr, const TMap<void *, unsigned> &blobs);
+
+public:
+	int Restored = 0, Compiled = 0;
+
+	void AddSource(int lump);
+	void AddAddressRange(const char *name, void *base, size_t size);
+
+	void BeginBuild(const TArray<FString> &items);
+	bool Restore(unsigned index, const FString &name, VMScriptFunction *func, PPrototype *argproto, const TArray<uint32_t> &argflags);
+	void Store(unsigned index, const FString &name, VMScriptFunction *func, VMFunctionBuilder *build, PPrototype *retproto);
+	void EndBuild(bool success);
+};
+
+extern FVMCodeCache VMCodeCache;
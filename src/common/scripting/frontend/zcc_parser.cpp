@@ -40,7 +40,9 @@
 #include "version.h"
 #include "zcc_parser.h"
 #include "zcc_compile.h"
+#include "vmcodecache.h"
 #include "templates.h"
+#include "parallel_for.h"
 
 TArray<FString> Includes;
 TArray<FScriptPosition> IncludeLocs;
@@ -235,7 +237,7 @@ static void InitTokenMap()
 
 //**--------------------------------------------------------------------------
 
-static void ParseSingleFile(FScanner *pSC, const char *filename, int lump, void *parser, ZCCParseState &state)
+static void ParseSingleFile(FScanner *pSC, const char *filename, int lump, void *parser, ZCCParseState &state, FScannedScript *scanned = nullptr)
 {
 	int tokentype;
 	//bool failed;
@@ -261,11 +263,12 @@ static void ParseSingleFile(FScanner *pSC, const char *filename, int lump, void
 
 		pSC = &lsc;
 	}
+	VMCodeCache.AddSource(lump);
 	FScanner &sc = *pSC;
 	sc.SetParseVersion(state.ParseVersion);
 	state.sc = &sc;
 
-	while (sc.GetToken())
+	while ((scanned != nullptr && sc.ReplayToken(*scanned)) || sc.GetToken())
 	{
 		value.Largest = 0;
 		value.SourceLoc = sc.GetMessageLine();
@@ -348,6 +351,58 @@ parse_end:
 	state.sc = nullptr;
 }
 
+//**--------------------------------------------------------------------------
+//
+// Opens all includes that have not been opened yet and tokenizes them
+// ahead of time on all available cores. Parsing itself still happens on
+// this thread, one file after the other in include order, because the
+// parser creates names and AST nodes and controls the scanner's state
+// mode, so the result does not depend on how the work got split up.
+//
+//**--------------------------------------------------------------------------
+
+struct FIncludedScript
+{
+	FScanner sc;
+	FScannedScript Scanned;
+	int LumpNum;
+};
+
+static void ScanIncludes(TArray<FIncludedScript *> &scripts, int fileno, VersionInfo version)
+{
+	TArray<FIncludedScript *> toscan;
+
+	for (unsigned i = scripts.Size(); i < Includes.Size(); i++)
+	{
+		int lumpnum = fileSystem.CheckNumForFullName(Includes[i], true);
+		if (lumpnum == -1)
+		{
+			IncludeLocs[i].Message(MSG_ERROR, "Include script lump %s not found", Includes[i].GetChars());
+			scripts.Push(nullptr);
+			continue;
+		}
+
+		auto fileno2 = fileSystem.GetFileContainer(lumpnum);
+		if (fileno == 0 && fileno2 != 0)
+		{
+			I_FatalError("File %s is overriding core lump %s.",
+				fileSystem.GetResourceFileFullName(fileSystem.GetFileContainer(lumpnum)), Includes[i].GetChars());
+		}
+
+		auto script = new FIncludedScript;
+		script->sc.OpenLumpNum(lumpnum);
+		script->sc.SetParseVersion(version);
+		script->LumpNum = lumpnum;
+		scripts.Push(script);
+		toscan.Push(script);
+	}
+
+	parallel_for(int(toscan.Size()), [&](int i)
+	{
+		toscan[i]->sc.ScanAhead(toscan[i]->Scanned);
+	});
+}
+
 //**--------------------------------------------------------------------------
 
 PNamespace *ParseOneScript(const int baselump, ZCCParseState &state)
@@ -418,23 +473,19 @@ PNamespace *ParseOneScript(const int baselump, ZCCParseState &state)
 	}
 
 	ParseSingleFile(&sc, nullptr, lumpnum, parser, state);
+	TDeletingArray<FIncludedScript *> scripts;
 	for (unsigned i = 0; i < Includes.Size(); i++)
 	{
-		lumpnum = fileSystem.CheckNumForFullName(Includes[i], true);
-		if (lumpnum == -1)
+		if (i == scripts.Size())
 		{
-			IncludeLocs[i].Message(MSG_ERROR, "Include script lump %s not found", Includes[i].GetChars());
+			// Includes of includes only become known while parsing, so this happens once per nesting level.
+			ScanIncludes(scripts, fileno, state.ParseVersion);
 		}
-		else
+		if (scripts[i] != nullptr)
 		{
-			auto fileno2 = fileSystem.GetFileContainer(lumpnum);
-			if (fileno == 0 && fileno2 != 0)
-			{
-				I_FatalError("File %s is overriding core lump %s.",
-					fileSystem.GetResourceFileFullName(fileSystem.GetFileContainer(lumpnum)), Includes[i].GetChars());
-			}
-
-			ParseSingleFile(nullptr, nullptr, lumpnum, parser, state);
+			ParseSingleFile(&scripts[i]->sc, nullptr, scripts[i]->LumpNum, parser, state, &scripts[i]->Scanned);
+			delete scripts[i];
+			scripts[i] = nullptr;
 		}
 	}
 	Includes.Clear();
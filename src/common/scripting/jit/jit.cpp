@@ -7,9 +7,26 @@ extern PString *TypeString;
 extern PStruct *TypeVector2;
 extern PStruct *TypeVector3;
 
-static void OutputJitLog(const asmjit::StringLogger &logger);
+// With error set this runs on a JIT worker thread. It must not create any FStrings
+// then because even empty ones change the shared null string's reference count.
+static void ReportJitError(VMScriptFunction *sfunc, const asmjit::StringLogger &logger, const char *what, std::string *error)
+{
+	char message[1024];
+	snprintf(message, sizeof(message), "%s: Unexpected JIT error: %s\n", sfunc->PrintableName.GetChars(), what);
+	if (error != nullptr)
+	{
+		// Called from a worker thread, the caller prints this on the main thread.
+		*error = logger.getString();
+		*error += message;
+	}
+	else
+	{
+		OutputJitLog(logger.getString());
+		Printf("%s", message);
+	}
+}
 
-JitFuncPtr JitCompile(VMScriptFunction *sfunc)
+JitFuncPtr JitCompile(VMScriptFunction *sfunc, std::string *error)
 {
 #if 0
 	if (strcmp(sfunc->PrintableName.GetChars(), "StatusScreen.drawNum") != 0)
@@ -29,10 +46,14 @@ JitFuncPtr JitCompile(VMScriptFunction *sfunc)
 		JitCompiler compiler(&code, sfunc);
 		return reinterpret_cast<JitFuncPtr>(AddJitFunction(&code, &compiler));
 	}
-	catch (const CRecoverableError &e)
+	catch (const std::exception &e)
+	{
+		ReportJitError(sfunc, logger, e.what(), error);
+		return nullptr;
+	}
+	catch (...)
 	{
-		OutputJitLog(logger);
-		Printf("%s: Unexpected JIT error: %s\n",sfunc->PrintableName.GetChars(), e.what());
+		ReportJitError(sfunc, logger, "unknown exception", error);
 		return nullptr;
 	}
 }
@@ -67,10 +88,10 @@ void JitDumpLog(FILE *file, VMScriptFunction *sfunc)
 	}
 }
 
-static void OutputJitLog(const asmjit::StringLogger &logger)
+void OutputJitLog(const char *log)
 {
 	// Write line by line since I_FatalError seems to cut off long strings
-	const char *pos = logger.getString();
+	const char *pos = log;
 	const char *end = pos;
 	while (*end)
 	{
@@ -124,10 +145,10 @@ asmjit::CCFunc *JitCompiler::Codegen()
 
 		if (op != OP_PARAM && op != OP_PARAMI && op != OP_VTBL)
 		{
-			FString lineinfo;
-			lineinfo.Format("; line %d: %02x%02x%02x%02x %s", curLine, pc->op, pc->a, pc->b, pc->c, OpNames[op]);
+			char lineinfo[128];
+			snprintf(lineinfo, sizeof(lineinfo), "; line %d: %02x%02x%02x%02x %s", curLine, pc->op, pc->a, pc->b, pc->c, OpNames[op]);
 			cc.comment("", 0);
-			cc.comment(lineinfo.GetChars(), lineinfo.Len());
+			cc.comment(lineinfo, strlen(lineinfo));
 		}
 
 		labels[i].cursor = cc.getCursor();
@@ -233,9 +254,9 @@ void JitCompiler::Setup()
 	cc.comment("", 0);
 	cc.comment(marks, 56);
 
-	FString funcname;
-	funcname.Format("Function: %s", sfunc->PrintableName.GetChars());
-	cc.comment(funcname.GetChars(), funcname.Len());
+	char funcname[256];
+	snprintf(funcname, sizeof(funcname), "Function: %s", sfunc->PrintableName.GetChars());
+	cc.comment(funcname, strlen(funcname));
 
 	cc.comment(marks, 56);
 	cc.comment("", 0);
@@ -417,26 +438,26 @@ void JitCompiler::CreateRegisters()
 
 	for (int i = 0; i < sfunc->NumRegD; i++)
 	{
-		regname.Format("regD%d", i);
-		regD[i] = cc.newInt32(regname.GetChars());
+		snprintf(regname, sizeof(regname), "regD%d", i);
+		regD[i] = cc.newInt32(regname);
 	}
 
 	for (int i = 0; i < sfunc->NumRegF; i++)
 	{
-		regname.Format("regF%d", i);
-		regF[i] = cc.newXmmSd(regname.GetChars());
+		snprintf(regname, sizeof(regname), "regF%d", i);
+		regF[i] = cc.newXmmSd(regname);
 	}
 
 	for (int i = 0; i < sfunc->NumRegS; i++)
 	{
-		regname.Format("regS%d", i);
-		regS[i] = cc.newIntPtr(regname.GetChars());
+		snprintf(regname, sizeof(regname), "regS%d", i);
+		regS[i] = cc.newIntPtr(regname);
 	}
 
 	for (int i = 0; i < sfunc->NumRegA; i++)
 	{
-		regname.Format("regA%d", i);
-		regA[i] = cc.newIntPtr(regname.GetChars());
+		snprintf(regname, sizeof(regname), "regA%d", i);
+		regA[i] = cc.newIntPtr(regname);
 	}
 }
 
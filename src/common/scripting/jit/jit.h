@@ -1,8 +1,12 @@
 
 #pragma once
 
+#include <string>
 #include "vmintern.h"
 
-JitFuncPtr JitCompile(VMScriptFunction *func);
+JitFuncPtr JitCompile(VMScriptFunction *func, std::string *error = nullptr);
+JitFuncPtr JitCompileAsync(VMScriptFunction *func);
+void JitInstallCompiled();
+void OutputJitLog(const char *log);
 void JitDumpLog(FILE *file, VMScriptFunction *func);
 FString JitCaptureStackTrace(int framesToSkip, bool includeNativeFrames);
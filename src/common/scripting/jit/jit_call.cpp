@@ -2,6 +2,7 @@
 #include "jitintern.h"
 #include <map>
 #include <memory>
+#include <mutex>
 
 void JitCompiler::EmitPARAM()
 {
@@ -74,6 +75,12 @@ void JitCompiler::EmitVMCall(asmjit::X86Gp vmfunc, VMFunction *target)
 
 	CheckVMFrame();
 
+	if (NeedsUIScopeCheck(target))
+	{
+		auto check = CreateCall<void, VMFunction*>(VMCheckUIScope);
+		check->setArg(0, vmfunc);
+	}
+
 	int numparams = StoreCallParams();
 	if (numparams != B)
 		I_Error("OP_CALL parameter count does not match the number of preceding OP_PARAM instructions");
@@ -105,6 +112,18 @@ void JitCompiler::EmitVMCall(asmjit::X86Gp vmfunc, VMFunction *target)
 	ParamOpcodes.Clear();
 }
 
+//
+// Calls only need to check the UI-only marker if the target is not known
+// or play-scoped. A play-scoped function was itself checked when it got
+// called, so nothing it calls can run as UI-only.
+//
+bool JitCompiler::NeedsUIScopeCheck(VMFunction *target)
+{
+	if (sfunc->VarFlags & VARF_Play)
+		return false;
+	return target == nullptr || (target->VarFlags & VARF_Play);
+}
+
 int JitCompiler::StoreCallParams()
 {
 	using namespace asmjit;
@@ -323,6 +342,14 @@ void JitCompiler::EmitNativeCall(VMNativeFunction *target)
 		I_Error("Native direct member function calls not implemented\n");
 	}
 
+	if (NeedsUIScopeCheck(target))
+	{
+		auto func = newTempIntPtr();
+		cc.mov(func, imm_ptr(target));
+		auto check = CreateCall<void, VMFunction*>(VMCheckUIScope);
+		check->setArg(0, func);
+	}
+
 	if (target->ImplicitArgs > 0)
 	{
 		auto label = EmitThrowExceptionLabel(X_READ_NIL);
@@ -565,14 +592,15 @@ void JitCompiler::EmitNativeCall(VMNativeFunction *target)
 	ParamOpcodes.Clear();
 }
 
-static std::map<FString, std::unique_ptr<TArray<uint8_t>>> argsCache;
+static std::map<std::string, std::unique_ptr<TArray<uint8_t>>> argsCache;
+static std::mutex argsCacheMutex;
 
 asmjit::FuncSignature JitCompiler::CreateFuncSignature()
 {
 	using namespace asmjit;
 
 	TArray<uint8_t> args;
-	FString key;
+	std::string key;
 
 	// First add parameters as args to the signature
 
@@ -681,6 +709,7 @@ asmjit::FuncSignature JitCompiler::CreateFuncSignature()
 	}
 
 	// FuncSignature only keeps a pointer to its args array. Store a copy of each args array variant.
+	std::lock_guard<std::mutex> lock(argsCacheMutex);
 	std::unique_ptr<TArray<uint8_t>> &cachedArgs = argsCache[key];
 	if (!cachedArgs) cachedArgs.reset(new TArray<uint8_t>(args));
 
@@ -0,0 +1,191 @@
+
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <vector>
+#include <string>
+#include "jit.h"
+#include "c_cvars.h"
+#include "printf.h"
+#include "templates.h"
+#include "version.h"
+
+CUSTOM_CVAR(Int, vm_jitthreads, 0, CVAR_ARCHIVE | CVAR_GLOBALCONFIG | CVAR_NOINITCALL)
+{
+	Printf("This won't take effect until " GAMENAME " is restarted.\n");
+}
+
+// Function calls land here while the function is waiting for a JIT worker.
+static int JitPendingCall(VMFunction *func, VMValue *params, int numparams, VMReturn *ret, int numret);
+
+//==========================================================================
+//
+// Compiles script functions on worker threads. Functions get interpreted
+// until their code is ready. Only the main thread ever touches ScriptCall:
+// the workers just hand over their results and the main thread installs
+// them the next time one of the pending functions gets called.
+//
+//==========================================================================
+
+class FJitQueue
+{
+	// Workers must not create FStrings, see JitCompile.
+	struct FResult
+	{
+		VMScriptFunction *Func;
+		JitFuncPtr Code;
+		std::string Error;
+	};
+
+	std::mutex Mutex;
+	std::condition_variable WorkAvailable;
+	std::condition_variable WorkDone;
+	std::vector<std::thread> Threads;
+	TArray<VMScriptFunction *> Pending;
+	std::vector<FResult> Results;
+	int Busy = 0;
+	bool StopWorkers = false;
+
+	void StartThreads()
+	{
+		int numthreads = vm_jitthreads;
+		if (numthreads <= 0) numthreads = clamp<int>(std::thread::hardware_concurrency() / 2, 1, 4);
+		for (int i = 0; i < numthreads; i++)
+		{
+			Threads.push_back(std::thread([=]() { WorkerMain(); }));
+		}
+	}
+
+	void WorkerMain()
+	{
+		std::unique_lock<std::mutex> lock(Mutex);
+		while (true)
+		{
+			WorkAvailable.wait(lock, [&]() { return StopWorkers || Pending.Size() > 0; });
+			if (StopWorkers) break;
+
+			FResult result = { nullptr, nullptr };
+			Pending.Pop(result.Func);
+			Busy++;
+			lock.unlock();
+
+			result.Code = JitCompile(result.Func, &result.Error);
+
+			lock.lock();
+			Busy--;
+			Results.push_back(std::move(result));
+			NumResults.store((unsigned)Results.size(), std::memory_order_release);
+			WorkDone.notify_all();
+		}
+	}
+
+public:
+	std::atomic<unsigned> NumResults{ 0 };
+
+	~FJitQueue()
+	{
+		{
+			std::lock_guard<std::mutex> lock(Mutex);
+			StopWorkers = true;
+		}
+		WorkAvailable.notify_all();
+		for (auto &thread : Threads) thread.join();
+	}
+
+	void Add(VMScriptFunction *func)
+	{
+		std::unique_lock<std::mutex> lock(Mutex);
+		if (Threads.empty()) StartThreads();
+		Pending.Push(func);
+		WorkAvailable.notify_one();
+	}
+
+	void Install()
+	{
+		std::vector<FResult> results;
+		{
+			std::lock_guard<std::mutex> lock(Mutex);
+			results.swap(Results);
+			NumResults.store(0, std::memory_order_relaxed);
+		}
+		for (auto &result : results)
+		{
+			if (!result.Error.empty()) OutputJitLog(result.Error.c_str());
+			JitFuncPtr code = result.Code != nullptr ? result.Code : VMExec;
+			if (!VMProfileSetEntry(result.Func, code)) result.Func->ScriptCall = code;
+		}
+	}
+
+	void Cancel()
+	{
+		std::unique_lock<std::mutex> lock(Mutex);
+		for (auto func : Pending) func->ScriptCall = VMExec;
+		Pending.Clear();
+		WorkDone.wait(lock, [&]() { return Busy == 0; });
+		Results.clear();
+		NumResults.store(0, std::memory_order_relaxed);
+	}
+};
+
+static FJitQueue JitQueue;
+
+//==========================================================================
+//
+//
+//
+//==========================================================================
+
+static int JitPendingCall(VMFunction *func, VMValue *params, int numparams, VMReturn *ret, int numret)
+{
+	if (!VMContext.MainThread)
+	{
+		return VMExec(func, params, numparams, ret, numret);
+	}
+	JitInstallCompiled();
+	if (func->ScriptCall != JitPendingCall)
+	{
+		return func->ScriptCall(func, params, numparams, ret, numret);
+	}
+	return VMExec(func, params, numparams, ret, numret);
+}
+
+//==========================================================================
+//
+// Queues a function for compilation and returns the entry point to use
+// until the compiled code is ready.
+//
+//==========================================================================
+
+JitFuncPtr JitCompileAsync(VMScriptFunction *func)
+{
+	JitQueue.Add(func);
+	return JitPendingCall;
+}
+
+//==========================================================================
+//
+// Installs the code of all functions the workers have finished.
+// Must be called from the main thread.
+//
+//==========================================================================
+
+void JitInstallCompiled()
+{
+	if (JitQueue.NumResults.load(std::memory_order_acquire) > 0)
+	{
+		JitQueue.Install();
+	}
+}
+
+//==========================================================================
+//
+// Drops all queued functions and waits for the workers to finish the
+// ones they are compiling. Queued functions fall back to the interpreter.
+//
+//==========================================================================
+
+void JitCancelCompiles()
+{
+	JitQueue.Cancel();
+}
@@ -1,5 +1,8 @@
 
 #include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
 #include "jit.h"
 #include "jitintern.h"
 
@@ -13,32 +16,33 @@
 #include <memory>
 #endif
 
+// No FStrings here because the entries get created on the JIT worker threads.
 struct JitFuncInfo
 {
-	FString name;
-	FString filename;
+	std::string name;
+	std::string filename;
 	TArray<JitLineInfo> LineInfo;
 	void *start;
 	void *end;
 };
 
-static TArray<JitFuncInfo> JitDebugInfo;
+static std::vector<JitFuncInfo> JitDebugInfo;
 static TArray<uint8_t*> JitBlocks;
 static TArray<uint8_t*> JitFrames;
 static size_t JitBlockPos = 0;
 static size_t JitBlockSize = 0;
 
+// Functions get compiled on the JIT worker threads, too. This guards the
+// executable memory blocks and the debug info above.
+static std::mutex JitMemoryMutex;
+
 asmjit::CodeInfo GetHostCodeInfo()
 {
-	static bool firstCall = true;
-	static asmjit::CodeInfo codeInfo;
-
-	if (firstCall)
+	static const asmjit::CodeInfo codeInfo = []()
 	{
 		asmjit::JitRuntime rt;
-		codeInfo = rt.getCodeInfo();
-		firstCall = false;
-	}
+		return rt.getCodeInfo();
+	}();
 
 	return codeInfo;
 }
@@ -273,6 +277,7 @@ void *AddJitFunction(asmjit::CodeHolder* code, JitCompiler *compiler)
 
 	codeSize = (codeSize + 15) / 16 * 16;
 
+	std::lock_guard<std::mutex> lock(JitMemoryMutex);
 	uint8_t *p = (uint8_t *)AllocJitMemory(codeSize + unwindInfoSize + functionTableSize);
 	if (!p)
 		return nullptr;
@@ -305,7 +310,8 @@ void *AddJitFunction(asmjit::CodeHolder* code, JitCompiler *compiler)
 	if (result == 0)
 		I_Error("RtlAddFunctionTable failed");
 
-	JitDebugInfo.Push({ compiler->GetScriptFunction()->PrintableName, compiler->GetScriptFunction()->SourceFileName, compiler->LineInfo, startaddr, endaddr });
+	auto sfunc = compiler->GetScriptFunction();
+	JitDebugInfo.push_back({ sfunc->PrintableName.GetChars(), sfunc->SourceFileName.GetChars(), compiler->LineInfo, startaddr, endaddr });
 #endif
 
 	return p;
@@ -664,6 +670,7 @@ void *AddJitFunction(asmjit::CodeHolder* code, JitCompiler *compiler)
 
 	codeSize = (codeSize + 15) / 16 * 16;
 
+	std::lock_guard<std::mutex> lock(JitMemoryMutex);
 	uint8_t *p = (uint8_t *)AllocJitMemory(codeSize + unwindInfoSize);
 	if (!p)
 		return nullptr;
@@ -729,7 +736,8 @@ void *AddJitFunction(asmjit::CodeHolder* code, JitCompiler *compiler)
 #endif
 	}
 
-	JitDebugInfo.Push({ compiler->GetScriptFunction()->PrintableName, compiler->GetScriptFunction()->SourceFileName, compiler->LineInfo, startaddr, endaddr });
+	auto sfunc = compiler->GetScriptFunction();
+	JitDebugInfo.push_back({ sfunc->PrintableName.GetChars(), sfunc->SourceFileName.GetChars(), compiler->LineInfo, startaddr, endaddr });
 
 	return p;
 }
@@ -737,6 +745,7 @@ void *AddJitFunction(asmjit::CodeHolder* code, JitCompiler *compiler)
 
 void JitRelease()
 {
+	std::lock_guard<std::mutex> lock(JitMemoryMutex);
 #ifdef _WIN64
 	for (auto p : JitFrames)
 	{
@@ -752,7 +761,7 @@ void JitRelease()
 	{
 		asmjit::OSUtils::releaseVirtualMemory(p, 1024 * 1024);
 	}
-	JitDebugInfo.Clear();
+	JitDebugInfo.clear();
 	JitFrames.Clear();
 	JitBlocks.Clear();
 	JitBlockPos = 0;
@@ -931,7 +940,16 @@ int JITPCToLine(uint8_t *pc, const JitFuncInfo *info)
 
 FString JitGetStackFrameName(NativeSymbolResolver *nativeSymbols, void *pc)
 {
-	for (unsigned int i = 0; i < JitDebugInfo.Size(); i++)
+	// This runs in the crash handler, which must not wait for a thread that
+	// crashed or stopped while holding the lock.
+	std::unique_lock<std::mutex> lock(JitMemoryMutex, std::try_to_lock);
+	if (!lock.owns_lock())
+	{
+		FString s;
+		s.Format("Called from %p\n", pc);
+		return s;
+	}
+	for (size_t i = 0; i < JitDebugInfo.size(); i++)
 	{
 		const auto &info = JitDebugInfo[i];
 		if (pc >= info.start && pc < info.end)
@@ -941,9 +959,9 @@ FString JitGetStackFrameName(NativeSymbolResolver *nativeSymbols, void *pc)
 			FString s;
 
 			if (line == -1)
-				s.Format("Called from %s at %s\n", info.name.GetChars(), info.filename.GetChars());
+				s.Format("Called from %s at %s\n", info.name.c_str(), info.filename.c_str());
 			else
-				s.Format("Called from %s at %s, line %d\n", info.name.GetChars(), info.filename.GetChars(), line);
+				s.Format("Called from %s at %s, line %d\n", info.name.c_str(), info.filename.c_str(), line);
 
 			return s;
 		}
@@ -55,6 +55,8 @@ extern FMemArena ClassDataAllocator;
 #define MAX_TRY_DEPTH	8	// Maximum number of nested TRYs in a single function
 
 void JitRelease();
+void JitCancelCompiles();
+void VMProfileClear();
 
 extern void (*VM_CastSpriteIDToString)(FString* a, unsigned int b);
 
@@ -115,6 +117,32 @@ void ThrowAbortException(VMScriptFunction *sfunc, VMOP *line, EVMAbortException
 
 void ClearGlobalVMStack();
 
+// Per-thread VM state, next to the thread's frame stack. Only the main
+// thread installs compiled code and records profiles, other threads just
+// interpret whatever they call. Code running with UIOnly set may not call
+// play-scoped functions, which is what allows ui-scoped code to run next
+// to the playsim without changing what the playsim computes.
+struct VMThreadContext
+{
+	bool MainThread = false;
+	bool UIOnly = false;
+};
+
+extern thread_local VMThreadContext VMContext;
+
+void VMCheckUIScope(VMFunction *func);
+
+// Marks all VM calls made during its lifetime as UI-only if vm_checkuiscope
+// is enabled, which reports play-scoped calls from HUD and menu code.
+// VMCall, OP_CALL and the JIT's calls check this with VMCheckUIScope.
+class FVMUIScope
+{
+	bool Saved;
+public:
+	FVMUIScope();
+	~FVMUIScope() { VMContext.UIOnly = Saved; }
+};
+
 struct VMReturn
 {
 	void *Location;
@@ -430,6 +458,8 @@ public:
 	void operator delete[](void *block) {}
 	static void DeleteAll()
 	{
+		JitCancelCompiles();
+		VMProfileClear();
 		for (auto f : AllFunctions)
 		{
 			f->~VMFunction();
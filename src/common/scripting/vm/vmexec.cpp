@@ -136,12 +136,29 @@ struct VMExec_Unchecked
 {
 #include "vmexec.h"
 };
+
+// The profiler's line mode uses an unchecked interpreter that takes a sample every few instructions.
+#undef NEXTOP
+#if COMPGOTO
+#define NEXTOP	do { pc++; if (--VMProfileCountdown <= 0) VMProfileSampleLine(sfunc, pc); unsigned op = pc->op; a = pc->a; goto *ops[op]; } while(0)
+#else
+#define NEXTOP	pc++; if (--VMProfileCountdown <= 0) VMProfileSampleLine(sfunc, pc); break
+#endif
+struct VMExec_Profiling
+{
+#include "vmexec.h"
+};
 #if !WAS_NDEBUG
 #undef NDEBUG
 #endif
 #undef assert
 #include <assert.h>
 
+int VMExecProfiling(VMFunction *func, VMValue *params, int numparams, VMReturn *ret, int numret)
+{
+	return VMExec_Profiling::Exec(func, params, numparams, ret, numret);
+}
+
 int (*VMExec)(VMFunction *func, VMValue *params, int numparams, VMReturn *ret, int numret) =
 #ifdef NDEBUG
 VMExec_Unchecked::Exec
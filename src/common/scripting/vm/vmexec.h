@@ -692,6 +692,10 @@ static int ExecScriptFunc(VMFrameStack *stack, VMReturn *ret, int numret)
 
 			b = B;
 			FillReturns(reg, f, returns, pc+1, C);
+			if (VMContext.UIOnly)
+			{
+				VMCheckUIScope(call);
+			}
 			if (call->VarFlags & VARF_Native)
 			{
 				try
@@ -1816,7 +1820,8 @@ static void DoCast(const VMRegisters &reg, const VMFrame *f, int a, int b, int c
 	{
 		ASSERTS(a); ASSERTD(b);
 		FName name = FName(ENamedName(reg.d[b]));
-		reg.s[a] = name.IsValidName() ? name.GetChars() : "";
+		if (name.IsValidName()) reg.s[a] = name.GetString();
+		else reg.s[a] = "";
 		break; 
 	}
 
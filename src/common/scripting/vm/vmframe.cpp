@@ -50,15 +50,50 @@ CUSTOM_CVAR(Bool, vm_jit, true, CVAR_NOINITCALL)
 	Printf("You must restart " GAMENAME " for this change to take effect.\n");
 	Printf("This cvar is currently not saved. You must specify it on the command line.");
 }
+CVAR(Bool, vm_jitasync, true, CVAR_ARCHIVE | CVAR_GLOBALCONFIG)
 #else
 CVAR(Bool, vm_jit, false, CVAR_NOINITCALL|CVAR_NOSET)
 FString JitCaptureStackTrace(int framesToSkip, bool includeNativeFrames) { return FString(); }
 void JitRelease() {}
+void JitCancelCompiles() {}
 #endif
 
 cycle_t VMCycles[10];
 int VMCalls[10];
 
+thread_local VMThreadContext VMContext;
+
+// Static initialization runs on the main thread.
+static struct FMainThreadMarker
+{
+	FMainThreadMarker() { VMContext.MainThread = true; }
+} MainThreadMarker;
+
+CVAR(Bool, vm_checkuiscope, false, 0)
+
+FVMUIScope::FVMUIScope()
+{
+	Saved = VMContext.UIOnly;
+	if (vm_checkuiscope) VMContext.UIOnly = true;
+}
+
+//===========================================================================
+//
+// VMCheckUIScope
+//
+// Aborts if a play-scoped function gets called while the thread is
+// marked as UI-only.
+//
+//===========================================================================
+
+void VMCheckUIScope(VMFunction *func)
+{
+	if (VMContext.UIOnly && (func->VarFlags & VARF_Play))
+	{
+		ThrowAbortException(X_OTHER, "Play function %s called from UI code", func->PrintableName.GetChars());
+	}
+}
+
 #if 0
 IMPLEMENT_CLASS(VMException, false, false)
 #endif
@@ -278,11 +313,39 @@ static bool CanJit(VMScriptFunction *func)
 	return false;
 }
 
+//==========================================================================
+//
+// Queues the function for background compilation if it has never been
+// called, so that the first call does not have to wait for the JIT.
+//
+//==========================================================================
+
+void VMScriptFunction::PrecompileJit()
+{
+#ifdef HAVE_VM_JIT
+	if (ScriptCall == &VMScriptFunction::FirstScriptCall && vm_jit && vm_jitasync && CanJit(this))
+	{
+		ScriptCall = JitCompileAsync(this);
+	}
+#endif
+}
+
 int VMScriptFunction::FirstScriptCall(VMFunction *func, VMValue *params, int numparams, VMReturn *ret, int numret)
 {
+	if (!VMContext.MainThread)
+	{
+		// Only the main thread may change how a function gets called.
+		return VMExec(func, params, numparams, ret, numret);
+	}
 #ifdef HAVE_VM_JIT
 	if (vm_jit && CanJit(static_cast<VMScriptFunction*>(func)))
 	{
+		if (vm_jitasync)
+		{
+			// Interpret this call and let a worker thread compile the function.
+			func->ScriptCall = JitCompileAsync(static_cast<VMScriptFunction*>(func));
+			return VMExec(func, params, numparams, ret, numret);
+		}
 		func->ScriptCall = JitCompile(static_cast<VMScriptFunction*>(func));
 		if (!func->ScriptCall)
 			func->ScriptCall = VMExec;
@@ -324,11 +387,7 @@ int VMNativeFunction::NativeScriptCall(VMFunction *func, VMValue *params, int nu
 
 void VMFrame::InitRegS()
 {
-	FString *regs = GetRegS();
-	for (int i = 0; i < NumRegS; ++i)
-	{
-		::new(&regs[i]) FString;
-	}
+	FString::ConstructEmptyArray(GetRegS(), NumRegS);
 }
 
 //===========================================================================
@@ -430,11 +489,14 @@ VMFrame *VMFrameStack::Alloc(int size)
 	{ // Not enough space. Allocate a new block.
 		int blocksize = ((sizeof(BlockHeader) + 15) & ~15) + size;
 		BlockHeader **blockp;
-		if (blocksize < BLOCK_SIZE)
+		// Every block is at least twice as big as the one below it, so deep
+		// call chains only cross a few block boundaries.
+		int minsize = block == NULL ? (int)BLOCK_SIZE : MIN<int>(block->BlockSize * 2, MAX_BLOCK_SIZE);
+		if (blocksize < minsize)
 		{
-			blocksize = BLOCK_SIZE;
+			blocksize = minsize;
 		}
-		for (blockp = &UnusedBlocks, block = *blockp; block != NULL; block = block->NextBlock)
+		for (blockp = &UnusedBlocks; (block = *blockp) != NULL; blockp = &block->NextBlock)
 		{
 			if (block->BlockSize >= blocksize)
 			{
@@ -490,10 +552,9 @@ VMFrame *VMFrameStack::PopFrame()
 		Func->DestroyExtra(frame->GetExtra());
 	}
 	// Free any string registers this frame had.
-	FString *regs = frame->GetRegS();
-	for (int i = frame->NumRegS; i != 0; --i)
+	if (frame->NumRegS != 0)
 	{
-		(regs++)->~FString();
+		FString::DestroyArray(frame->GetRegS(), frame->NumRegS);
 	}
 	VMFrame *parent = frame->ParentFrame;
 	if (parent == NULL)
@@ -542,6 +603,10 @@ int VMCall(VMFunction *func, VMValue *params, int numparams, VMReturn *results,
 	try
 #endif
 	{	
+		if (VMContext.UIOnly)
+		{
+			VMCheckUIScope(func);
+		}
 		if (func->VarFlags & VARF_Native)
 		{
 			return static_cast<VMNativeFunction *>(func)->NativeCall(VM_INVOKE(params, numparams, results, numresults, func->RegTypes));
@@ -361,7 +361,11 @@ public:
 	}
 	static int OffsetLastFrame() { return (int)(ptrdiff_t)offsetof(BlockHeader, LastFrame); }
 private:
-	enum { BLOCK_SIZE = 4096 };		// Default block size
+	enum
+	{
+		BLOCK_SIZE = 4096,			// Default block size
+		MAX_BLOCK_SIZE = 65536		// Blocks stop growing at this size
+	};
 	struct BlockHeader
 	{
 		BlockHeader *NextBlock;
@@ -432,6 +436,9 @@ enum EVMEngine
 
 void VMSelectEngine(EVMEngine engine);
 extern int (*VMExec)(VMFunction *func, VMValue *params, int numparams, VMReturn *ret, int numret);
+int VMExecProfiling(VMFunction *func, VMValue *params, int numparams, VMReturn *ret, int numret);
+extern int VMProfileCountdown;
+void VMProfileSampleLine(VMScriptFunction *func, const VMOP *pc);
 void VMFillParams(VMValue *params, VMFrame *callee, int numparam);
 
 void VMDumpConstants(FILE *out, const VMScriptFunction *func);
@@ -442,6 +449,7 @@ extern thread_local VMFrameStack GlobalVMStack;
 typedef std::pair<const class PType *, unsigned> FTypeAndOffset;
 
 typedef int(*JitFuncPtr)(VMFunction *func, VMValue *params, int numparams, VMReturn *ret, int numret);
+bool VMProfileSetEntry(VMFunction *func, JitFuncPtr entry);
 
 class VMScriptFunction : public VMFunction
 {
@@ -477,6 +485,7 @@ public:
 	void DestroyExtra(void *addr);
 	int AllocExtraStack(PType *type);
 	int PCToLine(const VMOP *pc);
+	void PrecompileJit();
 
 private:
 	static int FirstScriptCall(VMFunction *func, VMValue *params, int numparams, VMReturn *ret, int numret);
@@ -0,0 +1,407 @@
+//-----------------------------------------------------------------------------
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see http://www.gnu.org/licenses/
+//
+//-----------------------------------------------------------------------------
+//
+// DESCRIPTION:
+//		Script profiler.
+//
+//		vm_profile start [lines]	- starts collecting data
+//		vm_profile stop				- stops collecting data
+//		vm_profile report [count]	- prints the most expensive functions and lines
+//		vm_profile dump <file>		- writes the call stacks in the collapsed
+//									  format flame graph tools read
+//
+//		Every call of a script function goes through its ScriptCall
+//		pointer, no matter if the caller is native code, the interpreter
+//		or JIT compiled code. While profiling, all ScriptCall pointers
+//		point to a wrapper that keeps track of the call stack and measures
+//		the time spent in each function.
+//
+//		Line mode runs all script code in an interpreter that records the
+//		current line every few instructions. This is a lot slower than
+//		normal execution, so the times are only useful relative to each
+//		other.
+//
+//-----------------------------------------------------------------------------
+
+#include <algorithm>
+
+#include "vmintern.h"
+#include "types.h"
+#include "c_dispatch.h"
+#include "i_time.h"
+#include "printf.h"
+#include "v_text.h"
+
+enum
+{
+	LINE_SAMPLE_INTERVAL = 97	// a prime, so that loops of any size get sampled evenly
+};
+
+int VMProfileCountdown = LINE_SAMPLE_INTERVAL;
+
+class FVMProfiler
+{
+	struct FHook
+	{
+		JitFuncPtr Entry;
+		unsigned Index;
+	};
+
+	struct FNode
+	{
+		unsigned Func;
+		int Parent;
+		uint64_t Calls;
+		uint64_t SelfNS;
+		uint64_t TotalNS;
+	};
+
+	struct FFrame
+	{
+		int Node;
+		uint64_t Start;
+		uint64_t ChildNS;
+	};
+
+	TMap<VMFunction *, FHook> Hooks;
+	TArray<VMFunction *> Functions;
+	TArray<FNode> Nodes;
+	TMap<uint64_t, int> NodeMap;
+	TArray<FFrame> Stack;
+	TMap<uint64_t, uint64_t> LineSamples;
+	uint64_t StartTime = 0, ProfiledNS = 0;
+
+	static int ProfiledCall(VMFunction *func, VMValue *params, int numparams, VMReturn *ret, int numret);
+
+	int GetNode(int parent, unsigned func)
+	{
+		uint64_t key = (uint64_t(unsigned(parent)) << 32) | func;
+		auto node = NodeMap.CheckKey(key);
+		if (node != nullptr) return *node;
+		int index = Nodes.Push({ func, parent, 0, 0, 0 });
+		NodeMap[key] = index;
+		return index;
+	}
+
+	FString GetStackName(int node) const
+	{
+		FString name;
+		for (; node >= 0; node = Nodes[node].Parent)
+		{
+			FString frame = Functions[Nodes[node].Func]->PrintableName;
+			frame.ReplaceChars("; ", '_');
+			name = name.IsEmpty() ? frame : frame + ";" + name;
+		}
+		return name;
+	}
+
+public:
+	bool Active = false;
+	bool LineMode = false;
+	bool StopPending = false;
+
+	void Start(bool lines);
+	void Stop();
+	void Clear();
+	void Report(int count);
+	void Dump(const char *filename);
+
+	bool SetEntry(VMFunction *func, JitFuncPtr entry)
+	{
+		auto hook = Hooks.CheckKey(func);
+		if (hook == nullptr) return false;
+		hook->Entry = entry;
+		return true;
+	}
+
+	void SampleLine(VMScriptFunction *func, const VMOP *pc)
+	{
+		auto hook = Hooks.CheckKey(func);
+		if (hook != nullptr)
+		{
+			uint64_t key = (uint64_t(hook->Index) << 32) | unsigned(func->PCToLine(pc));
+			LineSamples[key]++;
+		}
+	}
+};
+
+static FVMProfiler VMProfiler;
+
+//==========================================================================
+//
+//
+//
+//==========================================================================
+
+int FVMProfiler::ProfiledCall(VMFunction *func, VMValue *params, int numparams, VMReturn *ret, int numret)
+{
+	auto &self = VMProfiler;
+	auto hook = self.Hooks.CheckKey(func);
+	assert(hook != nullptr);
+
+	if (!VMContext.MainThread)
+	{
+		return hook->Entry(func, params, numparams, ret, numret);
+	}
+
+	struct FScope
+	{
+		FScope(int node)
+		{
+			VMProfiler.Stack.Push({ node, I_nsTime(), 0 });
+		}
+		~FScope()
+		{
+			auto &self = VMProfiler;
+			FFrame frame;
+			self.Stack.Pop(frame);
+			uint64_t elapsed = I_nsTime() - frame.Start;
+			auto &node = self.Nodes[frame.Node];
+			node.Calls++;
+			node.TotalNS += elapsed;
+			node.SelfNS += elapsed - std::min(elapsed, frame.ChildNS);
+			if (self.Stack.Size() > 0) self.Stack.Last().ChildNS += elapsed;
+			else if (self.StopPending) self.Stop();
+		}
+	};
+
+	int result;
+	{
+		FScope scope(self.GetNode(self.Stack.Size() > 0 ? self.Stack.Last().Node : -1, hook->Index));
+		result = (self.LineMode ? VMExecProfiling : hook->Entry)(func, params, numparams, ret, numret);
+
+		// The first call of a function installs the code it should be run with from now on.
+		if (func->ScriptCall != ProfiledCall)
+		{
+			hook->Entry = func->ScriptCall;
+			func->ScriptCall = ProfiledCall;
+		}
+	}
+	return result;
+}
+
+//==========================================================================
+//
+//
+//
+//==========================================================================
+
+void FVMProfiler::Start(bool lines)
+{
+	if (Active) Stop();
+
+	Hooks.Clear();
+	Functions.Clear();
+	Nodes.Clear();
+	NodeMap.Clear();
+	LineSamples.Clear();
+	for (auto func : VMFunction::AllFunctions)
+	{
+		if (!(func->VarFlags & VARF_Native) && func->ScriptCall != nullptr)
+		{
+			Hooks[func] = { func->ScriptCall, Functions.Push(func) };
+			func->ScriptCall = ProfiledCall;
+		}
+	}
+	LineMode = lines;
+	VMProfileCountdown = LINE_SAMPLE_INTERVAL;
+	Active = true;
+	StopPending = false;
+	StartTime = I_nsTime();
+	Printf("Profiling %u script functions%s\n", Functions.Size(), lines ? " with line samples" : "");
+}
+
+void FVMProfiler::Stop()
+{
+	if (!Active) return;
+	if (Stack.Size() > 0)
+	{
+		// Script code is still running. Stop when it returns.
+		StopPending = true;
+		return;
+	}
+
+	TMap<VMFunction *, FHook>::Iterator it(Hooks);
+	TMap<VMFunction *, FHook>::Pair *pair;
+	while (it.NextPair(pair))
+	{
+		pair->Key->ScriptCall = pair->Value.Entry;
+	}
+	Hooks.Clear();
+	ProfiledNS = I_nsTime() - StartTime;
+	Active = false;
+	StopPending = false;
+}
+
+// The functions are about to be deleted.
+void FVMProfiler::Clear()
+{
+	Hooks.Clear();
+	Functions.Clear();
+	Nodes.Clear();
+	NodeMap.Clear();
+	LineSamples.Clear();
+	Stack.Clear();
+	Active = StopPending = false;
+}
+
+//==========================================================================
+//
+//
+//
+//==========================================================================
+
+void FVMProfiler::Report(int count)
+{
+	struct FStat
+	{
+		unsigned Func;
+		uint64_t Calls, SelfNS, TotalNS;
+	};
+
+	TArray<FStat> stats(Functions.Size(), true);
+	for (unsigned i = 0; i < Functions.Size(); i++) stats[i] = { i, 0, 0, 0 };
+
+	for (unsigned i = 0; i < Nodes.Size(); i++)
+	{
+		auto &node = Nodes[i];
+		auto &stat = stats[node.Func];
+		stat.Calls += node.Calls;
+		stat.SelfNS += node.SelfNS;
+
+		// Recursive calls are already included in the outermost call's total.
+		bool recursive = false;
+		for (int p = node.Parent; p >= 0 && !recursive; p = Nodes[p].Parent)
+		{
+			recursive = Nodes[p].Func == node.Func;
+		}
+		if (!recursive) stat.TotalNS += node.TotalNS;
+	}
+	std::sort(stats.begin(), stats.end(), [](const FStat &a, const FStat &b) { return a.SelfNS > b.SelfNS; });
+
+	uint64_t elapsed = Active ? I_nsTime() - StartTime : ProfiledNS;
+	Printf(TEXTCOLOR_YELLOW "Script profile over %.1f seconds:\n", elapsed / 1e9);
+	Printf(TEXTCOLOR_YELLOW "%10s %10s %10s  %s\n", "calls", "self ms", "total ms", "function");
+	for (unsigned i = 0; i < stats.Size() && i < (unsigned)count && stats[i].Calls > 0; i++)
+	{
+		auto &stat = stats[i];
+		Printf("%10llu %10.2f %10.2f  %s\n", (unsigned long long)stat.Calls, stat.SelfNS / 1e6, stat.TotalNS / 1e6, Functions[stat.Func]->PrintableName.GetChars());
+	}
+
+	if (LineSamples.CountUsed() > 0)
+	{
+		TArray<std::pair<uint64_t, uint64_t>> lines;
+		uint64_t total = 0;
+		TMap<uint64_t, uint64_t>::Iterator it(LineSamples);
+		TMap<uint64_t, uint64_t>::Pair *pair;
+		while (it.NextPair(pair))
+		{
+			lines.Push({ pair->Key, pair->Value });
+			total += pair->Value;
+		}
+		std::sort(lines.begin(), lines.end(), [](const std::pair<uint64_t, uint64_t> &a, const std::pair<uint64_t, uint64_t> &b) { return a.second > b.second; });
+
+		Printf(TEXTCOLOR_YELLOW "%10s %10s  %s\n", "samples", "percent", "line");
+		for (unsigned i = 0; i < lines.Size() && i < (unsigned)count; i++)
+		{
+			auto func = static_cast<VMScriptFunction *>(Functions[unsigned(lines[i].first >> 32)]);
+			Printf("%10llu %9.2f%%  %s:%u (%s)\n", (unsigned long long)lines[i].second, lines[i].second * 100. / total,
+				func->SourceFileName.GetChars(), unsigned(lines[i].first), func->PrintableName.GetChars());
+		}
+	}
+}
+
+//==========================================================================
+//
+// Writes one line per call stack with the time spent in the innermost
+// function in microseconds, e.g. "Actor.Tick;Actor.A_Chase 1234"
+//
+//==========================================================================
+
+void FVMProfiler::Dump(const char *filename)
+{
+	FILE *f = fopen(filename, "w");
+	if (f == nullptr)
+	{
+		Printf("Could not write profile to %s\n", filename);
+		return;
+	}
+	for (unsigned i = 0; i < Nodes.Size(); i++)
+	{
+		uint64_t us = Nodes[i].SelfNS / 1000;
+		if (us > 0)
+		{
+			fprintf(f, "%s %llu\n", GetStackName(i).GetChars(), (unsigned long long)us);
+		}
+	}
+	fclose(f);
+	Printf("Profile written to %s\n", filename);
+}
+
+//==========================================================================
+//
+// interface for the interpreter and the JIT
+//
+//==========================================================================
+
+void VMProfileSampleLine(VMScriptFunction *func, const VMOP *pc)
+{
+	VMProfileCountdown = LINE_SAMPLE_INTERVAL;
+	VMProfiler.SampleLine(func, pc);
+}
+
+void VMProfileClear()
+{
+	VMProfiler.Clear();
+}
+
+// Called when the code a function should run with changes, so that the
+// function stays hooked while the profiler is active.
+bool VMProfileSetEntry(VMFunction *func, JitFuncPtr entry)
+{
+	return VMProfiler.Active && VMProfiler.SetEntry(func, entry);
+}
+
+//==========================================================================
+//
+//
+//
+//==========================================================================
+
+CCMD(vm_profile)
+{
+	if (argv.argc() >= 2 && !stricmp(argv[1], "start"))
+	{
+		VMProfiler.Start(argv.argc() >= 3 && !stricmp(argv[2], "lines"));
+	}
+	else if (argv.argc() >= 2 && !stricmp(argv[1], "stop"))
+	{
+		VMProfiler.Stop();
+	}
+	else if (argv.argc() >= 2 && !stricmp(argv[1], "report"))
+	{
+		VMProfiler.Report(argv.argc() >= 3 ? atoi(argv[2]) : 20);
+	}
+	else if (argv.argc() >= 3 && !stricmp(argv[1], "dump"))
+	{
+		VMProfiler.Dump(argv[2]);
+	}
+	else
+	{
+		Printf("Usage: vm_profile start [lines] | stop | report [count] | dump <file>\n");
+	}
+}
@@ -84,6 +84,7 @@ public:
 	FPCXTexture (int lumpnum, PCXHeader &);
 
 	int CopyPixels(FBitmap *bmp, int conversion) override;
+	bool CanDecodeConcurrently() const override { return true; }
 
 protected:
 	void ReadPCX1bit (uint8_t *dst, FileReader & lump, PCXHeader *hdr);
@@ -350,7 +351,7 @@ TArray<uint8_t> FPCXTexture::CreatePalettedPixels(int conversion)
 	PCXHeader header;
 	int bitcount;
 
-	auto lump = fileSystem.OpenFileReader(SourceLump);
+	auto lump = OpenSourceReader();
 
 	lump.Read(&header, sizeof(header));
 
@@ -439,7 +440,7 @@ int FPCXTexture::CopyPixels(FBitmap *bmp, int conversion)
 	int bitcount;
 	TArray<uint8_t> Pixels;
 
-	auto lump = fileSystem.OpenFileReader(SourceLump);
+	auto lump = OpenSourceReader();
 
 	lump.Read(&header, sizeof(header));
 
@@ -56,6 +56,7 @@ public:
 	FPNGTexture (FileReader &lump, int lumpnum, int width, int height, uint8_t bitdepth, uint8_t colortype, uint8_t interlace);
 
 	int CopyPixels(FBitmap *bmp, int conversion) override;
+	bool CanDecodeConcurrently() const override { return true; }
 	TArray<uint8_t> CreatePalettedPixels(int conversion) override;
 
 protected:
@@ -376,7 +377,7 @@ TArray<uint8_t> FPNGTexture::CreatePalettedPixels(int conversion)
 	FileReader *lump;
 	FileReader lfr;
 
-	lfr = fileSystem.OpenFileReader(SourceLump);
+	lfr = OpenSourceReader();
 	lump = &lfr;
 
 	TArray<uint8_t> Pixels(Width*Height, true);
@@ -524,7 +525,7 @@ int FPNGTexture::CopyPixels(FBitmap *bmp, int conversion)
 	FileReader *lump;
 	FileReader lfr;
 
-	lfr = fileSystem.OpenFileReader(SourceLump);
+	lfr = OpenSourceReader();
 	lump = &lfr;
 
 	lump->Seek(33, FileReader::SeekSet);
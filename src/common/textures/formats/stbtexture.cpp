@@ -69,6 +69,7 @@ public:
 	FStbTexture (int lumpnum, int w, int h);
 	TArray<uint8_t> CreatePalettedPixels(int conversion) override;
 	int CopyPixels(FBitmap *bmp, int conversion) override;
+	bool CanDecodeConcurrently() const override { return true; }
 };
 
 
@@ -158,7 +159,7 @@ TArray<uint8_t> FStbTexture::CreatePalettedPixels(int conversion)
 
 int FStbTexture::CopyPixels(FBitmap *bmp, int conversion)
 {
-	auto lump = fileSystem.OpenFileReader (SourceLump); 
+	auto lump = OpenSourceReader(); 
 	int x, y, chan;
 	auto image = stbi_load_from_callbacks(&callbacks, &lump, &x, &y, &chan, STBI_rgb_alpha); 	
 	if (image)
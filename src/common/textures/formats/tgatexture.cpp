@@ -80,6 +80,7 @@ public:
 	FTGATexture (int lumpnum, TGAHeader *);
 
 	int CopyPixels(FBitmap *bmp, int conversion) override;
+	bool CanDecodeConcurrently() const override { return true; }
 
 protected:
 	void ReadCompressed(FileReader &lump, uint8_t * buffer, int bytesperpixel);
@@ -180,7 +181,7 @@ void FTGATexture::ReadCompressed(FileReader &lump, uint8_t * buffer, int bytespe
 TArray<uint8_t> FTGATexture::CreatePalettedPixels(int conversion)
 {
 	uint8_t PaletteMap[256];
-	auto lump = fileSystem.OpenFileReader (SourceLump);
+	auto lump = OpenSourceReader();
 	TGAHeader hdr;
 	uint16_t w;
 	uint8_t r,g,b,a;
@@ -387,7 +388,7 @@ TArray<uint8_t> FTGATexture::CreatePalettedPixels(int conversion)
 int FTGATexture::CopyPixels(FBitmap *bmp, int conversion)
 {
 	PalEntry pe[256];
-	auto lump = fileSystem.OpenFileReader (SourceLump);
+	auto lump = OpenSourceReader();
 	TGAHeader hdr;
 	uint16_t w;
 	uint8_t r,g,b,a;
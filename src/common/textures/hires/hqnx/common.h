@@ -24,6 +24,9 @@
 
 #include <stdlib.h>
 #include <stdint.h>
+#ifndef NO_SSE
+#include <immintrin.h>
+#endif
 
 #define MASK_2     0x0000FF00
 #define MASK_13    0x00FF00FF
@@ -58,6 +61,51 @@ static inline int Diff(uint32_t c1, uint32_t c2)
     return yuv_diff(rgb_to_yuv(c1), rgb_to_yuv(c2));
 }
 
+/* Classify the 3x3 block in w[1..9]: bit n of the result is set if the n-th
+ * neighbour, counting from w[1] and skipping the center, differs from w[5]. */
+static inline int hqx_pattern_c(const uint32_t *w)
+{
+    int pattern = 0;
+    int flag = 1;
+    uint32_t yuv1 = rgb_to_yuv(w[5]);
+
+    for (int k = 1; k <= 9; k++)
+    {
+        if (k == 5) continue;
+
+        if (w[k] != w[5] && yuv_diff(yuv1, rgb_to_yuv(w[k])))
+            pattern |= flag;
+        flag <<= 1;
+    }
+    return pattern;
+}
+
+#ifndef NO_SSE
+/* Same as above for all eight neighbours at once. Y, U and V each have a
+ * byte of their own in the table's values so the threshold tests become
+ * saturated byte differences. The table's top byte never counts. A
+ * neighbour equal to the center looks up the same value and thus never
+ * differs, which is what the scalar version's shortcut does, too. */
+static inline int hqx_pattern_sse2(const uint32_t *w)
+{
+    const __m128i center = _mm_set1_epi32(rgb_to_yuv(w[5]));
+    const __m128i thresh = _mm_set1_epi32(0xff300706);
+    const __m128i zero = _mm_setzero_si128();
+
+    __m128i a = _mm_setr_epi32(rgb_to_yuv(w[1]), rgb_to_yuv(w[2]), rgb_to_yuv(w[3]), rgb_to_yuv(w[4]));
+    __m128i b = _mm_setr_epi32(rgb_to_yuv(w[6]), rgb_to_yuv(w[7]), rgb_to_yuv(w[8]), rgb_to_yuv(w[9]));
+    a = _mm_subs_epu8(_mm_or_si128(_mm_subs_epu8(a, center), _mm_subs_epu8(center, a)), thresh);
+    b = _mm_subs_epu8(_mm_or_si128(_mm_subs_epu8(b, center), _mm_subs_epu8(center, b)), thresh);
+
+    int same = _mm_movemask_ps(_mm_castsi128_ps(_mm_cmpeq_epi32(a, zero))) |
+        (_mm_movemask_ps(_mm_castsi128_ps(_mm_cmpeq_epi32(b, zero))) << 4);
+    return ~same & 255;
+}
+#define hqx_pattern hqx_pattern_sse2
+#else
+#define hqx_pattern hqx_pattern_c
+#endif
+
 /* Interpolate functions */
 static inline uint32_t Interpolate_2(uint32_t c1, int w1, uint32_t c2, int w2, int s)
 {
@@ -47,6 +47,9 @@ HQX_API void HQX_CALLCONV hqxInit(void);
 HQX_API void HQX_CALLCONV hq2x_32( uint32_t * src, uint32_t * dest, int width, int height );
 HQX_API void HQX_CALLCONV hq3x_32( uint32_t * src, uint32_t * dest, int width, int height );
 HQX_API void HQX_CALLCONV hq4x_32( uint32_t * src, uint32_t * dest, int width, int height );
+HQX_API void HQX_CALLCONV hq2x_32_c( uint32_t * src, uint32_t * dest, int width, int height );
+HQX_API void HQX_CALLCONV hq3x_32_c( uint32_t * src, uint32_t * dest, int width, int height );
+HQX_API void HQX_CALLCONV hq4x_32_c( uint32_t * src, uint32_t * dest, int width, int height );
 
 HQX_API void HQX_CALLCONV hq2x_32_rb( uint32_t * src, uint32_t src_rowBytes, uint32_t * dest, uint32_t dest_rowBytes, int width, int height );
 HQX_API void HQX_CALLCONV hq3x_32_rb( uint32_t * src, uint32_t src_rowBytes, uint32_t * dest, uint32_t dest_rowBytes, int width, int height );
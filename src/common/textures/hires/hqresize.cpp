@@ -45,6 +45,12 @@
 #include "textures.h"
 #include "texturemanager.h"
 #include "printf.h"
+#include "md5.h"
+#include "stats.h"
+#include "bitmap.h"
+#include "c_dispatch.h"
+#include "filesystem.h"
+#include "hqnx/common.h"
 
 int upscalemask;
 
@@ -314,6 +320,17 @@ static unsigned char *hqNxAsmHelper( void (*hqNxFunction) ( int*, unsigned char*
 }
 #endif
 
+static void EnsureHqxInit()
+{
+	static bool initdone = false;
+
+	if (!initdone)
+	{
+		hqxInit();
+		initdone = true;
+	}
+}
+
 static unsigned char *hqNxHelper( void (HQX_CALLCONV *hqNxFunction) ( unsigned*, unsigned*, int, int ),
 							  const int N,
 							  unsigned char *inputBuffer,
@@ -322,13 +339,7 @@ static unsigned char *hqNxHelper( void (HQX_CALLCONV *hqNxFunction) ( unsigned*,
 							  int &outWidth,
 							  int &outHeight )
 {
-	static int initdone = false;
-
-	if (!initdone)
-	{
-		hqxInit();
-		initdone = true;
-	}
+	EnsureHqxInit();
 	outWidth = N * inWidth;
 	outHeight = N *inHeight;
 
@@ -405,12 +416,104 @@ static unsigned char *xbrzHelper( void (*xbrzFunction) ( size_t, const uint32_t*
 	return newBuffer;
 }
 
+//===========================================================================
+// 
+// The disk cache key covers the source pixels and everything that affects
+// the upscaler's output for them.
+//
+//===========================================================================
+
+EXTERN_CVAR(Int, gl_texture_hqresize_diskcache)
+unsigned char *LoadUpscaledTexture(const uint8_t *key, int width, int height);
+void StoreUpscaledTexture(const uint8_t *key, const unsigned char *buffer, int width, int height);
+
+static void GetUpscaleCacheKey(const unsigned char *buffer, int width, int height, int type, int mult, uint8_t *key)
+{
+	struct
+	{
+		int width, height, type, mult;
+		int colorformat;
+		float xbrz[5];
+	} params;
+	memset(&params, 0, sizeof(params));
+	params.width = width;
+	params.height = height;
+	params.type = type;
+	params.mult = mult;
+	if (type == 4 || type == 5)
+	{
+		params.colorformat = xbrz_colorformat;
+		params.xbrz[0] = xbrz_luminanceweight;
+		params.xbrz[1] = xbrz_equalcolortolerance;
+		params.xbrz[2] = xbrz_centerdirectionbias;
+		params.xbrz[3] = xbrz_dominantdirectionthreshold;
+		params.xbrz[4] = xbrz_steepdirectionthreshold;
+	}
+
+	MD5Context md5;
+	md5.Update((const uint8_t *)&params, sizeof(params));
+	md5.Update(buffer, unsigned(width * height * 4));
+	md5.Final(key);
+}
+
 static void xbrzOldScale(size_t factor, const uint32_t* src, uint32_t* trg, int srcWidth, int srcHeight, xbrz::ColorFormat colFmt, const xbrz_old::ScalerCfg& cfg, int yFirst, int yLast)
 {
 	xbrz_old::scale(factor, src, trg, srcWidth, srcHeight, cfg, yFirst, yLast);
 }
 
 
+//===========================================================================
+// 
+// Runs the given upscaler on buffer, which gets freed. Returns nullptr,
+// leaving buffer alone, if the combination of type and factor is not
+// supported.
+//
+//===========================================================================
+
+static unsigned char *UpscaleBuffer(int type, int mult, unsigned char *buffer, int inWidth, int inHeight, int &outWidth, int &outHeight)
+{
+	if (type == 1)
+	{
+		if (mult == 2)
+			return scaleNxHelper(&scale2x, 2, buffer, inWidth, inHeight, outWidth, outHeight);
+		else if (mult == 3)
+			return scaleNxHelper(&scale3x, 3, buffer, inWidth, inHeight, outWidth, outHeight);
+		else if (mult == 4)
+			return scaleNxHelper(&scale4x, 4, buffer, inWidth, inHeight, outWidth, outHeight);
+		else return nullptr;
+	}
+	else if (type == 2)
+	{
+		if (mult == 2)
+			return hqNxHelper(&hq2x_32, 2, buffer, inWidth, inHeight, outWidth, outHeight);
+		else if (mult == 3)
+			return hqNxHelper(&hq3x_32, 3, buffer, inWidth, inHeight, outWidth, outHeight);
+		else if (mult == 4)
+			return hqNxHelper(&hq4x_32, 4, buffer, inWidth, inHeight, outWidth, outHeight);
+		else return nullptr;
+	}
+#ifdef HAVE_MMX
+	else if (type == 3)
+	{
+		if (mult == 2)
+			return hqNxAsmHelper(&HQnX_asm::hq2x_32, 2, buffer, inWidth, inHeight, outWidth, outHeight);
+		else if (mult == 3)
+			return hqNxAsmHelper(&HQnX_asm::hq3x_32, 3, buffer, inWidth, inHeight, outWidth, outHeight);
+		else if (mult == 4)
+			return hqNxAsmHelper(&HQnX_asm::hq4x_32, 4, buffer, inWidth, inHeight, outWidth, outHeight);
+		else return nullptr;
+	}
+#endif
+	else if (type == 4)
+		return xbrzHelper(xbrz::scale, mult, buffer, inWidth, inHeight, outWidth, outHeight);
+	else if (type == 5)
+		return xbrzHelper(xbrzOldScale, mult, buffer, inWidth, inHeight, outWidth, outHeight);
+	else if (type == 6)
+		return normalNx(mult, buffer, inWidth, inHeight, outWidth, outHeight);
+	else
+		return nullptr;
+}
+
 //===========================================================================
 // 
 // [BB] Upsamples the texture in texbuffer.mBuffer, frees texbuffer.mBuffer and returns
@@ -441,46 +544,28 @@ void FTexture::CreateUpsampledTextureBuffer(FTextureBuffer &texbuffer, bool hasA
 
 	if (!checkonly)
 	{
-		if (type == 1)
+		uint8_t key[16];
+		unsigned char *cached = nullptr;
+		if (gl_texture_hqresize_diskcache > 0)
 		{
-			if (mult == 2)
-				texbuffer.mBuffer = scaleNxHelper(&scale2x, 2, texbuffer.mBuffer, inWidth, inHeight, texbuffer.mWidth, texbuffer.mHeight);
-			else if (mult == 3)
-				texbuffer.mBuffer = scaleNxHelper(&scale3x, 3, texbuffer.mBuffer, inWidth, inHeight, texbuffer.mWidth, texbuffer.mHeight);
-			else if (mult == 4)
-				texbuffer.mBuffer = scaleNxHelper(&scale4x, 4, texbuffer.mBuffer, inWidth, inHeight, texbuffer.mWidth, texbuffer.mHeight);
-			else return;
+			GetUpscaleCacheKey(texbuffer.mBuffer, inWidth, inHeight, type, mult, key);
+			cached = LoadUpscaledTexture(key, inWidth * mult, inHeight * mult);
 		}
-		else if (type == 2)
+
+		if (cached != nullptr)
 		{
-			if (mult == 2)
-				texbuffer.mBuffer = hqNxHelper(&hq2x_32, 2, texbuffer.mBuffer, inWidth, inHeight, texbuffer.mWidth, texbuffer.mHeight);
-			else if (mult == 3)
-				texbuffer.mBuffer = hqNxHelper(&hq3x_32, 3, texbuffer.mBuffer, inWidth, inHeight, texbuffer.mWidth, texbuffer.mHeight);
-			else if (mult == 4)
-				texbuffer.mBuffer = hqNxHelper(&hq4x_32, 4, texbuffer.mBuffer, inWidth, inHeight, texbuffer.mWidth, texbuffer.mHeight);
-			else return;
+			delete[] texbuffer.mBuffer;
+			texbuffer.mBuffer = cached;
+			texbuffer.mWidth = inWidth * mult;
+			texbuffer.mHeight = inHeight * mult;
 		}
-#ifdef HAVE_MMX
-		else if (type == 3)
+		else
 		{
-			if (mult == 2)
-				texbuffer.mBuffer = hqNxAsmHelper(&HQnX_asm::hq2x_32, 2, texbuffer.mBuffer, inWidth, inHeight, texbuffer.mWidth, texbuffer.mHeight);
-			else if (mult == 3)
-				texbuffer.mBuffer = hqNxAsmHelper(&HQnX_asm::hq3x_32, 3, texbuffer.mBuffer, inWidth, inHeight, texbuffer.mWidth, texbuffer.mHeight);
-			else if (mult == 4)
-				texbuffer.mBuffer = hqNxAsmHelper(&HQnX_asm::hq4x_32, 4, texbuffer.mBuffer, inWidth, inHeight, texbuffer.mWidth, texbuffer.mHeight);
-			else return;
+			auto buffer = UpscaleBuffer(type, mult, texbuffer.mBuffer, inWidth, inHeight, texbuffer.mWidth, texbuffer.mHeight);
+			if (buffer == nullptr) return;
+			texbuffer.mBuffer = buffer;
+			if (gl_texture_hqresize_diskcache > 0) StoreUpscaledTexture(key, texbuffer.mBuffer, texbuffer.mWidth, texbuffer.mHeight);
 		}
-#endif
-		else if (type == 4)
-			texbuffer.mBuffer = xbrzHelper(xbrz::scale, mult, texbuffer.mBuffer, inWidth, inHeight, texbuffer.mWidth, texbuffer.mHeight);
-		else if (type == 5)
-			texbuffer.mBuffer = xbrzHelper(xbrzOldScale, mult, texbuffer.mBuffer, inWidth, inHeight, texbuffer.mWidth, texbuffer.mHeight);
-		else if (type == 6)
-			texbuffer.mBuffer = normalNx(mult, texbuffer.mBuffer, inWidth, inHeight, texbuffer.mWidth, texbuffer.mHeight);
-		else
-			return;
 	}
 	else
 	{
@@ -518,4 +603,109 @@ int calcShouldUpscale(FGameTexture *tex)
 		return 0;
 
 	return CTF_Upscale;
-}
\ No newline at end of file
+}
+
+//===========================================================================
+// 
+// Times all upscalers on the IWAD's sprites and checks the vectorized
+// hqNx pattern classification and the scalers' output against the plain
+// C version.
+//
+//===========================================================================
+
+CCMD(bench_hqresize)
+{
+	TArray<FBitmap> sprites;
+	size_t pixels = 0;
+	for (int i = 0; i < TexMan.NumTextures(); i++)
+	{
+		auto gtex = TexMan.GameByIndex(i);
+		if (gtex == nullptr || !gtex->isValid() || gtex->GetUseType() != ETextureType::Sprite) continue;
+		int lump = gtex->GetSourceLump();
+		if (lump < 0 || fileSystem.GetFileContainer(lump) != fileSystem.GetIwadNum()) continue;
+
+		auto &bmp = sprites[sprites.Reserve(1)];
+		bmp = gtex->GetTexture()->GetBgraBitmap(nullptr);
+		pixels += size_t(bmp.GetWidth()) * bmp.GetHeight();
+	}
+	if (sprites.Size() == 0)
+	{
+		Printf("No sprites found\n");
+		return;
+	}
+	Printf("%u sprites, %zu pixels\n", sprites.Size(), pixels);
+
+	EnsureHqxInit();
+	size_t mismatches = 0;
+	for (auto &bmp : sprites)
+	{
+		int width = bmp.GetWidth(), height = bmp.GetHeight();
+		auto src = (const uint32_t *)bmp.GetPixels();
+		for (int y = 1; y < height - 1; y++)
+		{
+			for (int x = 1; x < width - 1; x++)
+			{
+				uint32_t w[10];
+				for (int k = 0; k < 9; k++) w[k + 1] = src[(y + k / 3 - 1) * width + x + k % 3 - 1];
+				if (hqx_pattern(w) != hqx_pattern_c(w)) mismatches++;
+			}
+		}
+	}
+	Printf("hqNx pattern mismatches: %zu\n", mismatches);
+
+	static void (HQX_CALLCONV *const hqfuncs[][2])(uint32_t *, uint32_t *, int, int) =
+	{
+		{ hq2x_32, hq2x_32_c },
+		{ hq3x_32, hq3x_32_c },
+		{ hq4x_32, hq4x_32_c },
+	};
+	for (int n = 0; n < 3; n++)
+	{
+		mismatches = 0;
+		for (auto &bmp : sprites)
+		{
+			int width = bmp.GetWidth(), height = bmp.GetHeight();
+			size_t outsize = size_t(width) * height * (n + 2) * (n + 2);
+			TArray<uint32_t> out(outsize, true), outc(outsize, true);
+			auto src = (uint32_t *)bmp.GetPixels();
+			hqfuncs[n][0](src, out.Data(), width, height);
+			hqfuncs[n][1](src, outc.Data(), width, height);
+			for (size_t i = 0; i < outsize; i++)
+			{
+				if (out[i] != outc[i]) mismatches++;
+			}
+		}
+		Printf("hq%dx output mismatches: %zu\n", n + 2, mismatches);
+	}
+
+	static const char *names[] = { nullptr, "ScaleNx", "hqNx", "hqNx MMX", "xBRZ", "Old xBRZ", "NormalNx" };
+	for (int type = 1; type <= 6; type++)
+	{
+		for (int mult = 2; mult <= (type < 4 ? 4 : 6); mult++)
+		{
+			cycle_t timer;
+			timer.Reset();
+			bool supported = true;
+			for (auto &bmp : sprites)
+			{
+				int width = bmp.GetWidth(), height = bmp.GetHeight(), outwidth, outheight;
+				auto buffer = new unsigned char[width * height * 4];
+				memcpy(buffer, bmp.GetPixels(), width * height * 4);
+				timer.Clock();
+				auto result = UpscaleBuffer(type, mult, buffer, width, height, outwidth, outheight);
+				timer.Unclock();
+				if (result == nullptr)
+				{
+					delete[] buffer;
+					supported = false;
+					break;
+				}
+				delete[] result;
+			}
+			if (supported)
+			{
+				Printf("%-9s %dx: %8.2f ms, %7.2f Mpixels/s\n", names[type], mult, timer.TimeMS(), pixels / (timer.TimeMS() * 1000.));
+			}
+		}
+	}
+}
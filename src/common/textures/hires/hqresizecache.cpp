@@ -0,0 +1,348 @@
+//-----------------------------------------------------------------------------
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see http://www.gnu.org/licenses/
+//
+//-----------------------------------------------------------------------------
+//
+// DESCRIPTION:
+//		Disk cache for upscaled textures.
+//
+//		Each result is stored in its own file in the cache directory, named
+//		after a hash of the source pixels and all settings that affect the
+//		upscaler's output, so a changed texture or setting simply misses.
+//		Files get written by a worker thread so that storing a result does
+//		not add to the stall it is supposed to remove. A cache hit touches
+//		its file, and when the cache grows beyond
+//		gl_texture_hqresize_diskcache megabytes the least recently used
+//		files are deleted.
+//
+//		The worker must not create or destroy any FString, so all paths
+//		are built on the main thread and handed over as std::strings.
+//
+//-----------------------------------------------------------------------------
+
+#include <stdio.h>
+#include <time.h>
+#include <zlib.h>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <vector>
+#include <string>
+#include <memory>
+#include <algorithm>
+#ifndef _WIN32
+#include <utime.h>
+#else
+#include <sys/utime.h>
+#endif
+
+#include "c_cvars.h"
+#include "cmdlib.h"
+#include "files.h"
+#include "i_specialpaths.h"
+
+CUSTOM_CVAR(Int, gl_texture_hqresize_diskcache, 256, CVAR_ARCHIVE | CVAR_GLOBALCONFIG)
+{
+	if (self < 0) self = 0;
+}
+
+static const char UpscaleMagic[4] = { 'U', 'P', 'S', 'C' };
+static const uint32_t UpscaleVersion = 1;
+
+struct FUpscaleFileHeader
+{
+	char Magic[4];
+	uint32_t Version;
+	uint8_t Key[16];
+	uint32_t Width;
+	uint32_t Height;
+	uint32_t CompressedSize;
+	uint32_t Reserved;
+};
+
+static FString UpscaleFileName(const uint8_t *key)
+{
+	FString path = M_GetCachePath(false);
+	path << "/upscaled/";
+	for (int i = 0; i < 16; i++) path.AppendFormat("%02x", key[i]);
+	path << ".ups";
+	return path;
+}
+
+// The directory scan and UpscaleFileName may spell the directory differently.
+static const char *UpscaleFileBase(const std::string &path)
+{
+	auto slash = path.find_last_of("/\\");
+	return path.c_str() + (slash == std::string::npos ? 0 : slash + 1);
+}
+
+static void TouchFile(const char *path)
+{
+#ifndef _WIN32
+	utime(path, nullptr);
+#else
+	_wutime(WideString(path).c_str(), nullptr);
+#endif
+}
+
+class FUpscaleCacheWriter
+{
+	enum
+	{
+		MAX_PENDING_BYTES = 64 << 20
+	};
+
+	struct FItem
+	{
+		std::string Path;
+		size_t Limit;
+		uint8_t Key[16];
+		int Width, Height;
+		TArray<uint8_t> Pixels;
+	};
+
+	struct FCacheFile
+	{
+		std::string Name;
+		size_t Size;
+		time_t Time;
+	};
+
+	std::mutex Mutex;
+	std::condition_variable WorkAvailable;
+	std::vector<std::thread> Threads;
+	std::vector<FItem> Pending;
+	std::vector<std::string> Touched;
+	size_t PendingBytes = 0;
+	bool StopWorkers = false;
+
+	// Filled by Scan before the worker starts and only touched by the worker after that.
+	// Ordered from least to most recently used.
+	std::vector<FCacheFile> Files;
+	size_t CacheBytes = 0;
+
+	void WorkerMain()
+	{
+		std::unique_lock<std::mutex> lock(Mutex);
+		while (true)
+		{
+			WorkAvailable.wait(lock, [&]() { return StopWorkers || Pending.size() > 0 || Touched.size() > 0; });
+			if (StopWorkers) break;
+
+			if (Touched.size() > 0)
+			{
+				std::vector<std::string> touched = std::move(Touched);
+				Touched.clear();
+				lock.unlock();
+
+				for (auto &path : touched) Touch(path);
+			}
+			else
+			{
+				FItem item = std::move(Pending.back());
+				Pending.pop_back();
+				PendingBytes -= item.Pixels.Size();
+				lock.unlock();
+
+				Write(item);
+			}
+
+			lock.lock();
+		}
+	}
+
+	// Runs on the main thread before the worker gets started.
+	void Scan()
+	{
+		FString dir = M_GetCachePath(true) + "/upscaled/";
+		CreatePath(dir);
+
+		TArray<FFileList> list;
+		ScanDirectory(list, dir);
+		for (auto &entry : list)
+		{
+			FCacheFile file;
+			if (!entry.isDirectory && GetFileInfo(entry.Filename, &file.Size, &file.Time))
+			{
+				file.Name = entry.Filename.GetChars();
+				CacheBytes += file.Size;
+				Files.push_back(std::move(file));
+			}
+		}
+		std::sort(Files.begin(), Files.end(), [](const FCacheFile &a, const FCacheFile &b) { return a.Time < b.Time; });
+	}
+
+	// Marks a file as just used, both on disk for the next session's scan and in the index.
+	void Touch(const std::string &path)
+	{
+		TouchFile(path.c_str());
+
+		const char *base = UpscaleFileBase(path);
+		for (size_t i = Files.size(); i-- > 0; )
+		{
+			if (!strcmp(UpscaleFileBase(Files[i].Name), base))
+			{
+				FCacheFile file = std::move(Files[i]);
+				Files.erase(Files.begin() + i);
+				Files.push_back(std::move(file));
+				break;
+			}
+		}
+	}
+
+	void Write(const FItem &item)
+	{
+		uLongf compressedsize = compressBound(item.Pixels.Size());
+		TArray<uint8_t> compressed(compressedsize, true);
+		if (compress2(compressed.Data(), &compressedsize, item.Pixels.Data(), item.Pixels.Size(), 1) != Z_OK) return;
+
+		FUpscaleFileHeader header;
+		memcpy(header.Magic, UpscaleMagic, 4);
+		header.Version = UpscaleVersion;
+		memcpy(header.Key, item.Key, 16);
+		header.Width = item.Width;
+		header.Height = item.Height;
+		header.CompressedSize = (uint32_t)compressedsize;
+		header.Reserved = 0;
+
+		FCacheFile file = { item.Path, sizeof(header) + compressedsize, time(nullptr) };
+		std::unique_ptr<FileWriter> fw(FileWriter::Open(file.Name.c_str()));
+		if (!fw) return;
+		bool ok = fw->Write(&header, sizeof(header)) == sizeof(header) && fw->Write(compressed.Data(), compressedsize) == compressedsize;
+		fw.reset();
+		if (!ok)
+		{
+			remove(file.Name.c_str());
+			return;
+		}
+		CacheBytes += file.Size;
+		Files.push_back(std::move(file));
+
+		// Trim to 90% so that this does not have to run for every file once the cache is full.
+		size_t limit = item.Limit;
+		if (CacheBytes > limit)
+		{
+			size_t i = 0;
+			while (i < Files.size() && CacheBytes > limit / 10 * 9)
+			{
+				remove(Files[i].Name.c_str());
+				CacheBytes -= Files[i].Size;
+				i++;
+			}
+			Files.erase(Files.begin(), Files.begin() + i);
+		}
+	}
+
+	// Must be called with the mutex held.
+	void StartWorker()
+	{
+		if (Threads.empty())
+		{
+			Scan();
+			Threads.push_back(std::thread([=]() { WorkerMain(); }));
+		}
+	}
+
+public:
+	~FUpscaleCacheWriter()
+	{
+		// Whatever has not been written yet is dropped. It will be created again next time.
+		{
+			std::lock_guard<std::mutex> lock(Mutex);
+			StopWorkers = true;
+		}
+		WorkAvailable.notify_all();
+		for (auto &thread : Threads) thread.join();
+	}
+
+	void Add(const uint8_t *key, const unsigned char *buffer, int width, int height)
+	{
+		size_t size = size_t(width) * height * 4;
+		FString path = UpscaleFileName(key);
+
+		std::unique_lock<std::mutex> lock(Mutex);
+		if (PendingBytes + size > MAX_PENDING_BYTES) return;
+		StartWorker();
+
+		Pending.emplace_back();
+		auto &item = Pending.back();
+		item.Path = path.GetChars();
+		item.Limit = size_t(*gl_texture_hqresize_diskcache) << 20;
+		memcpy(item.Key, key, 16);
+		item.Width = width;
+		item.Height = height;
+		item.Pixels.Resize((unsigned)size);
+		memcpy(item.Pixels.Data(), buffer, size);
+		PendingBytes += size;
+		WorkAvailable.notify_one();
+	}
+
+	void MarkUsed(const FString &path)
+	{
+		std::unique_lock<std::mutex> lock(Mutex);
+		StartWorker();
+		Touched.push_back(path.GetChars());
+		WorkAvailable.notify_one();
+	}
+};
+
+static FUpscaleCacheWriter UpscaleCacheWriter;
+
+//==========================================================================
+//
+// Returns the upscaled pixels for the key or nullptr if there are none.
+// The returned buffer must be freed with delete[].
+//
+//==========================================================================
+
+unsigned char *LoadUpscaledTexture(const uint8_t *key, int width, int height)
+{
+	FileReader fr;
+	FString path = UpscaleFileName(key);
+	if (!fr.OpenFile(path)) return nullptr;
+
+	FUpscaleFileHeader header;
+	if (fr.Read(&header, sizeof(header)) != sizeof(header) ||
+		memcmp(header.Magic, UpscaleMagic, 4) != 0 || header.Version != UpscaleVersion || memcmp(header.Key, key, 16) != 0 ||
+		header.Width != (uint32_t)width || header.Height != (uint32_t)height ||
+		header.CompressedSize != fr.GetLength() - sizeof(header))
+	{
+		return nullptr;
+	}
+
+	TArray<uint8_t> compressed = fr.Read(header.CompressedSize);
+	if (compressed.Size() != header.CompressedSize) return nullptr;
+
+	uLongf size = uLongf(width) * height * 4;
+	auto buffer = new unsigned char[size];
+	if (uncompress(buffer, &size, compressed.Data(), compressed.Size()) != Z_OK || size != uLongf(width) * height * 4)
+	{
+		delete[] buffer;
+		return nullptr;
+	}
+	UpscaleCacheWriter.MarkUsed(path);
+	return buffer;
+}
+
+//==========================================================================
+//
+// Queues the upscaled pixels for writing to the cache.
+//
+//==========================================================================
+
+void StoreUpscaledTexture(const uint8_t *key, const unsigned char *buffer, int width, int height)
+{
+	UpscaleCacheWriter.Add(key, buffer, width, height);
+}
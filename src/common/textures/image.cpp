@@ -40,6 +40,9 @@
 #include "files.h"
 #include "cmdlib.h"
 #include "palettecontainer.h"
+#include "c_cvars.h"
+#include "stats.h"
+#include "parallel_for.h"
 
 FMemArena ImageArena(32768);
 TArray<FImageSource *>FImageSource::ImageForLump;
@@ -51,6 +54,7 @@ struct PrecacheDataPaletted
 	TArray<uint8_t> Pixels;
 	int RefCount;
 	int ImageID;
+	unsigned LastUse;
 };
 
 struct PrecacheDataRgba
@@ -59,11 +63,118 @@ struct PrecacheDataRgba
 	int TransInfo;
 	int RefCount;
 	int ImageID;
+	unsigned LastUse;
 };
 
-// TMap doesn't handle this kind of data well.  std::map neither. The linear search is still faster, even for a few 100 entries because it doesn't have to access the heap as often..
-TArray<PrecacheDataPaletted> precacheDataPaletted;
-TArray<PrecacheDataRgba> precacheDataRgba;
+// The entries are kept in an array, which is what the eviction scan walks, and found through a map from
+// the image ID to the array index. TMap doesn't handle this kind of data well as a direct value.
+template<class T>
+struct TPrecacheStore
+{
+	TArray<T> Entries;
+	TMap<int, unsigned> Index;
+
+	T *Find(int imageID)
+	{
+		auto pindex = Index.CheckKey(imageID);
+		return pindex ? &Entries[*pindex] : nullptr;
+	}
+
+	T &Add(int imageID)
+	{
+		unsigned index = Entries.Reserve(1);
+		Index[imageID] = index;
+		Entries[index].ImageID = imageID;
+		return Entries[index];
+	}
+
+	// The order of the entries does not matter so the last one fills the hole.
+	void Delete(unsigned index)
+	{
+		unsigned last = Entries.Size() - 1;
+		Index.Remove(Entries[index].ImageID);
+		if (index != last)
+		{
+			Entries[index] = std::move(Entries[last]);
+			Index[Entries[index].ImageID] = index;
+		}
+		Entries.Pop();
+	}
+
+	void Delete(T *entry)
+	{
+		Delete(unsigned(entry - Entries.Data()));
+	}
+
+	void Clear()
+	{
+		Entries.Clear();
+		Index.Clear();
+	}
+};
+
+static TPrecacheStore<PrecacheDataPaletted> precacheDataPaletted;
+static TPrecacheStore<PrecacheDataRgba> precacheDataRgba;
+static TArray<FImageSource *> precacheImages;
+
+//===========================================================================
+// 
+// The precache data shares the cache_budget with the lump cache. If a new
+// entry does not fit, the lump cache gets trimmed first and then the least
+// recently used entries get dropped. Images that get requested again after
+// their entry was dropped are simply created anew.
+//
+//===========================================================================
+
+EXTERN_CVAR(Int, cache_budget)
+
+static size_t PrecacheBytes;
+static unsigned PrecacheUse;
+static unsigned PrecacheHits, PrecacheMisses, PrecacheEvictions, PrecacheDecoded;
+
+static size_t PrecacheSize(const PrecacheDataPaletted &entry) { return entry.Pixels.Size(); }
+static size_t PrecacheSize(const PrecacheDataRgba &entry) { return size_t(entry.Pixels.GetPitch()) * entry.Pixels.GetHeight(); }
+
+static bool ReservePrecacheData(size_t size)
+{
+	size_t budget = size_t(*cache_budget) << 20;
+	if (size > budget / 4) return false;
+
+	while (TrimLumpCache(PrecacheBytes + size) + PrecacheBytes + size > budget)
+	{
+		unsigned oldest = UINT_MAX, pal = UINT_MAX, rgba = UINT_MAX;
+		for (unsigned i = 0; i < precacheDataPaletted.Entries.Size(); i++)
+		{
+			if (precacheDataPaletted.Entries[i].LastUse < oldest) oldest = precacheDataPaletted.Entries[i].LastUse, pal = i;
+		}
+		for (unsigned i = 0; i < precacheDataRgba.Entries.Size(); i++)
+		{
+			if (precacheDataRgba.Entries[i].LastUse < oldest) oldest = precacheDataRgba.Entries[i].LastUse, rgba = i, pal = UINT_MAX;
+		}
+		if (rgba != UINT_MAX)
+		{
+			PrecacheBytes -= PrecacheSize(precacheDataRgba.Entries[rgba]);
+			precacheDataRgba.Delete(rgba);
+		}
+		else if (pal != UINT_MAX)
+		{
+			PrecacheBytes -= PrecacheSize(precacheDataPaletted.Entries[pal]);
+			precacheDataPaletted.Delete(pal);
+		}
+		else return false;
+		PrecacheEvictions++;
+	}
+	PrecacheBytes += size;
+	return true;
+}
+
+ADD_STAT(imagecache)
+{
+	FString out;
+	out.Format("Images: %u  Size: %zuK  Hits: %u  Misses: %u  Evictions: %u  Decoded ahead: %u",
+		precacheDataPaletted.Entries.Size() + precacheDataRgba.Entries.Size(), (PrecacheBytes + 1023) >> 10, PrecacheHits, PrecacheMisses, PrecacheEvictions, PrecacheDecoded);
+	return out;
+}
 
 //===========================================================================
 // 
@@ -89,10 +200,11 @@ PalettedPixels FImageSource::GetCachedPalettedPixels(int conversion)
 	auto imageID = ImageID;
 
 	// Do we have this image in the cache?
-	unsigned index = conversion != normal? UINT_MAX : precacheDataPaletted.FindEx([=](PrecacheDataPaletted &entry) { return entry.ImageID == imageID; });
-	if (index < precacheDataPaletted.Size())
+	auto cache = conversion != normal? nullptr : precacheDataPaletted.Find(imageID);
+	if (cache != nullptr)
 	{
-		auto cache = &precacheDataPaletted[index];
+		cache->LastUse = ++PrecacheUse;
+		PrecacheHits++;
 
 		if (cache->RefCount > 1)
 		{
@@ -103,9 +215,10 @@ PalettedPixels FImageSource::GetCachedPalettedPixels(int conversion)
 		else if (cache->Pixels.Size() > 0)
 		{
 			//Printf("returning contents of %s, refcount = %d\n", name.GetChars(), cache->RefCount);
+			PrecacheBytes -= PrecacheSize(*cache);
 			ret.PixelStore = std::move(cache->Pixels);
 			ret.Pixels.Set(ret.PixelStore.Data(), ret.PixelStore.Size());
-			precacheDataPaletted.Delete(index);
+			precacheDataPaletted.Delete(cache);
 		}
 		else
 		{
@@ -116,7 +229,8 @@ PalettedPixels FImageSource::GetCachedPalettedPixels(int conversion)
 	{
 		// The image wasn't cached. Now there's two possibilities: 
 		auto info = precacheInfo.CheckKey(ImageID);
-		if (!info || info->second <= 1 || conversion != normal)
+		if (info && conversion == normal) PrecacheMisses++;
+		if (!info || info->second <= 1 || conversion != normal || !ReservePrecacheData(size_t(Width) * Height))
 		{
 			// This is either the only copy needed or some access outside the caching block. In these cases create a new one and directly return it.
 			//Printf("returning fresh copy of %s\n", name.GetChars());
@@ -127,13 +241,17 @@ PalettedPixels FImageSource::GetCachedPalettedPixels(int conversion)
 		{
 			//Printf("creating cached entry for %s, refcount = %d\n", name.GetChars(), info->second);
 			// This is the first time it gets accessed and needs to be placed in the cache.
-			PrecacheDataPaletted *pdp = &precacheDataPaletted[precacheDataPaletted.Reserve(1)];
-
-			pdp->ImageID = imageID;
-			pdp->RefCount = info->second - 1;
+			// The entry only gets added once the pixels exist, because creating them may add or evict other entries.
+			int refcount = info->second - 1;
 			info->second = 0;
-			pdp->Pixels = CreatePalettedPixels(normal);
-			ret.Pixels.Set(pdp->Pixels.Data(), pdp->Pixels.Size());
+			auto pixels = CreatePalettedPixels(normal);
+
+			PrecacheDataPaletted &pdp = precacheDataPaletted.Add(imageID);
+			pdp.RefCount = refcount;
+			pdp.Pixels = std::move(pixels);
+			pdp.LastUse = ++PrecacheUse;
+			PrecacheBytes = PrecacheBytes - size_t(Width) * Height + PrecacheSize(pdp);
+			ret.Pixels.Set(pdp.Pixels.Data(), pdp.Pixels.Size());
 		}
 	}
 	return ret;
@@ -216,10 +334,11 @@ FBitmap FImageSource::GetCachedBitmap(const PalEntry *remap, int conversion, int
 	{
 		if (conversion == luminance) conversion = normal;	// luminance has no meaning for true color.
 		// Do we have this image in the cache?
-		unsigned index = conversion != normal? UINT_MAX : precacheDataRgba.FindEx([=](PrecacheDataRgba &entry) { return entry.ImageID == imageID; });
-		if (index < precacheDataRgba.Size())
+		auto cache = conversion != normal? nullptr : precacheDataRgba.Find(imageID);
+		if (cache != nullptr)
 		{
-			auto cache = &precacheDataRgba[index];
+			cache->LastUse = ++PrecacheUse;
+			PrecacheHits++;
 			
 			trans = cache->TransInfo;
 			if (cache->RefCount > 1)
@@ -231,8 +350,9 @@ FBitmap FImageSource::GetCachedBitmap(const PalEntry *remap, int conversion, int
 			else if (cache->Pixels.GetPixels())
 			{
 				//Printf("returning contents of %s, refcount = %d\n", name.GetChars(), cache->RefCount);
+				PrecacheBytes -= PrecacheSize(*cache);
 				ret = std::move(cache->Pixels);
-				precacheDataRgba.Delete(index);
+				precacheDataRgba.Delete(cache);
 			}
 			else
 			{
@@ -246,7 +366,8 @@ FBitmap FImageSource::GetCachedBitmap(const PalEntry *remap, int conversion, int
 		{
 			// The image wasn't cached. Now there's two possibilities:
 			auto info = precacheInfo.CheckKey(ImageID);
-			if (!info || info->first <= 1 || conversion != normal)
+			if (info && conversion == normal) PrecacheMisses++;
+			if (!info || info->first <= 1 || conversion != normal || !ReservePrecacheData(size_t(Width) * Height * 4))
 			{
 				// This is either the only copy needed or some access outside the caching block. In these cases create a new one and directly return it.
 				//Printf("returning fresh copy of %s\n", name.GetChars());
@@ -257,14 +378,20 @@ FBitmap FImageSource::GetCachedBitmap(const PalEntry *remap, int conversion, int
 			{
 				//Printf("creating cached entry for %s, refcount = %d\n", name.GetChars(), info->first);
 				// This is the first time it gets accessed and needs to be placed in the cache.
-				PrecacheDataRgba *pdr = &precacheDataRgba[precacheDataRgba.Reserve(1)];
-				
-				pdr->ImageID = imageID;
-				pdr->RefCount = info->first - 1;
+				// The entry only gets added once the pixels exist, because creating them may add or evict other entries.
+				int refcount = info->first - 1;
 				info->first = 0;
-				pdr->Pixels.Create(Width, Height);
-				trans = pdr->TransInfo = CopyPixels(&pdr->Pixels, normal);
-				ret.Copy(pdr->Pixels, false);
+				FBitmap pixels;
+				pixels.Create(Width, Height);
+				trans = CopyPixels(&pixels, normal);
+
+				PrecacheDataRgba &pdr = precacheDataRgba.Add(imageID);
+				pdr.RefCount = refcount;
+				pdr.TransInfo = trans;
+				pdr.Pixels = std::move(pixels);
+				pdr.LastUse = ++PrecacheUse;
+				PrecacheBytes = PrecacheBytes - size_t(Width) * Height * 4 + PrecacheSize(pdr);
+				ret.Copy(pdr.Pixels, false);
 			}
 		}
 	}
@@ -291,18 +418,126 @@ void FImageSource::CollectForPrecache(PrecacheInfo &info, bool requiretruecolor)
 	{
 		auto pair = std::make_pair(tc, !tc);
 		info.Insert(ImageID, pair);
+		if (&info == &precacheInfo) precacheImages.Push(this);
 	}
 }
 
 void FImageSource::BeginPrecaching()
 {
 	precacheInfo.Clear();
+	precacheImages.Clear();
 }
 
 void FImageSource::EndPrecaching()
 {
 	precacheDataPaletted.Clear();
 	precacheDataRgba.Clear();
+	precacheImages.Clear();
+	PrecacheBytes = 0;
+}
+
+//==========================================================================
+//
+// Decodes the true color images registered for precaching on all cores
+// and puts them into the cache, so that creating the textures afterward
+// only has to pick them up. The file system may only be used by the main
+// thread, so the lumps get read there first and the decoders of images
+// that support it get their data from memory through OpenSourceReader.
+// Everything that cannot be done this way is created on demand as before.
+//
+//==========================================================================
+
+static thread_local FileData *DecodeSource;
+
+FileReader FImageSource::OpenSourceReader()
+{
+	FileReader fr;
+	if (DecodeSource != nullptr) fr.OpenMemory(DecodeSource->GetMem(), DecodeSource->GetSize());
+	else fr = fileSystem.OpenFileReader(SourceLump);
+	return fr;
+}
+
+void FImageSource::DecodeForPrecache()
+{
+	enum
+	{
+		MAX_BATCH_IMAGES = 256,
+		MAX_BATCH_BYTES = 32 << 20
+	};
+
+	struct FDecodeJob
+	{
+		FImageSource *Image;
+		FileData Data;
+		FBitmap Pixels;
+		int TransInfo;
+		bool Failed;
+	};
+
+	size_t budget = size_t(*cache_budget) << 20;
+	TArray<FDecodeJob> jobs;
+	size_t batchbytes = 0;
+
+	auto runbatch = [&]()
+	{
+		parallel_for(int(jobs.Size()), [&](int i)
+		{
+			auto &job = jobs[i];
+			DecodeSource = &job.Data;
+			try
+			{
+				job.Pixels.Create(job.Image->Width, job.Image->Height);
+				job.TransInfo = job.Image->CopyPixels(&job.Pixels, normal);
+			}
+			catch (...)
+			{
+				job.Failed = true;
+			}
+			DecodeSource = nullptr;
+		});
+
+		for (auto &job : jobs)
+		{
+			size_t size = size_t(job.Image->Width) * job.Image->Height * 4;
+			auto info = precacheInfo.CheckKey(job.Image->ImageID);
+			if (job.Failed || info == nullptr)
+			{
+				// Will be created on demand, which also gets any error reported on the main thread.
+				PrecacheBytes -= size;
+				continue;
+			}
+			PrecacheDataRgba &pdr = precacheDataRgba.Add(job.Image->ImageID);
+			pdr.RefCount = info->first;
+			info->first = 0;
+			pdr.TransInfo = job.TransInfo;
+			pdr.Pixels = std::move(job.Pixels);
+			pdr.LastUse = ++PrecacheUse;
+			PrecacheBytes = PrecacheBytes - size + PrecacheSize(pdr);
+			PrecacheDecoded++;
+		}
+		jobs.Clear();
+		batchbytes = 0;
+	};
+
+	for (auto img : precacheImages)
+	{
+		auto info = precacheInfo.CheckKey(img->ImageID);
+		if (info == nullptr || info->first <= 0 || !img->CanDecodeConcurrently() || precacheDataRgba.Find(img->ImageID) != nullptr) continue;
+
+		// Leave room for the images that have to be created on demand and do not push out anything decoded before.
+		size_t size = size_t(img->Width) * img->Height * 4;
+		if (PrecacheBytes + size > budget / 2 || !ReservePrecacheData(size)) continue;
+
+		auto &job = jobs[jobs.Reserve(1)];
+		job.Image = img;
+		job.Data = fileSystem.ReadFile(img->SourceLump);
+		job.TransInfo = 0;
+		job.Failed = job.Data.GetSize() == 0;
+		batchbytes += job.Data.GetSize() + size;
+
+		if (jobs.Size() >= MAX_BATCH_IMAGES || batchbytes >= MAX_BATCH_BYTES) runbatch();
+	}
+	if (jobs.Size() > 0) runbatch();
 }
 
 void FImageSource::RegisterForPrecache(FImageSource *img, bool requiretruecolor)
@@ -6,6 +6,7 @@
 #include "memarena.h"
 
 class FImageSource;
+class FileReader;
 using PrecacheInfo = TMap<int, std::pair<int, int>>;
 extern FMemArena ImageArena;
 
@@ -55,6 +56,10 @@ protected:
 	virtual int CopyPixels(FBitmap *bmp, int conversion);			// This will always ignore 'luminance'.
 	int CopyTranslatedPixels(FBitmap *bmp, const PalEntry *remap);
 
+	// Images whose CopyPixels reads nothing but the source lump, and that through OpenSourceReader, can be decoded on worker threads by DecodeForPrecache.
+	virtual bool CanDecodeConcurrently() const { return false; }
+	FileReader OpenSourceReader();
+
 
 public:
 	virtual bool SupportRemap0() { return false; }		// Unfortunate hackery that's needed for Hexen's skies. Only the image can know about the needed parameters
@@ -146,6 +151,7 @@ public:
 	static void BeginPrecaching();
 	static void EndPrecaching();
 	static void RegisterForPrecache(FImageSource *img, bool requiretruecolor);
+	static void DecodeForPrecache();
 };
 
 
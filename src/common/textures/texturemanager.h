@@ -18,6 +18,7 @@ class FTextureManager
 {
 	void (*progressFunc)();
 	friend class FxAddSub;	// needs access to do a bounds check on the texture ID.
+	friend class FVMCodeCache;	// needs to relocate said bounds check.
 public:
 	FTextureManager ();
 	~FTextureManager ();
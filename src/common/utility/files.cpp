@@ -33,6 +33,18 @@
 **
 */
 
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+#include <limits.h>
+
 #include "files.h"
 #include "templates.h"	// just for 'clamp'
 #include "zstring.h"
@@ -349,6 +361,84 @@ public:
 
 
 
+//==========================================================================
+//
+// MappedFileReader
+//
+// reads data from a file that has been mapped into memory as a whole.
+// Since GetBuffer returns the mapping, lumps of uncompressed archives
+// point straight into it and the pages get shared with the OS's file cache
+// and every other process that maps the same file. The mapping is private
+// copy-on-write so that code scribbling on a lump's cache cannot modify
+// the file.
+//
+//==========================================================================
+
+class MappedFileReader : public MemoryReader
+{
+	void *Mapping = nullptr;
+	size_t MappedSize = 0;
+
+public:
+	MappedFileReader() = default;
+
+	~MappedFileReader()
+	{
+		if (Mapping != nullptr)
+		{
+#ifdef _WIN32
+			UnmapViewOfFile(Mapping);
+#else
+			munmap(Mapping, MappedSize);
+#endif
+		}
+	}
+
+	bool Open(const char *filename)
+	{
+#ifdef _WIN32
+		HANDLE file = CreateFileW(WideString(filename).c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+		if (file == INVALID_HANDLE_VALUE) return false;
+
+		LARGE_INTEGER size;
+		if (!GetFileSizeEx(file, &size) || size.QuadPart <= 0 || size.QuadPart > LONG_MAX)
+		{
+			CloseHandle(file);
+			return false;
+		}
+		HANDLE map = CreateFileMappingW(file, nullptr, PAGE_WRITECOPY, 0, 0, nullptr);
+		CloseHandle(file);
+		if (map == nullptr) return false;
+
+		// The view keeps the mapping object and the file alive.
+		Mapping = MapViewOfFile(map, FILE_MAP_COPY, 0, 0, 0);
+		CloseHandle(map);
+		if (Mapping == nullptr) return false;
+		MappedSize = (size_t)size.QuadPart;
+#else
+		int fd = open(filename, O_RDONLY);
+		if (fd < 0) return false;
+
+		struct stat info;
+		if (fstat(fd, &info) != 0 || !S_ISREG(info.st_mode) || info.st_size <= 0 || info.st_size > LONG_MAX)
+		{
+			close(fd);
+			return false;
+		}
+		void *map = mmap(nullptr, (size_t)info.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+		close(fd);
+		if (map == MAP_FAILED) return false;
+		Mapping = map;
+		MappedSize = (size_t)info.st_size;
+#endif
+		bufptr = (const char *)Mapping;
+		Length = (long)MappedSize;
+		FilePos = 0;
+		return true;
+	}
+};
+
+
 //==========================================================================
 //
 // FileReader
@@ -370,6 +460,19 @@ bool FileReader::OpenFile(const char *filename, FileReader::Size start, FileRead
 	return true;
 }
 
+bool FileReader::OpenMappedFile(const char *filename)
+{
+	auto reader = new MappedFileReader;
+	if (!reader->Open(filename))
+	{
+		delete reader;
+		return false;
+	}
+	Close();
+	mReader = reader;
+	return true;
+}
+
 bool FileReader::OpenFilePart(FileReader &parent, FileReader::Size start, FileReader::Size length)
 {
 	auto reader = new FileReaderRedirect(parent, (long)start, (long)length);
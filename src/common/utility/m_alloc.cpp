@@ -44,9 +44,28 @@
 #include <malloc.h>
 #endif
 
+#include <atomic>
 #include "engineerrors.h"
 #include "m_alloc.h"
 
+static std::atomic<size_t> AllocCount, AllocBytes;
+
+static inline void M_CountAlloc(size_t size)
+{
+	AllocCount.fetch_add(1, std::memory_order_relaxed);
+	AllocBytes.fetch_add(size, std::memory_order_relaxed);
+}
+
+size_t M_GetAllocCount()
+{
+	return AllocCount.load(std::memory_order_relaxed);
+}
+
+size_t M_GetAllocBytes()
+{
+	return AllocBytes.load(std::memory_order_relaxed);
+}
+
 #ifndef _MSC_VER
 #define _NORMAL_BLOCK			0
 #define _malloc_dbg(s,b,f,l)	malloc(s)
@@ -57,6 +76,7 @@
 #if !defined(__solaris__) && !defined(__OpenBSD__)
 void *M_Malloc(size_t size)
 {
+	M_CountAlloc(size);
 	void *block = malloc(size);
 
 	if (block == NULL)
@@ -67,6 +87,7 @@ void *M_Malloc(size_t size)
 
 void *M_Realloc(void *memblock, size_t size)
 {
+	M_CountAlloc(size);
 	void *block = realloc(memblock, size);
 	if (block == NULL)
 	{
@@ -77,6 +98,7 @@ void *M_Realloc(void *memblock, size_t size)
 #else
 void *M_Malloc(size_t size)
 {
+	M_CountAlloc(size);
 	void *block = malloc(size+sizeof(size_t));
 
 	if (block == NULL)
@@ -94,6 +116,7 @@ void *M_Realloc(void *memblock, size_t size)
 	if(memblock == NULL)
 		return M_Malloc(size);
 
+	M_CountAlloc(size);
 	void *block = realloc(((size_t*) memblock)-1, size+sizeof(size_t));
 	if (block == NULL)
 	{
@@ -115,6 +138,7 @@ void *M_Realloc(void *memblock, size_t size)
 #if !defined(__solaris__) && !defined(__OpenBSD__)
 void *M_Malloc_Dbg(size_t size, const char *file, int lineno)
 {
+	M_CountAlloc(size);
 	void *block = _malloc_dbg(size, _NORMAL_BLOCK, file, lineno);
 
 	if (block == NULL)
@@ -125,6 +149,7 @@ void *M_Malloc_Dbg(size_t size, const char *file, int lineno)
 
 void *M_Realloc_Dbg(void *memblock, size_t size, const char *file, int lineno)
 {
+	M_CountAlloc(size);
 	void *block = _realloc_dbg(memblock, size, _NORMAL_BLOCK, file, lineno);
 	if (block == NULL)
 	{
@@ -135,6 +160,7 @@ void *M_Realloc_Dbg(void *memblock, size_t size, const char *file, int lineno)
 #else
 void *M_Malloc_Dbg(size_t size, const char *file, int lineno)
 {
+	M_CountAlloc(size);
 	void *block = _malloc_dbg(size+sizeof(size_t), _NORMAL_BLOCK, file, lineno);
 
 	if (block == NULL)
@@ -152,6 +178,7 @@ void *M_Realloc_Dbg(void *memblock, size_t size, const char *file, int lineno)
 	if(memblock == NULL)
 		return M_Malloc_Dbg(size, file, lineno);
 
+	M_CountAlloc(size);
 	void *block = _realloc_dbg(((size_t*) memblock)-1, size+sizeof(size_t), _NORMAL_BLOCK, file, lineno);
 
 	if (block == NULL)
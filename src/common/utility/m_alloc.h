@@ -80,4 +80,8 @@ inline void* M_Calloc(size_t v1, size_t v2)
 
 void M_Free (void *memblock);
 
+// Running totals of all M_Malloc and M_Realloc calls, for profiling purposes.
+size_t M_GetAllocCount();
+size_t M_GetAllocBytes();
+
 #endif //__M_ALLOC_H__
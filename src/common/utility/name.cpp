@@ -33,10 +33,14 @@
 */
 
 #include <string.h>
+#include <thread>
 #include "name.h"
 #include "superfasthash.h"
 #include "cmdlib.h"
 #include "m_alloc.h"
+#include "zstring.h"
+#include "tarray.h"
+#include "engineerrors.h"
 
 // MACROS ------------------------------------------------------------------
 
@@ -45,14 +49,11 @@
 // that is just large enough to hold it.
 #define BLOCK_SIZE			4096
 
-// How many entries to grow the NameArray by when it needs to grow.
-#define NAME_GROW_AMOUNT	256
-
 // TYPES -------------------------------------------------------------------
 
 // Name text is stored in a linked list of NameBlock structures. This
 // is really the header for the block, with the remainder of the block
-// being populated by text for names.
+// being populated by text for names. Each shard has its own list.
 
 struct FName::NameManager::NameBlock
 {
@@ -67,7 +68,6 @@ struct FName::NameManager::NameBlock
 // PRIVATE DATA DEFINITIONS ------------------------------------------------
 
 FName::NameManager FName::NameData;
-bool FName::NameManager::Inited;
 
 // Define the predefined names.
 static const char *PredefinedNames[] =
@@ -79,6 +79,36 @@ static const char *PredefinedNames[] =
 
 // CODE --------------------------------------------------------------------
 
+//==========================================================================
+//
+// FName :: GetString
+//
+// Returns the name's text as an FString that is shared by everything
+// asking for it, so that converting a name to a string never allocates
+// memory after the first time. The name must be valid. Like any FString,
+// the result must not be copied on several threads at once.
+//
+//==========================================================================
+
+const FString &FName::GetString() const
+{
+	auto &entry = NameData.GetEntry(Index);
+	FString *str = entry.String.load(std::memory_order_acquire);
+	if (str == nullptr)
+	{
+		auto newstr = new FString(entry.Text);
+		if (entry.String.compare_exchange_strong(str, newstr, std::memory_order_acq_rel))
+		{
+			str = newstr;
+		}
+		else
+		{
+			delete newstr;
+		}
+	}
+	return *str;
+}
+
 //==========================================================================
 //
 // FName :: NameManager :: FindName
@@ -91,37 +121,16 @@ static const char *PredefinedNames[] =
 
 int FName::NameManager::FindName (const char *text, bool noCreate)
 {
-	if (!Inited)
-	{
-		InitBuckets ();
-	}
-
 	if (text == NULL)
 	{
-		return 0;
-	}
-
-	unsigned int hash = MakeKey (text);
-	unsigned int bucket = hash % HASH_SIZE;
-	int scanner = Buckets[bucket];
-
-	// See if the name already exists.
-	while (scanner >= 0)
-	{
-		if (NameArray[scanner].Hash == hash && stricmp (NameArray[scanner].Text, text) == 0)
+		if (!Inited.load(std::memory_order_acquire))
 		{
-			return scanner;
+			InitBuckets ();
 		}
-		scanner = NameArray[scanner].NextHash;
-	}
-
-	// If we get here, then the name does not exist.
-	if (noCreate)
-	{
 		return 0;
 	}
 
-	return AddName (text, hash, bucket);
+	return FindName (text, strlen (text), noCreate);
 }
 
 //==========================================================================
@@ -133,7 +142,7 @@ int FName::NameManager::FindName (const char *text, bool noCreate)
 
 int FName::NameManager::FindName (const char *text, size_t textLen, bool noCreate)
 {
-	if (!Inited)
+	if (!Inited.load(std::memory_order_acquire))
 	{
 		InitBuckets ();
 	}
@@ -143,20 +152,45 @@ int FName::NameManager::FindName (const char *text, size_t textLen, bool noCreat
 		return 0;
 	}
 
+	return LookupName (text, textLen, noCreate);
+}
+
+//==========================================================================
+//
+// FName :: NameManager :: LookupName
+//
+// FindName for a table that is already set up.
+//
+//==========================================================================
+
+int FName::NameManager::LookupName (const char *text, size_t textLen, bool noCreate)
+{
 	unsigned int hash = MakeKey (text, textLen);
 	unsigned int bucket = hash % HASH_SIZE;
-	int scanner = Buckets[bucket];
 
-	// See if the name already exists.
-	while (scanner >= 0)
+	// Searches the chain from head down to, but not including, stop.
+	auto scan = [&](int head, int stop)
 	{
-		if (NameArray[scanner].Hash == hash &&
-			strnicmp (NameArray[scanner].Text, text, textLen) == 0 &&
-			NameArray[scanner].Text[textLen] == '\0')
+		for (int scanner = head; scanner != stop; )
 		{
-			return scanner;
+			auto &entry = GetEntry(scanner);
+			if (entry.Hash == hash &&
+				strnicmp (entry.Text, text, textLen) == 0 &&
+				entry.Text[textLen] == '\0')
+			{
+				return scanner;
+			}
+			scanner = entry.NextHash;
 		}
-		scanner = NameArray[scanner].NextHash;
+		return -1;
+	};
+
+	// See if the name already exists.
+	int head = Buckets[bucket].load(std::memory_order_acquire);
+	int found = scan(head, -1);
+	if (found >= 0)
+	{
+		return found;
 	}
 
 	// If we get here, then the name does not exist.
@@ -165,7 +199,20 @@ int FName::NameManager::FindName (const char *text, size_t textLen, bool noCreat
 		return 0;
 	}
 
-	return AddName (text, hash, bucket);
+	// Another thread may have added it since, so the entries in front of
+	// the ones already searched must be checked again with the lock held.
+	Shard &shard = Shards[bucket % NUM_SHARDS];
+	while (shard.Lock.test_and_set(std::memory_order_acquire))
+	{
+		std::this_thread::yield();
+	}
+	found = scan(Buckets[bucket].load(std::memory_order_relaxed), head);
+	if (found < 0)
+	{
+		found = AddName (text, textLen, hash, bucket);
+	}
+	shard.Lock.clear(std::memory_order_release);
+	return found;
 }
 
 //==========================================================================
@@ -173,64 +220,94 @@ int FName::NameManager::FindName (const char *text, size_t textLen, bool noCreat
 // FName :: NameManager :: InitBuckets
 //
 // Sets up the hash table and inserts all the default names into the table.
+// Threads that get here at the same time wait for the first one, and no
+// thread sees Inited set before the table is complete.
 //
 //==========================================================================
 
 void FName::NameManager::InitBuckets ()
 {
-	Inited = true;
-	memset (Buckets, -1, sizeof(Buckets));
-
-	// Register built-in names. 'None' must be name 0.
-	for (size_t i = 0; i < countof(PredefinedNames); ++i)
+	while (InitLock.test_and_set(std::memory_order_acquire))
+	{
+		std::this_thread::yield();
+	}
+	if (!Inited.load(std::memory_order_relaxed))
 	{
-		assert((0 == FindName(PredefinedNames[i], true)) && "Predefined name already inserted");
-		FindName (PredefinedNames[i], false);
+		for (auto &bucket : Buckets)
+		{
+			bucket.store(-1, std::memory_order_relaxed);
+		}
+
+		// Register built-in names. 'None' must be name 0.
+		for (size_t i = 0; i < countof(PredefinedNames); ++i)
+		{
+			size_t len = strlen(PredefinedNames[i]);
+			assert((0 == LookupName(PredefinedNames[i], len, true)) && "Predefined name already inserted");
+			LookupName (PredefinedNames[i], len, false);
+		}
+		Inited.store(true, std::memory_order_release);
 	}
+	InitLock.clear(std::memory_order_release);
 }
 
 //==========================================================================
 //
 // FName :: NameManager :: AddName
 //
-// Adds a new name to the name table.
+// Adds a new name to the name table. The lock of the bucket's shard must
+// be held.
 //
 //==========================================================================
 
-int FName::NameManager::AddName (const char *text, unsigned int hash, unsigned int bucket)
+int FName::NameManager::AddName (const char *text, size_t textLen, unsigned int hash, unsigned int bucket)
 {
 	char *textstore;
-	NameBlock *block = Blocks;
-	size_t len = strlen (text) + 1;
+	Shard &shard = Shards[bucket % NUM_SHARDS];
+	NameBlock *block = shard.Blocks;
+	size_t len = textLen + 1;
 
 	// Get a block large enough for the name. Only the first block in the
 	// list is ever considered for name storage.
 	if (block == NULL || block->NextAlloc + len >= BLOCK_SIZE)
 	{
-		block = AddBlock (len);
+		block = AddBlock (shard, len);
 	}
 
 	// Copy the string into the block.
 	textstore = (char *)block + block->NextAlloc;
-	strcpy (textstore, text);
+	memcpy (textstore, text, textLen);
+	textstore[textLen] = '\0';
 	block->NextAlloc += len;
 
-	// Add an entry for the name to the NameArray
-	if (NumNames >= MaxNames)
+	// Entries are stored in chunks that never move so that other threads
+	// can keep reading while the table grows.
+	int index = NumNames.fetch_add(1, std::memory_order_relaxed);
+	int chunk = index >> CHUNK_BITS;
+	if (chunk >= MAX_CHUNKS)
 	{
-		// If no names have been defined yet, make the first allocation
-		// large enough to hold all the predefined names.
-		MaxNames += MaxNames == 0 ? countof(PredefinedNames) + NAME_GROW_AMOUNT : NAME_GROW_AMOUNT;
-
-		NameArray = (NameEntry *)M_Realloc (NameArray, MaxNames * sizeof(NameEntry));
+		I_FatalError("Too many names");
+	}
+	NameEntry *entries = Chunks[chunk].load(std::memory_order_acquire);
+	if (entries == NULL)
+	{
+		auto newentries = new NameEntry[CHUNK_SIZE]();
+		if (Chunks[chunk].compare_exchange_strong(entries, newentries, std::memory_order_acq_rel))
+		{
+			entries = newentries;
+		}
+		else
+		{
+			delete[] newentries;
+		}
 	}
 
-	NameArray[NumNames].Text = textstore;
-	NameArray[NumNames].Hash = hash;
-	NameArray[NumNames].NextHash = Buckets[bucket];
-	Buckets[bucket] = NumNames;
+	auto &entry = entries[index & (CHUNK_SIZE - 1)];
+	entry.Text = textstore;
+	entry.Hash = hash;
+	entry.NextHash = Buckets[bucket].load(std::memory_order_relaxed);
+	Buckets[bucket].store(index, std::memory_order_release);
 
-	return NumNames++;
+	return index;
 }
 
 //==========================================================================
@@ -242,7 +319,7 @@ int FName::NameManager::AddName (const char *text, unsigned int hash, unsigned i
 //
 //==========================================================================
 
-FName::NameManager::NameBlock *FName::NameManager::AddBlock (size_t len)
+FName::NameManager::NameBlock *FName::NameManager::AddBlock (Shard &shard, size_t len)
 {
 	NameBlock *block;
 
@@ -253,8 +330,8 @@ FName::NameManager::NameBlock *FName::NameManager::AddBlock (size_t len)
 	}
 	block = (NameBlock *)M_Malloc (len);
 	block->NextAlloc = sizeof(NameBlock);
-	block->NextBlock = Blocks;
-	Blocks = block;
+	block->NextBlock = shard.Blocks;
+	shard.Blocks = block;
 	return block;
 }
 
@@ -272,20 +349,28 @@ FName::NameManager::~NameManager()
 
 	//C_ClearTabCommands();
 
-	for (block = Blocks; block != NULL; block = next)
+	for (auto &shard : Shards)
 	{
-		next = block->NextBlock;
-		M_Free (block);
+		for (block = shard.Blocks; block != NULL; block = next)
+		{
+			next = block->NextBlock;
+			M_Free (block);
+		}
+		shard.Blocks = NULL;
 	}
-	Blocks = NULL;
 
-	if (NameArray != NULL)
+	int numnames = NumNames.load(std::memory_order_relaxed);
+	for (int i = 0; i < numnames; i++)
+	{
+		delete GetEntry(i).String.load(std::memory_order_relaxed);
+	}
+	for (auto &chunk : Chunks)
 	{
-		M_Free (NameArray);
-		NameArray = NULL;
+		delete[] chunk.load(std::memory_order_relaxed);
+		chunk.store(NULL, std::memory_order_relaxed);
 	}
-	NumNames = MaxNames = 0;
-	memset (Buckets, -1, sizeof(Buckets));
+	NumNames.store(0, std::memory_order_relaxed);
+	Inited.store(false, std::memory_order_relaxed);
 }
 
 //==========================================================================
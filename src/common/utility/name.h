@@ -34,6 +34,7 @@
 #ifndef NAME_H
 #define NAME_H
 
+#include <atomic>
 #include "tarray.h"
 #include "zstring.h"
 
@@ -60,7 +61,8 @@ public:
  //   ~FName () {}	// Names can be added but never removed.
 
 	int GetIndex() const { return Index; }
-	const char *GetChars() const { return NameData.NameArray[Index].Text; }
+	const char *GetChars() const { return NameData.GetEntry(Index).Text; }
+	const FString &GetString() const;
 
 	FName &operator = (const char *text) { Index = NameData.FindName (text, false); return *this; }
 	FName& operator = (const FString& text) { Index = NameData.FindName(text.GetChars(), text.Len(), false); return *this; }
@@ -69,7 +71,8 @@ public:
 
 	int SetName (const char *text, bool noCreate=false) { return Index = NameData.FindName (text, noCreate); }
 
-	bool IsValidName() const { return (unsigned)Index < (unsigned)NameData.NumNames; }
+	bool IsValidName() const { return (unsigned)Index < (unsigned)GetNumNames(); }
+	static int GetNumNames() { return NameData.NumNames.load(std::memory_order_relaxed); }
 
 	// Note that the comparison operators compare the names' indices, not
 	// their text, so they cannot be used to do a lexicographical sort.
@@ -93,13 +96,21 @@ public:
 protected:
 	int Index;
 
+	friend class FNameBenchmark;	// bench_names in c_enginecmds.cpp
+
+	// Entries never move once they have been added and are immutable except
+	// for String, so they can be read without locking.
 	struct NameEntry
 	{
 		char *Text;
 		unsigned int Hash;
 		int NextHash;
+		std::atomic<FString *> String;
 	};
 
+	// Looking up a name is lock-free: a bucket's head gets published only
+	// after its new entry has been written. Adding a name locks only the
+	// shard the name's bucket belongs to.
 	struct NameManager
 	{
 		// No constructor because we can't ensure that it actually gets
@@ -107,20 +118,40 @@ protected:
 		// means this struct must only exist in the program's BSS section.
 		~NameManager();
 
-		enum { HASH_SIZE = 1024 };
+		enum
+		{
+			HASH_SIZE = 8192,
+			NUM_SHARDS = 64,
+			CHUNK_BITS = 12,
+			CHUNK_SIZE = 1 << CHUNK_BITS,
+			MAX_CHUNKS = 1024
+		};
 		struct NameBlock;
 
-		NameBlock *Blocks;
-		NameEntry *NameArray;
-		int NumNames, MaxNames;
-		int Buckets[HASH_SIZE];
+		struct Shard
+		{
+			std::atomic_flag Lock;
+			NameBlock *Blocks;
+		};
+
+		std::atomic<NameEntry *> Chunks[MAX_CHUNKS];
+		std::atomic<int> NumNames;
+		std::atomic<int> Buckets[HASH_SIZE];
+		Shard Shards[NUM_SHARDS];
+		std::atomic<bool> Inited;
+		std::atomic_flag InitLock;
+
+		NameEntry &GetEntry (int index) const
+		{
+			return Chunks[index >> CHUNK_BITS].load(std::memory_order_relaxed)[index & (CHUNK_SIZE - 1)];
+		}
 
 		int FindName (const char *text, bool noCreate);
 		int FindName (const char *text, size_t textlen, bool noCreate);
-		int AddName (const char *text, unsigned int hash, unsigned int bucket);
-		NameBlock *AddBlock (size_t len);
+		int LookupName (const char *text, size_t textlen, bool noCreate);
+		int AddName (const char *text, size_t textlen, unsigned int hash, unsigned int bucket);
+		NameBlock *AddBlock (Shard &shard, size_t len);
 		void InitBuckets ();
-		static bool Inited;
 	};
 
 	static NameManager NameData;
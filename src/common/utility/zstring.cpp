@@ -158,6 +158,32 @@ FString::~FString ()
 	Data()->Release();
 }
 
+void FString::ConstructEmptyArray(FString *strings, size_t count)
+{
+	NullString.RefCount += (int)count;
+	for (size_t i = 0; i < count; ++i)
+	{
+		strings[i].Chars = &NullString.Nothing[0];
+	}
+}
+
+void FString::DestroyArray(FString *strings, size_t count)
+{
+	int empty = 0;
+	for (size_t i = 0; i < count; ++i)
+	{
+		if (strings[i].Chars == &NullString.Nothing[0])
+		{
+			empty++;
+		}
+		else
+		{
+			strings[i].Data()->Release();
+		}
+	}
+	NullString.RefCount -= empty;
+}
+
 char *FString::LockNewBuffer(size_t len)
 {
 	Data()->Release();
@@ -325,12 +325,13 @@ public:
 	void Truncate (size_t newlen);
 	void Remove(size_t index, size_t remlen);
 
-	int Compare (const FString &other) const { return strcmp (Chars, other.Chars); }
+	// Shared and interned strings compare equal without looking at the text.
+	int Compare (const FString &other) const { return Chars == other.Chars ? 0 : strcmp (Chars, other.Chars); }
 	int Compare (const char *other) const { return strcmp (Chars, other); }
 	int Compare(const FString &other, int len) const { return strncmp(Chars, other.Chars, len); }
 	int Compare(const char *other, int len) const { return strncmp(Chars, other, len); }
 
-	int CompareNoCase (const FString &other) const { return stricmp (Chars, other.Chars); }
+	int CompareNoCase (const FString &other) const { return Chars == other.Chars ? 0 : stricmp (Chars, other.Chars); }
 	int CompareNoCase (const char *other) const { return stricmp (Chars, other); }
 	int CompareNoCase(const FString &other, int len) const { return strnicmp(Chars, other.Chars, len); }
 	int CompareNoCase(const char *other, int len) const { return strnicmp(Chars, other, len); }
@@ -346,6 +347,12 @@ public:
 	void Split(TArray<FString>& tokens, const FString &delimiter, EmptyTokenType keepEmpty = TOK_KEEPEMPTY) const;
 	void Split(TArray<FString>& tokens, const char *delimiter, EmptyTokenType keepEmpty = TOK_KEEPEMPTY) const;
 
+	// Constructs and destroys arrays of strings in raw memory, e.g. the VM's
+	// string registers. Empty strings share NullString, so its reference
+	// count gets adjusted once per array instead of once per string.
+	static void ConstructEmptyArray(FString *strings, size_t count);
+	static void DestroyArray(FString *strings, size_t count);
+
 protected:
 	const FStringData *Data() const { return (FStringData *)Chars - 1; }
 	FStringData *Data() { return (FStringData *)Chars - 1; }
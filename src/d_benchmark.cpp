@@ -0,0 +1,273 @@
+//-----------------------------------------------------------------------------
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see http://www.gnu.org/licenses/
+//
+//-----------------------------------------------------------------------------
+//
+// DESCRIPTION:
+//		Headless playsim benchmark.
+//
+//		-benchmark <tics> loads the start map (see -warp/-skill/-file),
+//		runs the given number of playsim tics with scripted input and
+//		without video, sound or networking, and writes a JSON report
+//		to -benchout <file> or to the console.
+//
+//		-benchinput <walk|idle> selects the scripted player input.
+//		Bots from -bots are spawned and run as usual.
+//
+//-----------------------------------------------------------------------------
+
+#include <algorithm>
+
+#include "rapidjson/rapidjson.h"
+#include "rapidjson/prettywriter.h"
+
+#include "d_benchmark.h"
+#include "doomstat.h"
+#include "d_event.h"
+#include "d_player.h"
+#include "g_game.h"
+#include "g_levellocals.h"
+#include "m_argv.h"
+#include "m_alloc.h"
+#include "m_random.h"
+#include "i_system.h"
+#include "stats.h"
+#include "version.h"
+#include "printf.h"
+#include "engineerrors.h"
+#include "dobjgc.h"
+#include "vm.h"
+#include "network/net.h"
+
+extern cycle_t ThinkCycles, ActionCycles, BotThinkCycles, BotSupportCycles;
+extern int ThinkCount;
+
+enum EBenchPhase
+{
+	BP_Tic,
+	BP_Thinkers,
+	BP_Actions,
+	BP_BotThink,
+	BP_BotSupport,
+	BP_GC,
+
+	NUM_BENCHPHASES
+};
+
+static const char *BenchPhaseNames[NUM_BENCHPHASES] =
+{
+	"tic", "thinkers", "actions", "botthink", "botsupport", "gc"
+};
+
+//==========================================================================
+//
+// Scripted player input. This is a fixed pattern so that two runs on the
+// same map always see the same sequence of commands: run around while
+// sweeping left and right, strafe, fire in bursts and press use now and then.
+//
+//==========================================================================
+
+static ticcmd_t D_BenchmarkInput(int tic, bool idle)
+{
+	ticcmd_t cmd;
+
+	if (idle)
+		return cmd;
+
+	cmd.ucmd.forwardmove = (tic % 280) < 210 ? (0x32 << 8) : -(0x19 << 8);
+	cmd.ucmd.sidemove = ((tic / 35) & 1) ? (0x28 << 8) : -(0x28 << 8);
+	cmd.ucmd.yaw = ((tic / 70) & 1) ? 320 : -320;
+	if ((tic % 35) < 10)
+		cmd.ucmd.buttons |= BT_ATTACK;
+	if ((tic % 105) == 0)
+		cmd.ucmd.buttons |= BT_USE;
+	return cmd;
+}
+
+//==========================================================================
+//
+//
+//
+//==========================================================================
+
+static double Percentile(const TArray<double> &sorted, double pct)
+{
+	if (sorted.Size() == 0)
+		return 0;
+	unsigned index = unsigned(pct * (sorted.Size() - 1) / 100. + 0.5);
+	return sorted[std::min(index, sorted.Size() - 1)];
+}
+
+static int CountActors()
+{
+	int count = 0;
+	auto it = primaryLevel->GetThinkerIterator<AActor>();
+	while (it.Next()) count++;
+	return count;
+}
+
+//==========================================================================
+//
+// D_RunBenchmark
+//
+//==========================================================================
+
+int D_RunBenchmark(int numtics)
+{
+	if (numtics <= 0)
+	{
+		Printf("-benchmark requires a positive number of tics\n");
+		return 1;
+	}
+
+	const char *inputmode = Args->CheckValue("-benchinput");
+	bool idle = inputmode != nullptr && !stricmp(inputmode, "idle");
+
+	// Without an explicit -rngseed every run must still start from the same state.
+	if (!Args->CheckParm("-rngseed"))
+	{
+		staticrngseed = 0;
+		use_staticrng = true;
+	}
+
+	try
+	{
+		G_InitNew(startmap, false);
+	}
+	catch (CRecoverableError &error)
+	{
+		Printf("Benchmark could not start map %s: %s\n", startmap.GetChars(), error.GetMessage());
+		return 1;
+	}
+	if (gamestate != GS_LEVEL)
+	{
+		Printf("Benchmark could not start map %s\n", startmap.GetChars());
+		return 1;
+	}
+
+	TArray<double> samples[NUM_BENCHPHASES];
+	for (auto &s : samples) s.Resize(numtics);
+
+	int startactors = CountActors();
+	size_t startallocs = M_GetAllocCount();
+	size_t startallocbytes = M_GetAllocBytes();
+	int starttic = gametic;
+
+	cycle_t total, phase;
+	total.Reset();
+	total.Clock();
+	for (int i = 0; i < numtics; i++)
+	{
+		phase.Reset();
+		phase.Clock();
+		network->WriteLocalInput(D_BenchmarkInput(i, idle));
+		network->BeginTic();
+		G_Ticker();
+		network->EndTic();
+		phase.Unclock();
+		samples[BP_Tic][i] = phase.TimeMS();
+
+		samples[BP_Thinkers][i] = ThinkCycles.TimeMS();
+		samples[BP_Actions][i] = ActionCycles.TimeMS();
+		samples[BP_BotThink][i] = BotThinkCycles.TimeMS();
+		samples[BP_BotSupport][i] = BotSupportCycles.TimeMS();
+
+		phase.Reset();
+		phase.Clock();
+		GC::CheckGC();
+		phase.Unclock();
+		samples[BP_GC][i] = phase.TimeMS();
+
+		if (gamestate != GS_LEVEL)
+		{
+			// The level was exited or the player died and got sent to the console.
+			numtics = i + 1;
+			for (auto &s : samples) s.Clamp(numtics);
+			break;
+		}
+	}
+	total.Unclock();
+
+	size_t allocs = M_GetAllocCount() - startallocs;
+	size_t allocbytes = M_GetAllocBytes() - startallocbytes;
+	double seconds = total.Time();
+
+	rapidjson::StringBuffer buffer;
+	rapidjson::PrettyWriter<rapidjson::StringBuffer> w(buffer);
+
+	w.StartObject();
+	w.Key("version");		w.String(GetVersionString());
+	w.Key("githash");		w.String(GetGitHash());
+	w.Key("map");			w.String(primaryLevel->MapName.GetChars());
+	w.Key("input");			w.String(idle ? "idle" : "walk");
+	w.Key("rngseed");		w.Uint(rngseed);
+	w.Key("tics");			w.Int(numtics);
+	w.Key("gametics");		w.Int(gametic - starttic);
+	w.Key("seconds");		w.Double(seconds);
+	w.Key("ticspersecond");	w.Double(seconds > 0 ? numtics / seconds : 0);
+	w.Key("actors");
+	w.StartObject();
+	w.Key("start");			w.Int(startactors);
+	w.Key("end");			w.Int(CountActors());
+	w.Key("thinkers");		w.Int(ThinkCount);
+	w.EndObject();
+	w.Key("phases");
+	w.StartObject();
+	for (int p = 0; p < NUM_BENCHPHASES; p++)
+	{
+		auto &s = samples[p];
+		double sum = 0;
+		for (auto v : s) sum += v;
+		std::sort(s.begin(), s.end());
+
+		w.Key(BenchPhaseNames[p]);
+		w.StartObject();
+		w.Key("totalms");	w.Double(sum);
+		w.Key("meanms");	w.Double(s.Size() > 0 ? sum / s.Size() : 0);
+		w.Key("p50ms");		w.Double(Percentile(s, 50));
+		w.Key("p90ms");		w.Double(Percentile(s, 90));
+		w.Key("p99ms");		w.Double(Percentile(s, 99));
+		w.Key("maxms");		w.Double(s.Size() > 0 ? s.Last() : 0);
+		w.EndObject();
+	}
+	w.EndObject();
+	w.Key("allocations");
+	w.StartObject();
+	w.Key("count");			w.Uint64(allocs);
+	w.Key("bytes");			w.Uint64(allocbytes);
+	w.Key("pertic");		w.Double(double(allocs) / numtics);
+	w.EndObject();
+	w.Key("peakmemory");	w.Uint64(I_GetPeakMemoryUsage());
+	w.EndObject();
+
+	const char *outname = Args->CheckValue("-benchout");
+	if (outname != nullptr)
+	{
+		FILE *f = fopen(outname, "w");
+		if (f == nullptr)
+		{
+			Printf("Could not write benchmark results to %s\n", outname);
+			return 1;
+		}
+		fputs(buffer.GetString(), f);
+		fputc('\n', f);
+		fclose(f);
+	}
+	else
+	{
+		Printf("%s\n", buffer.GetString());
+	}
+	return 0;
+}
@@ -0,0 +1,5 @@
+#pragma once
+
+// Headless playsim benchmark (-benchmark <tics>).
+// Returns the process exit code.
+int D_RunBenchmark(int numtics);
@@ -71,6 +71,9 @@
 #include "r_utility.h"
 #include "r_sky.h"
 #include "d_main.h"
+#include "d_benchmark.h"
+#include "d_startupprofile.h"
+#include "sc_man.h"
 #include "d_dehacked.h"
 #include "cmdlib.h"
 #include "v_text.h"
@@ -3218,6 +3221,7 @@ static int D_DoomMain_Internal (void)
 	const char *batchout = Args->CheckValue("-errorlog");
 	
 	C_InitConsole(80*8, 25*8, false);
+	D_StartupPhase("init");
 	I_DetectOS();
 
 	// +logfile gets checked too late to catch the full startup log in the logfile so do some extra check for it here.
@@ -3239,6 +3243,11 @@ static int D_DoomMain_Internal (void)
 		Printf("\n");
 	}
 
+	if (Args->CheckParm("-benchmark"))
+	{
+		nosound = true;
+	}
+
 	if (Args->CheckParm("-hashfiles"))
 	{
 		const char *filename = "fileinfo.txt";
@@ -3308,6 +3317,7 @@ static int D_DoomMain_Internal (void)
 		// Load zdoom.pk3 alone so that we can get access to the internal gameinfos before 
 		// the IWAD is known.
 
+		D_StartupPhase("iwad");
 		GetCmdLineFiles(pwads);
 		FString iwad = CheckGameInfo(pwads);
 
@@ -3334,6 +3344,7 @@ static int D_DoomMain_Internal (void)
 			I_FatalError ("You cannot -file with the shareware version. Register!");
 		}
 
+		D_StartupPhase("gamesetup");
 		FBaseCVar::DisableCallbacks();
 		GameConfig->DoGameSetup (gameinfo.ConfigName);
 
@@ -3369,6 +3380,7 @@ static int D_DoomMain_Internal (void)
 			Printf("Notice: File hashing is incredibly verbose. Expect loading files to take much longer than usual.\n");
 		}
 
+		D_StartupPhase("files");
 		if (!batchrun) Printf ("W_Init: Init WADfiles.\n");
 
 		LumpFilterInfo lfi;
@@ -3399,11 +3411,27 @@ static int D_DoomMain_Internal (void)
 			FindStrifeTeaserVoices(fileSystem);
 		};
 
+		ClearPrescannedScripts();
 		fileSystem.InitMultipleFiles (allwads, false, &lfi);
 		allwads.Clear();
 		allwads.ShrinkToFit();
 		SetMapxxFlag();
 
+		// Start inflating the definition lumps so that decompression overlaps with parsing them.
+		// They are listed roughly in the order they get read below.
+		static const char *startuplumps[] = { "DEFCVARS", "CVARINFO", "LANGUAGE", "TEXTURES", "ANIMDEFS", "MAPINFO", "ZMAPINFO",
+			"SNDINFO", "ZSCRIPT", "DECORATE", "GLDEFS", "DECALDEF", "TERRAIN", "SBARINFO", "MENUDEF", nullptr };
+		fileSystem.PrefetchFiles(startuplumps);
+		TArray<int> scriptlumps;
+		for (int i = 0; i < fileSystem.GetNumEntries(); i++)
+		{
+			const char *name = fileSystem.GetFileFullName(i);
+			const char *dot = strrchr(name, '.');
+			if (dot != nullptr && (!stricmp(dot, ".zs") || !stricmp(dot, ".zsc"))) scriptlumps.Push(i);
+		}
+		fileSystem.PrefetchFiles(scriptlumps);
+
+		D_StartupPhase("cvars");
 		D_GrabCVarDefaults(); //parse DEFCVARS
 
 		GameConfig->DoKeySetup(gameinfo.ConfigName);
@@ -3420,6 +3448,7 @@ static int D_DoomMain_Internal (void)
 		}
 
 		// [RH] Initialize localizable strings.
+		D_StartupPhase("strings");
 		GStrings.LoadStrings (language);
 
 		V_InitFontColors ();
@@ -3439,6 +3468,7 @@ static int D_DoomMain_Internal (void)
 		}
 
 		// [RH] Initialize palette management
+		D_StartupPhase("video");
 		InitPalette ();
 		
 		if (!batchrun) Printf ("V_Init: allocate screen.\n");
@@ -3462,9 +3492,18 @@ static int D_DoomMain_Internal (void)
 		// Base systems have been inited; enable cvar callbacks
 		FBaseCVar::EnableCallbacks ();
 
+		// Tokenize the text definitions on worker threads. The parsers still run one after another
+		// because they all write to shared engine state, but they get their lumps pre-lexed.
+		// This reads the lumps, so it waits until the prefetch jobs above had time to inflate them.
+		static const char *prescanlumps[] = { "SNDINFO", "MAPINFO", "ZMAPINFO", "TEXTURES", "ANIMDEFS", "TERRAIN",
+			"GLDEFS", "DOOMDEFS", "HTICDEFS", "HEXNDEFS", "STRFDEFS", "CHEXDEFS", "DECALDEF", "MENUDEF", nullptr };
+		PrescanScripts(prescanlumps);
+
+		D_StartupPhase("sound");
 		if (!batchrun) Printf ("S_Init: Setting up sound.\n");
 		S_Init ();
 
+		D_StartupPhase("startscreen");
 		if (!batchrun) Printf ("ST_Init: Init startup screen.\n");
 		if (!restart)
 		{
@@ -3498,6 +3537,7 @@ static int D_DoomMain_Internal (void)
 		CheckCmdLine();
 
 		// [RH] Load sound environments
+		D_StartupPhase("sounddata");
 		S_ParseReverbDef ();
 
 		// [RH] Parse any SNDINFO lumps
@@ -3505,6 +3545,7 @@ static int D_DoomMain_Internal (void)
 		S_InitData ();
 
 		// [RH] Parse through all loaded mapinfo lumps
+		D_StartupPhase("mapinfo");
 		if (!batchrun) Printf ("G_ParseMapInfo: Load map definitions.\n");
 		G_ParseMapInfo (iwad_info->MapInfo);
 		ReadStatistics();
@@ -3512,6 +3553,7 @@ static int D_DoomMain_Internal (void)
 		// MUSINFO must be parsed after MAPINFO
 		S_ParseMusInfo();
 
+		D_StartupPhase("textures");
 		if (!batchrun) Printf ("Texman.Init: Init texture manager.\n");
 		UpdateUpscaleMask();
 		SpriteFrames.Clear();
@@ -3521,18 +3563,24 @@ static int D_DoomMain_Internal (void)
 		C_InitConback();
 
 		StartScreen->Progress();
+		D_StartupPhase("fonts");
 		V_InitFonts();
 		V_LoadTranslations();
 		UpdateGenericUI(false);
 
 		// [CW] Parse any TEAMINFO lumps.
+		D_StartupPhase("teaminfo");
 		if (!batchrun) Printf ("ParseTeamInfo: Load team definitions.\n");
 		TeamLibrary.ParseTeamInfo ();
 
 		R_ParseTrnslate();
+
+		// This compiles ZScript and DECORATE.
+		D_StartupPhase("scripts");
 		PClassActor::StaticInit ();
 
 		// [GRB] Initialize player class list
+		D_StartupPhase("playerclasses");
 		SetupPlayerClasses ();
 
 		// [RH] Load custom key and weapon settings from WADs
@@ -3546,15 +3594,20 @@ static int D_DoomMain_Internal (void)
 
 		StartScreen->Progress ();
 
+		D_StartupPhase("gldefs");
 		ParseGLDefs();
 
+		D_StartupPhase("renderer");
 		if (!batchrun) Printf ("R_Init: Init %s refresh subsystem.\n", gameinfo.ConfigName.GetChars());
 		StartScreen->LoadingStatus ("Loading graphics", 0x3f);
 		R_Init ();
 
+		D_StartupPhase("decals");
 		if (!batchrun) Printf ("DecalLibrary: Load decals.\n");
 		DecalLibrary.ReadAllDecals ();
 
+		D_StartupPhase("dehacked");
+
 		// Load embedded Dehacked patches
 		D_LoadDehLumps(FromIWAD);
 
@@ -3584,9 +3637,15 @@ static int D_DoomMain_Internal (void)
 		// Create replacements for dehacked pickups
 		FinishDehPatch();
 
+		// All action functions are final now.
+		FState::BindDirectActions();
+
+		D_StartupPhase("menus");
 		if (!batchrun) Printf("M_Init: Init menus.\n");
 		M_Init();
 
+		D_StartupPhase("actornums");
+
 		// clean up the compiler symbols which are not needed any longer.
 		RemoveUnusedSymbols();
 
@@ -3604,6 +3663,7 @@ static int D_DoomMain_Internal (void)
 		primaryLevel->BotInfo.spawn_tries = 0;
 		primaryLevel->BotInfo.wanted_botnum = primaryLevel->BotInfo.getspawned.Size();
 
+		D_StartupPhase("playloop");
 		if (!batchrun) Printf ("P_Init: Init Playloop state.\n");
 		StartScreen->LoadingStatus ("Init game engine", 0x3f);
 		AM_StaticInit();
@@ -3612,6 +3672,7 @@ static int D_DoomMain_Internal (void)
 		P_SetupWeapons_ntohton();
 
 		//SBarInfo support. Note that the first SBARINFO lump contains the mugshot definition so it even needs to be read when a regular status bar is being used.
+		D_StartupPhase("sbarinfo");
 		SBarInfo::Load();
 
 		if (!batchrun)
@@ -3633,6 +3694,7 @@ static int D_DoomMain_Internal (void)
 
 		if (!restart)
 		{
+			D_StartupPhase("network");
 			if (!batchrun) Printf ("D_CheckNetGame: Checking network game status.\n");
 			StartScreen->LoadingStatus ("Checking network game status.", 0x3f);
 			if (!D_CheckNetGame ())
@@ -3642,6 +3704,7 @@ static int D_DoomMain_Internal (void)
 		}
 
 		// [SP] Force vanilla transparency auto-detection to re-detect our game lumps now
+		D_StartupPhase("commands");
 		UpdateVanillaTransparency();
 
 		// [RH] Lock any cvars that should be locked now that we're
@@ -3660,6 +3723,10 @@ static int D_DoomMain_Internal (void)
 		if (cl_customizeinvulmap)
 			R_UpdateInvulnerabilityColormap();
 
+		D_EndStartupProfile();
+		ClearPrescannedScripts();
+		fileSystem.ClearPrefetched();
+
 		if (!restart)
 		{
 			// start the apropriate game based on parms
@@ -3680,6 +3747,13 @@ static int D_DoomMain_Internal (void)
 				return 1337; // special exit
 			}
 
+			v = Args->CheckValue("-benchmark");
+			if (v != nullptr)
+			{
+				// This runs before V_Init2 so that no real video output gets set up.
+				return D_RunBenchmark(atoi(v));
+			}
+
 			V_Init2();
 			twod->fullscreenautoaspect = gameinfo.fullscreenautoaspect;
 			// Initialize the size of the 2D drawer so that an attempt to access it outside the draw code won't crash.
@@ -0,0 +1,189 @@
+//-----------------------------------------------------------------------------
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see http://www.gnu.org/licenses/
+//
+//-----------------------------------------------------------------------------
+//
+// DESCRIPTION:
+//		Startup phase profile.
+//
+//		-startupprofile [file] records wall and CPU time, allocations and
+//		lump bytes read for each phase of D_DoomMain and writes a JSON
+//		report to the file or to the console once startup is done.
+//
+//		The phases run one after the other, so together they make up the
+//		critical path of the startup. The report also lists them from the
+//		slowest down. A phase whose CPU time is well above its wall time
+//		already does work on other threads.
+//
+//-----------------------------------------------------------------------------
+
+#include <algorithm>
+
+#include "rapidjson/rapidjson.h"
+#include "rapidjson/prettywriter.h"
+
+#include "d_startupprofile.h"
+#include "m_argv.h"
+#include "m_alloc.h"
+#include "i_system.h"
+#include "stats.h"
+#include "version.h"
+#include "printf.h"
+#include "resourcefile.h"
+
+struct FStartupPhase
+{
+	const char *Name;
+	double WallMS;
+	double CPUMS;
+	size_t Allocs;
+	size_t AllocBytes;
+	size_t LumpBytes;
+};
+
+struct FStartupSample
+{
+	double CPU;
+	size_t Allocs;
+	size_t AllocBytes;
+	size_t LumpBytes;
+
+	static FStartupSample Now()
+	{
+		return { I_GetProcessCPUTime(), M_GetAllocCount(), M_GetAllocBytes(), GetLumpBytesRead() };
+	}
+};
+
+static int ProfileState;	// 0: not checked yet, 1: profiling, -1: off or done
+static TArray<FStartupPhase> Phases;
+static const char *CurrentPhase;
+static FStartupSample PhaseStart;
+static cycle_t PhaseTimer, TotalTimer;
+
+static void EndPhase()
+{
+	if (CurrentPhase == nullptr) return;
+
+	PhaseTimer.Unclock();
+	auto now = FStartupSample::Now();
+	Phases.Push({ CurrentPhase, PhaseTimer.TimeMS(), (now.CPU - PhaseStart.CPU) * 1e3,
+		now.Allocs - PhaseStart.Allocs, now.AllocBytes - PhaseStart.AllocBytes, now.LumpBytes - PhaseStart.LumpBytes });
+	CurrentPhase = nullptr;
+}
+
+//==========================================================================
+//
+// D_StartupPhase
+//
+//==========================================================================
+
+void D_StartupPhase(const char *name)
+{
+	if (ProfileState == 0)
+	{
+		ProfileState = Args->CheckParm("-startupprofile") ? 1 : -1;
+		if (ProfileState > 0)
+		{
+			TotalTimer.Reset();
+			TotalTimer.Clock();
+		}
+	}
+	if (ProfileState < 0) return;
+
+	EndPhase();
+	CurrentPhase = name;
+	PhaseStart = FStartupSample::Now();
+	PhaseTimer.Reset();
+	PhaseTimer.Clock();
+}
+
+//==========================================================================
+//
+// D_EndStartupProfile
+//
+//==========================================================================
+
+void D_EndStartupProfile()
+{
+	if (ProfileState <= 0) return;
+	ProfileState = -1;
+
+	EndPhase();
+	TotalTimer.Unclock();
+
+	double totalcpu = 0;
+	size_t totalallocs = 0, totallumpbytes = 0;
+	for (auto &phase : Phases)
+	{
+		totalcpu += phase.CPUMS;
+		totalallocs += phase.Allocs;
+		totallumpbytes += phase.LumpBytes;
+	}
+
+	rapidjson::StringBuffer buffer;
+	rapidjson::PrettyWriter<rapidjson::StringBuffer> w(buffer);
+
+	w.StartObject();
+	w.Key("version");		w.String(GetVersionString());
+	w.Key("githash");		w.String(GetGitHash());
+	w.Key("totalms");		w.Double(TotalTimer.TimeMS());
+	w.Key("cpums");			w.Double(totalcpu);
+	w.Key("allocations");	w.Uint64(totalallocs);
+	w.Key("lumpbytes");		w.Uint64(totallumpbytes);
+	w.Key("peakmemory");	w.Uint64(I_GetPeakMemoryUsage());
+	w.Key("phases");
+	w.StartArray();
+	for (auto &phase : Phases)
+	{
+		w.StartObject();
+		w.Key("name");			w.String(phase.Name);
+		w.Key("wallms");		w.Double(phase.WallMS);
+		w.Key("cpums");			w.Double(phase.CPUMS);
+		w.Key("allocations");	w.Uint64(phase.Allocs);
+		w.Key("allocbytes");	w.Uint64(phase.AllocBytes);
+		w.Key("lumpbytes");		w.Uint64(phase.LumpBytes);
+		w.EndObject();
+	}
+	w.EndArray();
+
+	TArray<FStartupPhase *> sorted;
+	for (auto &phase : Phases) sorted.Push(&phase);
+	std::stable_sort(sorted.begin(), sorted.end(), [](FStartupPhase *a, FStartupPhase *b) { return a->WallMS > b->WallMS; });
+	w.Key("slowest");
+	w.StartArray();
+	for (auto phase : sorted) w.String(phase->Name);
+	w.EndArray();
+	w.EndObject();
+
+	Phases.Reset();
+
+	const char *outname = Args->CheckValue("-startupprofile");
+	if (outname != nullptr)
+	{
+		FILE *f = fopen(outname, "w");
+		if (f == nullptr)
+		{
+			Printf("Could not write startup profile to %s\n", outname);
+			return;
+		}
+		fputs(buffer.GetString(), f);
+		fputc('\n', f);
+		fclose(f);
+	}
+	else
+	{
+		Printf("%s\n", buffer.GetString());
+	}
+}
@@ -0,0 +1,8 @@
+#pragma once
+
+// Startup phase profile (-startupprofile [file]).
+// Ends the running phase and starts the next one. Does nothing unless profiling.
+void D_StartupPhase(const char *name);
+
+// Ends the last phase and writes the JSON report. Only the first startup gets profiled.
+void D_EndStartupProfile();
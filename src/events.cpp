@@ -506,6 +506,7 @@ void EventManager::Console(int player, FString name, int arg1, int arg2, int arg
 
 void EventManager::RenderOverlay(EHudState state)
 {
+	FVMUIScope uiscope;
 	if (ShouldCallStatic(false)) staticEventManager.RenderOverlay(state);
 
 	for (DStaticEventHandler* handler = FirstEventHandler; handler; handler = handler->next)
@@ -514,6 +515,7 @@ void EventManager::RenderOverlay(EHudState state)
 
 void EventManager::RenderUnderlay(EHudState state)
 {
+	FVMUIScope uiscope;
 	if (ShouldCallStatic(false)) staticEventManager.RenderUnderlay(state);
 
 	for (DStaticEventHandler* handler = FirstEventHandler; handler; handler = handler->next)
@@ -1311,6 +1311,7 @@ void DBaseStatusBar::Draw (EHudState state, double ticFrac)
 
 void DBaseStatusBar::CallDraw(EHudState state, double ticFrac)
 {
+	FVMUIScope uiscope;
 	IFVIRTUAL(DBaseStatusBar, Draw)
 	{
 		VMValue params[] = { (DObject*)this, state, ticFrac };
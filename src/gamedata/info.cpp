@@ -38,6 +38,7 @@
 #include "doomstat.h"
 #include "info.h"
 #include "c_dispatch.h"
+#include "c_cvars.h"
 #include "playsim/p_commands.h"
 #include "v_text.h"
 
@@ -157,6 +158,120 @@ void FState::CheckCallerType(AActor *self, AActor *stateowner)
 
 TArray<VMValue> actionParams;
 
+//==========================================================================
+//
+// Direct action calls
+//
+// Most states call one of a handful of native action functions without
+// passing anything but the defaults, e.g. A_Look, A_Chase or A_Pain.
+// For those the generic path only packs the defaults into VMValues so that
+// the native thunk can unpack them again. If such a function has a direct
+// native entry point and all of its arguments are passed in integer
+// registers, the state gets bound to a descriptor with the defaults already
+// unpacked at load time and the call goes straight to the C++ function.
+//
+//==========================================================================
+
+CVAR(Bool, vm_directactions, true, 0)
+
+enum
+{
+	MAX_DIRECT_ACTION_ARGS = 3
+};
+
+struct FDirectAction
+{
+	VMFunction *Func;
+	void *Call;
+	int NumArgs;
+	int Args[MAX_DIRECT_ACTION_ARGS];
+};
+
+static TDeletingArray<FDirectAction *> DirectActions;
+static TMap<VMFunction *, FDirectAction *> DirectActionMap;
+
+static FDirectAction *GetDirectAction(VMFunction *func)
+{
+	auto check = DirectActionMap.CheckKey(func);
+	if (check != nullptr) return *check;
+
+	FDirectAction *action = nullptr;
+	auto native = static_cast<VMNativeFunction *>(func);
+	auto proto = func->Proto;
+	unsigned numargs = proto != nullptr ? proto->ArgumentTypes.Size() : 0;
+
+	// Only plain actor functions without a return value qualify. Weapon and
+	// overlay functions need the state owner and state info, and functions
+	// returning a state are left to the generic path which handles stateret.
+	if ((func->VarFlags & VARF_Native) && native->DirectNativeCall != nullptr && func->ImplicitArgs == 1 &&
+		proto->ReturnTypes.Size() == 0 && numargs >= 1 && numargs <= MAX_DIRECT_ACTION_ARGS + 1 &&
+		(numargs == 1 || func->DefaultArgs.Size() == numargs))
+	{
+		bool ok = true;
+		for (unsigned i = 1; i < numargs; i++)
+		{
+			auto type = proto->ArgumentTypes[i];
+			if (type->GetRegType() != REGT_INT || type->GetRegCount() != 1)
+			{
+				ok = false;
+				break;
+			}
+		}
+		if (ok)
+		{
+			action = new FDirectAction;
+			action->Func = func;
+			action->Call = native->DirectNativeCall;
+			action->NumArgs = numargs - 1;
+			for (unsigned i = 1; i < numargs; i++)
+			{
+				action->Args[i - 1] = func->DefaultArgs[i].i;
+			}
+			DirectActions.Push(action);
+		}
+	}
+	DirectActionMap[func] = action;
+	return action;
+}
+
+//==========================================================================
+//
+// Binds all states to their direct action calls. Must be called once all
+// actor definitions and Dehacked patches have been loaded.
+//
+//==========================================================================
+
+void FState::BindDirectActions()
+{
+	DirectActions.DeleteAndClear();
+	DirectActionMap.Clear();
+
+	int bound = 0;
+	for (auto cls : PClassActor::AllActorClasses)
+	{
+		auto info = cls->ActorInfo();
+		for (int i = 0; i < info->NumOwnedStates; i++)
+		{
+			auto &state = info->OwnedStates[i];
+			state.DirectAction = state.ActionFunc != nullptr ? GetDirectAction(state.ActionFunc) : nullptr;
+			if (state.DirectAction != nullptr) bound++;
+		}
+	}
+	DPrintf(DMSG_NOTIFY, "%d states bound to %d direct action functions\n", bound, DirectActions.Size());
+}
+
+static void CallDirectAction(FDirectAction *action, AActor *self)
+{
+	auto args = action->Args;
+	switch (action->NumArgs)
+	{
+	case 0: reinterpret_cast<void(*)(AActor *)>(action->Call)(self); break;
+	case 1: reinterpret_cast<void(*)(AActor *, int)>(action->Call)(self, args[0]); break;
+	case 2: reinterpret_cast<void(*)(AActor *, int, int)>(action->Call)(self, args[0], args[1]); break;
+	case 3: reinterpret_cast<void(*)(AActor *, int, int, int)>(action->Call)(self, args[0], args[1], args[2]); break;
+	}
+}
+
 bool FState::CallAction(AActor *self, AActor *stateowner, FStateParamInfo *info, FState **stateret)
 {
 	if (ActionFunc != nullptr)
@@ -186,7 +301,12 @@ bool FState::CallAction(AActor *self, AActor *stateowner, FStateParamInfo *info,
 			// Build the parameter array. Action functions have never any explicit parameters but need to pass the defaults
 			// and fill in the implicit arguments of the called function.
 
-			if (ActionFunc->DefaultArgs.Size() > 0)
+			// The binding is only valid as long as nobody replaced the function after it was made.
+			if (DirectAction != nullptr && DirectAction->Func == ActionFunc && vm_directactions)
+			{
+				CallDirectAction(DirectAction, self);
+			}
+			else if (ActionFunc->DefaultArgs.Size() > 0)
 			{
 				auto defs = ActionFunc->DefaultArgs;
 				auto index = actionParams.Reserve(defs.Size());
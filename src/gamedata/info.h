@@ -111,6 +111,7 @@ struct FState
 	uint8_t		DefineFlags;
 	int32_t		Misc1;			// Was changed to int8_t, reverted to long for MBF compat
 	int32_t		Misc2;			// Was changed to uint8_t, reverted to long for MBF compat
+	struct FDirectAction *DirectAction = nullptr;	// Set by BindDirectActions if ActionFunc can be called directly
 public:
 	inline int GetFrame() const
 	{
@@ -169,6 +170,7 @@ public:
 	void SetAction(const char *name);
 	bool CallAction(AActor *self, AActor *stateowner, FStateParamInfo *stateinfo, FState **stateret);
     void CheckCallerType(AActor *self, AActor *stateowner);
+	static void BindDirectActions();
 
 	static PClassActor *StaticFindStateOwner (const FState *state);
 	static PClassActor *StaticFindStateOwner (const FState *state, PClassActor *info);
@@ -2,6 +2,7 @@
 #define __P_BLOCKMAP_H
 
 #include "doomtype.h"
+#include "tarray.h"
 
 class AActor;
 
@@ -22,6 +23,61 @@ struct FBlockNode
 	static FBlockNode *FreeBlocks;
 };
 
+// Secondary index for things on top of the blockmap: a loose grid with two
+// levels of cells. Each actor is linked into exactly one cell, picked by the
+// first block it touches, so an area query never sees an actor twice and
+// linking an actor does not allocate anything. A cell at level 0 is
+// 'CellBlocks' blocks wide and takes actors that span no more blocks than
+// that, level 1 is LEVEL_SCALE times as coarse and whatever is even larger
+// goes into a list that every query checks.
+//
+// The index only knows about the blocks an actor covers at its own position.
+// Links made on the other side of linked portals are not covered, so maps
+// with portal groups have to keep using the blockmap's own thing chains.
+// On all other maps the grid replaces the chains once the level is set up,
+// see P_FinishThingGrid. It returns things in a different order than the
+// chains, which is why it must be enabled through sv_thinggridsize.
+
+struct FThingGrid
+{
+	enum
+	{
+		NUM_LEVELS = 2,
+		LEVEL_SCALE = 8
+	};
+
+	struct GridLevel
+	{
+		int CellBlocks = 0;
+		int Width = 0, Height = 0;
+		TArray<AActor *> Cells;
+	};
+
+	GridLevel Levels[NUM_LEVELS];
+	AActor *Oversized = nullptr;
+	bool ReplacesChains = false;	// no FBlockNodes get created
+
+	void Create(int bmapwidth, int bmapheight, int cellblocks);
+	void Link(AActor *actor, int x1, int y1, int x2, int y2);
+	void Unlink(AActor *actor);
+
+	bool isActive() const
+	{
+		return Levels[0].CellBlocks > 0;
+	}
+
+	void Clear()
+	{
+		for (auto &level : Levels)
+		{
+			level.CellBlocks = level.Width = level.Height = 0;
+			level.Cells.Reset();
+		}
+		Oversized = nullptr;
+		ReplacesChains = false;
+	}
+};
+
 // BLOCKMAP
 // Created from axis aligned bounding box
 // of the map, a rectangular array of
@@ -40,6 +96,7 @@ struct FBlockmap
 	double				bmaporgx;
 	double				bmaporgy;		// origin of block map
 	FBlockNode**		blocklinks; 	// for thing chains
+	FThingGrid			thinggrid;		// the same things, one link per actor
 
 	// mapblocks are used to check movement
 	// against lines and things
@@ -87,6 +144,7 @@ struct FBlockmap
 			delete[] blocklinks;
 			blocklinks = nullptr;
 		}
+		thinggrid.Clear();
 	}
 
 	~FBlockmap()
@@ -90,6 +90,9 @@ enum
 
 CVAR (Bool, genblockmap, false, CVAR_SERVERINFO|CVAR_GLOBALCONFIG);
 CVAR (Bool, gennodes, false, CVAR_SERVERINFO|CVAR_GLOBALCONFIG);
+// The thing grid finds things in a different order than the block chains, so it is off by default
+// and must be the same for all players of a netgame and when playing back a demo.
+CVAR (Int, sv_thinggridsize, 0, CVAR_SERVERINFO|CVAR_ARCHIVE);	// in blocks, 0 disables the thing grid
 
 inline bool P_LoadBuildMap(uint8_t *mapdata, size_t len, FMapThing **things, int *numthings)
 {
@@ -2643,6 +2646,7 @@ void MapLoader::LoadBlockMap (MapData * map)
 	Level->blockmap.blocklinks = new FBlockNode *[count];
 	memset (Level->blockmap.blocklinks, 0, count*sizeof(*Level->blockmap.blocklinks));
 	Level->blockmap.blockmap = Level->blockmap.blockmaplump+4;
+	Level->blockmap.thinggrid.Create(Level->blockmap.bmapwidth, Level->blockmap.bmapheight, clamp<int>(sv_thinggridsize, 0, 64));
 }
 
 //===========================================================================
@@ -3252,6 +3256,7 @@ void MapLoader::LoadLevel(MapData *map, const char *lumpname, int position)
 	PO_Init();				// Initialize the polyobjs
 	if (!Level->IsReentering())
 		Level->FinalizePortals();	// finalize line portals after polyobjects have been initialized. This info is needed for properly flagging them.
+	P_FinishThingGrid(Level);	// needs to know about the portal groups
 
 	Level->aabbTree = new DoomLevelAABBTree(Level);
 }
@@ -328,6 +328,7 @@ void DMenu::CallTicker()
 
 void DMenu::CallDrawer()
 {
+	FVMUIScope uiscope;
 	IFVIRTUAL(DMenu, Drawer)
 	{
 		VMValue params[] = { (DObject*)this };
@@ -60,6 +60,7 @@
 #include "p_blockmap.h"
 #include "r_utility.h"
 #include "p_spec.h"
+#include "p_enemy.h"
 #include "g_levellocals.h"
 #include "c_dispatch.h"
 #include "a_dynlight.h"
@@ -68,6 +69,7 @@
 #include "types.h"
 #include "i_time.h"
 #include "vm.h"
+#include "vmintern.h"
 #include "a_specialspot.h"
 #include "maploader/maploader.h"
 #include "p_acs.h"
@@ -228,6 +230,53 @@ static void PrecacheLevel(FLevelLocals *Level)
 
 }
 
+//===========================================================================
+//
+// PrecompileLevelScripts
+//
+// Hands the action functions and virtual overrides of all actors on the
+// map to the JIT workers, so that they do not get compiled in the middle
+// of a tic when a monster wakes up for the first time.
+//
+//===========================================================================
+
+CVAR(Bool, vm_jitprecompile, false, CVAR_ARCHIVE | CVAR_GLOBALCONFIG)
+
+static void PrecompileScriptFunction(VMFunction *func)
+{
+	if (func != nullptr && !(func->VarFlags & VARF_Native))
+	{
+		static_cast<VMScriptFunction *>(func)->PrecompileJit();
+	}
+}
+
+static void PrecompileLevelScripts(FLevelLocals *Level)
+{
+	TMap<PClass *, bool> visited;
+	AActor *actor;
+	auto iterator = Level->GetThinkerIterator<AActor>();
+
+	while ((actor = iterator.Next()))
+	{
+		for (PClass *cls = actor->GetClass(); cls != nullptr && visited.CheckKey(cls) == nullptr; cls = cls->ParentClass)
+		{
+			visited[cls] = true;
+			for (auto func : cls->Virtuals)
+			{
+				PrecompileScriptFunction(func);
+			}
+			if (cls->IsDescendantOf(RUNTIME_CLASS(AActor)))
+			{
+				auto info = static_cast<PClassActor *>(cls)->ActorInfo();
+				for (int i = 0; i < info->NumOwnedStates; i++)
+				{
+					PrecompileScriptFunction(info->OwnedStates[i].ActionFunc);
+				}
+			}
+		}
+	}
+}
+
 //============================================================================
 //
 // clears all portal data for a new level start
@@ -282,6 +331,7 @@ void FLevelLocals::ClearLevelData()
 	interpolator.ClearInterpolations();	// [RH] Nothing to interpolate on a fresh level.
 	Thinkers.DestroyAllThinkers();
 	ClearAllSubsectorLinks(); // can't be done as part of the polyobj deletion process.
+	P_ClearSoundGraph();
 
 	total_monsters = total_items = total_secrets =
 	killed_monsters = found_items = found_secrets = 0;
@@ -546,6 +596,11 @@ void P_SetupLevel(FLevelLocals *Level, int position, bool newGame)
 		S_PrecacheLevel(Level);
 	}
 
+	if (vm_jitprecompile)
+	{
+		PrecompileLevelScripts(Level);
+	}
+
 	if (deathmatch)
 	{
 		AnnounceGameStart();
@@ -64,6 +64,7 @@
 #include "a_dynlight.h"
 #include "actorinlines.h"
 #include "memarena.h"
+#include "parallel_for.h"
 
 static FMemArena DynLightArena(sizeof(FDynamicLight) * 200);
 static TArray<FDynamicLight*> FreeList;
@@ -249,6 +250,7 @@ void FDynamicLight::Tick()
 	if (!target)
 	{
 		// How did we get here? :?
+		UnlinkLight();
 		ReleaseLight();
 		return;
 	}
@@ -369,6 +371,7 @@ void FDynamicLight::UpdateLocation()
 {
 	double oldx= X();
 	double oldy= Y();
+	double oldz= Z();
 	float oldradius = radius;
 
 	if (IsActive())
@@ -404,10 +407,11 @@ void FDynamicLight::UpdateLocation()
 		radius = intensity * 2.0f;
 		if (radius < m_currentRadius * 2) radius = m_currentRadius * 2;
 
-		if (X() != oldx || Y() != oldy || radius != oldradius)
+		// Height only matters if one of the touched sections has a plane portal.
+		if (X() != oldx || Y() != oldy || radius != oldradius || (portalplanes && Z() != oldz))
 		{
 			//Update the light lists
-			LinkLight();
+			QueueLink();
 		}
 	}
 }
@@ -427,16 +431,16 @@ FLightNode * AddLightNode(FLightNode ** thread, void * linkto, FDynamicLight * l
 {
 	FLightNode * node;
 
-	node = nextnode;
-	while (node)
-    {
-		if (node->targ==linkto)   // Already have a node for this sector?
+	// Only a few lights touch the same target, so look for an existing node
+	// in the target's list rather than in the light's, which can be very long.
+	for (node = *thread; node; node = node->nextLight)
+	{
+		if (node->owner == light)   // Already have a node for this sector?
 		{
 			node->lightsource = light; // Yes. Setting m_thing says 'keep it'.
 			return(nextnode);
 		}
-		node = node->nextTarget;
-    }
+	}
 
 	// Couldn't find an existing node for this sector. Add one at the head
 	// of the list.
@@ -445,6 +449,7 @@ FLightNode * AddLightNode(FLightNode ** thread, void * linkto, FDynamicLight * l
 	
 	node->targ = linkto;
 	node->lightsource = light; 
+	node->owner = light;
 
 	node->prevTarget = &nextnode; 
 	node->nextTarget = nextnode;
@@ -522,8 +527,120 @@ double FDynamicLight::DistToSeg(const DVector3 &pos, vertex_t *start, vertex_t *
 
 //==========================================================================
 //
-// Collect all touched sidedefs and subsectors
-// to sidedefs and sector parts.
+// Light linking is split into two passes. UpdateLocation only queues the
+// lights whose position or size actually changed. Once all lights have
+// ticked, the sections and sides touched by each queued light get collected.
+// This only reads level geometry, so with enough queued lights it runs in
+// parallel. The results are then linked serially in queue order, so the
+// node lists come out the same regardless of thread scheduling.
+//
+//==========================================================================
+
+struct FLightLinkResult
+{
+	TArray<FSection *> sections;
+	TArray<side_t *> sides;
+	bool hitonesidedback;
+	bool portalplanes;
+};
+
+static TArray<FDynamicLight *> PendingLinks;
+static TArray<FLightLinkResult> LinkResults;
+
+CVAR(Int, r_lightlinkthreshold, 32, CVAR_ARCHIVE | CVAR_GLOBALCONFIG)	// minimum number of queued lights before collecting in parallel
+
+//==========================================================================
+//
+// Visit marks for the collection pass. validcount and dl_validcount are
+// shared by the entire engine, so every thread gets its own set instead.
+//
+//==========================================================================
+
+struct FLightCollectMarks
+{
+	TArray<int> sections;
+	TArray<int> lines;
+	int stamp = 0;
+
+	void Begin(FLevelLocals *Level)
+	{
+		unsigned numsections = Level->sections.allSections.Size();
+		unsigned numlines = Level->lines.Size();
+		if (sections.Size() != numsections || lines.Size() != numlines || stamp == INT_MAX)
+		{
+			sections.Resize(numsections);
+			lines.Resize(numlines);
+			if (numsections > 0) memset(&sections[0], 0, numsections * sizeof(int));
+			if (numlines > 0) memset(&lines[0], 0, numlines * sizeof(int));
+			stamp = 0;
+		}
+		stamp++;
+	}
+
+	bool MarkSection(FLevelLocals *Level, FSection *sect)
+	{
+		int &mark = sections[unsigned(sect - &Level->sections.allSections[0])];
+		if (mark == stamp) return false;
+		mark = stamp;
+		return true;
+	}
+
+	bool IsLineMarked(line_t *line) const
+	{
+		return lines[line->Index()] == stamp;
+	}
+
+	void MarkLine(line_t *line)
+	{
+		lines[line->Index()] = stamp;
+	}
+};
+
+static thread_local FLightCollectMarks CollectMarks;
+
+//==========================================================================
+//
+// If all of a section lies within the light's radius, none of its
+// lines needs a distance check. (radius is passed squared.)
+//
+//==========================================================================
+
+static bool SectionWithinRadius(const FSection *section, const DVector3 &pos, float radius)
+{
+	double dx = MAX(fabs(pos.X - section->bounds.left), fabs(pos.X - section->bounds.right));
+	double dy = MAX(fabs(pos.Y - section->bounds.top), fabs(pos.Y - section->bounds.bottom));
+	return dx * dx + dy * dy <= radius;
+}
+
+//==========================================================================
+//
+// If all of a section lies outside the light's radius, none of its
+// lines can pass the distance check. (radius is passed squared.)
+//
+//==========================================================================
+
+static bool SectionOutsideRadius(const FSection *section, const DVector3 &pos, float radius)
+{
+	double left = MIN(section->bounds.left, section->bounds.right), right = MAX(section->bounds.left, section->bounds.right);
+	double top = MIN(section->bounds.top, section->bounds.bottom), bottom = MAX(section->bounds.top, section->bounds.bottom);
+	double dx = pos.X < left ? left - pos.X : pos.X > right ? pos.X - right : 0;
+	double dy = pos.Y < top ? top - pos.Y : pos.Y > bottom ? pos.Y - bottom : 0;
+	return dx * dx + dy * dy > radius;
+}
+
+//==========================================================================
+//
+// Collect all touched sidedefs and sections.
+// This may run on a worker thread so it must not modify anything
+// but the passed result and the calling thread's visit marks.
+//
+// The search walks the section adjacency outward from the light's own
+// section instead of querying a separate grid of sections: only the
+// sections connected through segments within the radius may be lit, so
+// a grid query would still need the same walk to drop the ones behind
+// solid walls. The section bounds take the place of the grid cells and
+// spare the per-line distance checks of sections that lie entirely
+// inside or outside the radius.
 //
 //==========================================================================
 struct LightLinkEntry
@@ -531,38 +648,44 @@ struct LightLinkEntry
 	FSection *sect;
 	DVector3 pos;
 };
-static TArray<LightLinkEntry> collected_ss;
+static thread_local TArray<LightLinkEntry> collected_ss;
 
-void FDynamicLight::CollectWithinRadius(const DVector3 &opos, FSection *section, float radius)
+void FDynamicLight::CollectWithinRadius(const DVector3 &opos, FSection *section, float radius, FLightLinkResult &result) const
 {
+	result.sections.Clear();
+	result.sides.Clear();
+	result.hitonesidedback = false;
+	result.portalplanes = false;
 	if (!section) return;
+
+	auto &marks = CollectMarks;
+	marks.Begin(Level);
+
 	collected_ss.Clear();
 	collected_ss.Push({ section, opos });
-	section->validcount = dl_validcount;
+	marks.MarkSection(Level, section);
 
-	bool hitonesidedback = false;
 	for (unsigned i = 0; i < collected_ss.Size(); i++)
 	{
 		auto pos = collected_ss[i].pos;
 		section = collected_ss[i].sect;
 
-		touching_sector = AddLightNode(&section->lighthead, section, this, touching_sector);
-
+		result.sections.Push(section);
 
 		auto processSide = [&](side_t *sidedef, const vertex_t *v1, const vertex_t *v2)
 		{
 			auto linedef = sidedef->linedef;
-			if (linedef && linedef->validcount != ::validcount)
+			if (linedef && !marks.IsLineMarked(linedef))
 			{
 				// light is in front of the seg
 				if ((pos.Y - v1->fY()) * (v2->fX() - v1->fX()) + (v1->fX() - pos.X) * (v2->fY() - v1->fY()) <= 0)
 				{
-					linedef->validcount = ::validcount;
-					touching_sides = AddLightNode(&sidedef->lighthead, sidedef, this, touching_sides);
+					marks.MarkLine(linedef);
+					result.sides.Push(sidedef);
 				}
 				else if (linedef->sidedef[0] == sidedef && linedef->sidedef[1] == nullptr)
 				{
-					hitonesidedback = true;
+					result.hitonesidedback = true;
 				}
 			}
 			if (linedef)
@@ -571,13 +694,12 @@ void FDynamicLight::CollectWithinRadius(const DVector3 &opos, FSection *section,
 				if (port && port->mType == PORTT_LINKED)
 				{
 					line_t *other = port->mDestination;
-					if (other->validcount != ::validcount)
+					if (!marks.IsLineMarked(other))
 					{
 						subsector_t *othersub = Level->PointInRenderSubsector(other->v1->fPos() + other->Delta() / 2);
 						FSection *othersect = othersub->section;
-						if (othersect->validcount != ::validcount)
+						if (marks.MarkSection(Level, othersect))
 						{
-							othersect->validcount = ::validcount;
 							collected_ss.Push({ othersect, PosRelative(other->frontsector->PortalGroup) });
 						}
 					}
@@ -585,11 +707,13 @@ void FDynamicLight::CollectWithinRadius(const DVector3 &opos, FSection *section,
 			}
 		};
 
-		for (auto &segment : section->segments)
+		bool inside = SectionWithinRadius(section, pos, radius);
+		bool outside = !inside && SectionOutsideRadius(section, pos, radius);
+		if (!outside) for (auto &segment : section->segments)
 		{
 			// check distance from x/y to seg and if within radius add this seg and, if present the opposing subsector (lather/rinse/repeat)
 			// If out of range we do not need to bother with this seg.
-			if (DistToSeg(pos, segment.start, segment.end) <= radius)
+			if (inside || DistToSeg(pos, segment.start, segment.end) <= radius)
 			{
 				auto sidedef = segment.sidedef;
 				if (sidedef)
@@ -601,18 +725,17 @@ void FDynamicLight::CollectWithinRadius(const DVector3 &opos, FSection *section,
 				if (partner)
 				{
 					FSection *sect = partner->section;
-					if (sect != nullptr && sect->validcount != dl_validcount)
+					if (sect != nullptr && marks.MarkSection(Level, sect))
 					{
-						sect->validcount = dl_validcount;
 						collected_ss.Push({ sect, pos });
 					}
 				}
 			}
 		}
-		for (auto side : section->sides)
+		if (!outside) for (auto side : section->sides)
 		{
 			auto v1 = side->V1(), v2 = side->V2();
-			if (DistToSeg(pos, v1, v2) <= radius)
+			if (inside || DistToSeg(pos, v1, v2) <= radius)
 			{
 				processSide(side, v1, v2);
 			}
@@ -620,36 +743,58 @@ void FDynamicLight::CollectWithinRadius(const DVector3 &opos, FSection *section,
 		sector_t *sec = section->sector;
 		if (!sec->PortalBlocksSight(sector_t::ceiling))
 		{
+			result.portalplanes = true;
 			line_t *other = section->segments[0].sidedef->linedef;
 			if (sec->GetPortalPlaneZ(sector_t::ceiling) < Z() + radius)
 			{
 				DVector2 refpos = other->v1->fPos() + other->Delta() / 2 + sec->GetPortalDisplacement(sector_t::ceiling);
 				subsector_t *othersub = Level->PointInRenderSubsector(refpos);
 				FSection *othersect = othersub->section;
-				if (othersect->validcount != dl_validcount)
+				if (marks.MarkSection(Level, othersect))
 				{
-					othersect->validcount = dl_validcount;
 					collected_ss.Push({ othersect, PosRelative(othersub->sector->PortalGroup) });
 				}
 			}
 		}
 		if (!sec->PortalBlocksSight(sector_t::floor))
 		{
+			result.portalplanes = true;
 			line_t *other = section->segments[0].sidedef->linedef;
 			if (sec->GetPortalPlaneZ(sector_t::floor) > Z() - radius)
 			{
 				DVector2 refpos = other->v1->fPos() + other->Delta() / 2 + sec->GetPortalDisplacement(sector_t::floor);
 				subsector_t *othersub = Level->PointInRenderSubsector(refpos);
 				FSection *othersect = othersub->section;
-				if (othersect->validcount != dl_validcount)
+				if (marks.MarkSection(Level, othersect))
 				{
-					othersect->validcount = dl_validcount;
 					collected_ss.Push({ othersect, PosRelative(othersub->sector->PortalGroup) });
 				}
 			}
 		}
 	}
-	shadowmapped = hitonesidedback && !DontShadowmap();
+}
+
+//==========================================================================
+//
+// Gathers everything the light touches at its current position.
+//
+//==========================================================================
+
+void FDynamicLight::CollectLinks(FLightLinkResult &result) const
+{
+	if (radius > 0)
+	{
+		// passing in radius*radius allows us to do a distance check without any calls to sqrt
+		FSection *sect = Level->PointInRenderSubsector(Pos)->section;
+		CollectWithinRadius(Pos, sect, float(radius*radius), result);
+	}
+	else
+	{
+		result.sections.Clear();
+		result.sides.Clear();
+		result.hitonesidedback = false;
+		result.portalplanes = false;
+	}
 }
 
 //==========================================================================
@@ -658,7 +803,7 @@ void FDynamicLight::CollectWithinRadius(const DVector3 &opos, FSection *section,
 //
 //==========================================================================
 
-void FDynamicLight::LinkLight()
+void FDynamicLight::ApplyLinks(const FLightLinkResult &result)
 {
 	// mark the old light nodes
 	FLightNode * node;
@@ -676,16 +821,16 @@ void FDynamicLight::LinkLight()
 		node = node->nextTarget;
 	}
 
-	if (radius>0)
+	for (auto section : result.sections)
 	{
-		// passing in radius*radius allows us to do a distance check without any calls to sqrt
-		FSection *sect = Level->PointInRenderSubsector(Pos)->section;
-
-		dl_validcount++;
-		::validcount++;
-		CollectWithinRadius(Pos, sect, float(radius*radius));
-
+		touching_sector = AddLightNode(&section->lighthead, section, this, touching_sector);
+	}
+	for (auto sidedef : result.sides)
+	{
+		touching_sides = AddLightNode(&sidedef->lighthead, sidedef, this, touching_sides);
 	}
+	shadowmapped = result.hitonesidedback && !DontShadowmap();
+	portalplanes = result.portalplanes;
 		
 	// Now delete any nodes that won't be used. These are the ones where
 	// m_thing is still nullptr.
@@ -713,6 +858,64 @@ void FDynamicLight::LinkLight()
 	}
 }
 
+void FDynamicLight::LinkLight()
+{
+	FLightLinkResult result;
+	CollectLinks(result);
+	ApplyLinks(result);
+}
+
+//==========================================================================
+//
+// Queue the light for relinking after all lights have been ticked.
+//
+//==========================================================================
+
+void FDynamicLight::QueueLink()
+{
+	if (!linkpending)
+	{
+		linkpending = true;
+		PendingLinks.Push(this);
+	}
+}
+
+//==========================================================================
+//
+// Relink all queued lights.
+//
+//==========================================================================
+
+void FDynamicLight::LinkPendingLights()
+{
+	unsigned count = PendingLinks.Size();
+	if (count == 0) return;
+
+	if (LinkResults.Size() < count) LinkResults.Resize(count);
+
+	if (count >= unsigned(MAX<int>(r_lightlinkthreshold, 1)))
+	{
+		parallel_for(int(count), [](int i)
+		{
+			PendingLinks[i]->CollectLinks(LinkResults[i]);
+		});
+	}
+	else
+	{
+		for (unsigned i = 0; i < count; i++)
+		{
+			PendingLinks[i]->CollectLinks(LinkResults[i]);
+		}
+	}
+
+	for (unsigned i = 0; i < count; i++)
+	{
+		PendingLinks[i]->linkpending = false;
+		PendingLinks[i]->ApplyLinks(LinkResults[i]);
+	}
+	PendingLinks.Clear();
+}
+
 
 //==========================================================================
 //
@@ -721,6 +924,11 @@ void FDynamicLight::LinkLight()
 //==========================================================================
 void FDynamicLight::UnlinkLight ()
 {
+	if (linkpending)
+	{
+		PendingLinks.Delete(PendingLinks.Find(this));
+		linkpending = false;
+	}
 	while (touching_sides) touching_sides = DeleteLightNode(touching_sides);
 	while (touching_sector) touching_sector = DeleteLightNode(touching_sector);
 	shadowmapped = false;
@@ -175,6 +175,8 @@ protected:
 };
 
 
+struct FLightLinkResult;
+
 struct FLightNode
 {
 	FLightNode ** prevTarget;
@@ -182,6 +184,7 @@ struct FLightNode
 	FLightNode ** prevLight;
 	FLightNode * nextLight;
 	FDynamicLight * lightsource;
+	FDynamicLight * owner;		// the light this node belongs to, even while lightsource is cleared for relinking
 	union
 	{
 		side_t * targLine;
@@ -236,12 +239,17 @@ struct FDynamicLight
 	void Tick();
 	void UpdateLocation();
 	void LinkLight();
+	void QueueLink();
 	void UnlinkLight();
 	void ReleaseLight();
 
+	static void LinkPendingLights();
+
 private:
-	double DistToSeg(const DVector3 &pos, vertex_t *start, vertex_t *end);
-	void CollectWithinRadius(const DVector3 &pos, FSection *section, float radius);
+	static double DistToSeg(const DVector3 &pos, vertex_t *start, vertex_t *end);
+	void CollectWithinRadius(const DVector3 &pos, FSection *section, float radius, FLightLinkResult &result) const;
+	void CollectLinks(FLightLinkResult &result) const;
+	void ApplyLinks(const FLightLinkResult &result);
 
 public:
 	FCycler m_cycler;
@@ -271,6 +279,8 @@ public:
 	bool m_active;
 	bool visibletoplayer;
 	bool shadowmapped;
+	bool portalplanes;		// touches a section with a plane portal, so height changes require relinking
+	bool linkpending;
 	uint8_t lighttype;
 	bool owned;
 	bool swapped;
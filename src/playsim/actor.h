@@ -957,11 +957,43 @@ public:
 	void AttachLight(unsigned int count, const FLightDefaults *lightdef);
 	void SetDynamicLights();
 
-// info for drawing
 // NOTE: The first member variable *must* be snext.
 	AActor			*snext, **sprev;	// links in sector (if needed)
+
+// Movement-critical state. P_XYMovement, P_ZMovement, P_CheckPosition and the
+// blockmap iterators mostly touch only these, so they are kept together right
+// at the start of the actor to pull in as few cache lines as possible.
+// Anything that is not needed by the movement code belongs further down.
 	DVector3		__Pos;		// double underscores so that it won't get used by accident. Access to this should be exclusively through the designated access functions.
+	DVector3		Vel;
+	double			radius, Height;		// for movement checking
+	double			floorz, ceilingz;	// closest together of contacted secs
+	double			dropoffz;		// killough 11/98: the lowest floor over all contacted Sectors.
+	ActorFlags		flags;
+	ActorFlags2		flags2;			// Heretic flags
+	ActorFlags3		flags3;			// [RH] Hexen/Heretic actor-dependant behavior made flaggable
+	ActorFlags4		flags4;			// [RH] Even more flags!
+	ActorFlags5		flags5;			// OMG! We need another one.
+	ActorFlags6		flags6;			// Shit! Where did all the flags go?
+	ActorFlags7		flags7;			// WHO WANTS TO BET ON 8!?
+	ActorFlags8		flags8;			// I see your 8, and raise you a bet for 9.
+	FBlockNode		*BlockNode;			// links in blocks (if needed)
+	AActor			*gnext, **gprev;	// links in thing grid (if needed)
+	int				GridBox[4];			// blocks covered when linked: left, bottom, right, top
+	struct sector_t	*Sector;
+	subsector_t *		subsector;
+	FSection *			section;
+	struct sector_t	*floorsector;
+	struct sector_t	*ceilingsector;
+	struct msecnode_t	*touching_sectorlist;				// phares 3/14/98
+	AActor			*BlockingMobj;	// Actor that blocked the last move
+	line_t			*BlockingLine;	// Line that blocked the last move
+	double			MaxStepHeight;
+	double			MaxDropOffHeight;
+	double			Gravity;		// [GRB] Gravity factor
+	double			Friction;
 
+// info for drawing
 	DAngle			SpriteAngle;
 	DAngle			SpriteRotation;
 	DRotator		Angles;
@@ -981,16 +1013,7 @@ public:
 	uint32_t			RenderHidden;		// current renderer must *not* have any of these features
 
 	ActorRenderFlags	renderflags;		// Different rendering flags
-	ActorFlags		flags;
-	ActorFlags2		flags2;			// Heretic flags
-	ActorFlags3		flags3;			// [RH] Hexen/Heretic actor-dependant behavior made flaggable
-	ActorFlags4		flags4;			// [RH] Even more flags!
-	ActorFlags5		flags5;			// OMG! We need another one.
-	ActorFlags6		flags6;			// Shit! Where did all the flags go?
-	ActorFlags7		flags7;			// WHO WANTS TO BET ON 8!?
-	ActorFlags8		flags8;			// I see your 8, and raise you a bet for 9.
 	double			Floorclip;		// value to use for floor clipping
-	double			radius, Height;		// for movement checking
 
 	DAngle			VisibleStartAngle;
 	DAngle			VisibleStartPitch;
@@ -998,22 +1021,12 @@ public:
 	DAngle			VisibleEndPitch;
 
 	DVector3		OldRenderPos;
-	DVector3		Vel;
 	double			Speed;
 	double			FloatSpeed;
 
 // interaction info
-	FBlockNode		*BlockNode;			// links in blocks (if needed)
-	struct sector_t	*Sector;
-	subsector_t *		subsector;
-	FSection *			section;
-	double			floorz, ceilingz;	// closest together of contacted secs
-	double			dropoffz;		// killough 11/98: the lowest floor over all contacted Sectors.
-
-	struct sector_t	*floorsector;
 	FTextureID		floorpic;			// contacted sec floorpic
 	int				floorterrain;
-	struct sector_t	*ceilingsector;
 	FTextureID		ceilingpic;			// contacted sec ceilingpic
 	double			renderradius;
 
@@ -1092,8 +1105,6 @@ public:
 	double			bouncefactor;	// Strife's grenades use 50%, Hexen's Flechettes 70.
 	double			wallbouncefactor;	// The bounce factor for walls can be different.
 	int				bouncecount;	// Strife's grenades only bounce twice before exploding
-	double			Gravity;		// [GRB] Gravity factor
-	double			Friction;
 	int 			FastChaseStrafeCount;
 	double			pushfactor;
 	int				lastpush;
@@ -1104,8 +1115,6 @@ public:
 	int				DesignatedTeam;	// Allow for friendly fire cacluations to be done on non-players.
 	int				friendlyseeblocks;	// allow to override friendly search distance calculation
 
-	AActor			*BlockingMobj;	// Actor that blocked the last move
-	line_t			*BlockingLine;	// Line that blocked the last move
 	sector_t		*Blocking3DFloor;	// 3D floor that blocked the last move (if any)
 	sector_t		*BlockingCeiling;	// Sector that blocked the last move (ceiling plane slope)
 	sector_t		*BlockingFloor;		// Sector that blocked the last move (floor plane slope)
@@ -1122,7 +1131,6 @@ public:
 	TObjPtr<AActor*> Poisoner; // Last source of received poison damage.
 
 	// a linked list of sectors where this object appears
-	struct msecnode_t	*touching_sectorlist;				// phares 3/14/98
 	struct msecnode_t	*touching_sectorportallist;		// same for cross-sectorportal rendering
 	struct portnode_t	*touching_lineportallist;		// and for cross-lineportal
 	struct msecnode_t	*touching_rendersectors; // this is the list of sectors that this thing interesects with it's max(radius, renderradius).
@@ -1150,9 +1158,6 @@ public:
 	FSoundIDNoInit WallBounceSound;
 	FSoundIDNoInit CrushPainSound;
 
-	double MaxDropOffHeight;
-	double MaxStepHeight;
-
 	int32_t Mass;
 	int16_t PainChance;
 	int PainThreshold;
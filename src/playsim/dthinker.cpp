@@ -44,8 +44,8 @@
 #include "a_dynlight.h"
 
 
-static int ThinkCount;
-static cycle_t ThinkCycles;
+int ThinkCount;
+cycle_t ThinkCycles;
 extern cycle_t BotSupportCycles;
 extern cycle_t ActionCycles;
 extern int BotWTG;
@@ -130,6 +130,7 @@ void FThinkerCollection::RunThinkers(FLevelLocals *Level)
 			light->Tick();
 			light = next;
 		}
+		FDynamicLight::LinkPendingLights();
 	}
 	else
 	{
@@ -162,6 +163,7 @@ void FThinkerCollection::RunThinkers(FLevelLocals *Level)
 				light->Tick();
 				light = next;
 			}
+			FDynamicLight::LinkPendingLights();
 			prof.timer.Unclock();
 		}
 
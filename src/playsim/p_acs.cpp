@@ -972,6 +972,22 @@ int ACSStringPool::AddString(const char *str)
 	return InsertString(fstr, h, bucketnum);
 }
 
+int ACSStringPool::AddName(FName name)
+{
+	const char *str = name.GetChars();
+	size_t len = strlen(str);
+	unsigned int h = SuperFastHash(str, len);
+	unsigned int bucketnum = h % NUM_BUCKETS;
+	int i = FindString(str, len, h, bucketnum);
+	if (i >= 0)
+	{
+		return i | STRPOOL_LIBRARYID_OR;
+	}
+	// Shares the name's string buffer instead of allocating a new one.
+	FString fstr = name.GetString();
+	return InsertString(fstr, h, bucketnum);
+}
+
 int ACSStringPool::AddString(FString &str)
 {
 	unsigned int h = SuperFastHash(str.GetChars(), str.Len());
@@ -1001,6 +1017,29 @@ const char *ACSStringPool::GetString(int strnum)
 	return NULL;
 }
 
+//============================================================================
+//
+// ACSStringPool :: GetFString
+//
+// Like GetString, but returns the pooled FString so that passing it on
+// to script functions does not need to copy the text.
+//
+//============================================================================
+
+const FString *ACSStringPool::GetFString(int strnum)
+{
+	if ((strnum & LIBRARYID_MASK) != STRPOOL_LIBRARYID_OR)
+	{
+		return nullptr;
+	}
+	strnum &= ~LIBRARYID_MASK;
+	if ((unsigned)strnum < Pool.Size() && Pool[strnum].Next != FREE_ENTRY)
+	{
+		return &Pool[strnum].Str;
+	}
+	return nullptr;
+}
+
 //============================================================================
 //
 // ACSStringPool :: LockString
@@ -4395,13 +4434,13 @@ int DLevelScript::GetActorProperty (int tid, int property)
 	case APROP_PainSound:	return GlobalACSStrings.AddString(S_GetSoundName(actor->PainSound));
 	case APROP_DeathSound:	return GlobalACSStrings.AddString(S_GetSoundName(actor->DeathSound));
 	case APROP_ActiveSound:	return GlobalACSStrings.AddString(S_GetSoundName(actor->ActiveSound));
-	case APROP_Species:		return GlobalACSStrings.AddString(actor->GetSpecies().GetChars());
+	case APROP_Species:		return GlobalACSStrings.AddName(actor->GetSpecies());
 	case APROP_NameTag:		return GlobalACSStrings.AddString(actor->GetTag());
 	case APROP_StencilColor:return actor->fillcolor;
 	case APROP_Friction:	return DoubleToACS(actor->Friction);
 	case APROP_MaxStepHeight: return DoubleToACS(actor->MaxStepHeight);
 	case APROP_MaxDropOffHeight: return DoubleToACS(actor->MaxDropOffHeight);
-	case APROP_DamageType:	return GlobalACSStrings.AddString(actor->DamageType.GetChars());
+	case APROP_DamageType:	return GlobalACSStrings.AddName(actor->DamageType);
 
 	default:				return 0;
 	}
@@ -4902,7 +4941,7 @@ static int GetUserVariable(AActor *self, FName varname, int index)
 		}
 		else if (type == TypeName)
 		{
-			return GlobalACSStrings.AddString(FName(ENamedName(type->GetValueInt(addr))).GetChars());
+			return GlobalACSStrings.AddName(FName(ENamedName(type->GetValueInt(addr))));
 		}
 		else if (type == TypeString)
 		{
@@ -5230,7 +5269,9 @@ int DLevelScript::SwapActorTeleFog(AActor *activator, int tid)
 			}
 			else if (argtype == TypeString)
 			{
-				strings.Push(Level->Behaviors.LookupString(args[i]));
+				const FString *pooled = GlobalACSStrings.GetFString(args[i]);
+				if (pooled != nullptr) strings.Push(*pooled);
+				else strings.Push(Level->Behaviors.LookupString(args[i]));
 				params.Push(&strings.Last());
 			}
 			else if (argtype == TypeSound)
@@ -5264,7 +5305,7 @@ int DLevelScript::SwapActorTeleFog(AActor *activator, int tid)
 				VMCall(func, &params[0], params.Size(), &ret, 1);
 				if (rettype == TypeName)
 				{
-					retval = GlobalACSStrings.AddString(FName(ENamedName(retval)).GetChars());
+					retval = GlobalACSStrings.AddName(FName(ENamedName(retval)));
 				}
 				else if (rettype == TypeSound)
 				{
@@ -5468,7 +5509,7 @@ int DLevelScript::CallFunction(int argCount, int funcIndex, int32_t *args)
 				switch(args[0])
 				{
 					case ARMORINFO_CLASSNAME:
-						return GlobalACSStrings.AddString(equippedarmor->NameVar(NAME_ArmorType).GetChars());
+						return GlobalACSStrings.AddName(equippedarmor->NameVar(NAME_ArmorType));
 
 					case ARMORINFO_SAVEAMOUNT:
 						return equippedarmor->IntVar(NAME_MaxAmount);
@@ -5611,7 +5652,7 @@ int DLevelScript::CallFunction(int argCount, int funcIndex, int32_t *args)
 		case ACSF_GetActorClass:
 		{
 			AActor *a = Level->SingleActorFromTID(args[0], activator);
-			return GlobalACSStrings.AddString(a == NULL ? "None" : a->GetClass()->TypeName.GetChars());
+			return GlobalACSStrings.AddName(a == NULL ? FName(NAME_None) : a->GetClass()->TypeName);
 		}
 
 		case ACSF_SoundSequenceOnActor:
@@ -6049,7 +6090,7 @@ doplaysound:			if (funcIndex == ACSF_PlayActorSound)
             }
             else
             {
-				return GlobalACSStrings.AddString(activator->player->ReadyWeapon->GetClass()->TypeName.GetChars());
+				return GlobalACSStrings.AddName(activator->player->ReadyWeapon->GetClass()->TypeName);
             }
 
 		case ACSF_SpawnDecal:
@@ -6759,6 +6800,251 @@ static bool CharArrayParms(int &capacity, int &offset, int &a, FACSStackMemory&
 	return true;
 }
 
+//==========================================================================
+//
+// P-code translation
+//
+// Scripts that loop every tic spend most of their time on plain stack
+// arithmetic, variable access and branches. Runs of those p-codes get
+// decoded once per module into a simpler form with resolved operands and
+// cached branch targets, which RunScript executes before falling back to
+// the generic loop for everything else. Execution can only leave such a
+// block at a p-code boundary, so scripts can still be suspended, saved
+// and resumed from any point with the regular interpreter.
+//
+//==========================================================================
+
+CVAR(Bool, acs_translate, true, 0)
+
+enum ETranslatedOp
+{
+	TOP_Push,
+	TOP_PushLocal,
+	TOP_PushMapVar,
+	TOP_PushWorldVar,
+	TOP_PushGlobalVar,
+	TOP_AssignLocal,
+	TOP_AssignMapVar,
+	TOP_AssignWorldVar,
+	TOP_AssignGlobalVar,
+	TOP_AddLocal,
+	TOP_SubLocal,
+	TOP_IncLocal,
+	TOP_DecLocal,
+	TOP_IncMapVar,
+	TOP_DecMapVar,
+	TOP_Add,
+	TOP_Subtract,
+	TOP_Multiply,
+	TOP_EQ,
+	TOP_NE,
+	TOP_LT,
+	TOP_GT,
+	TOP_LE,
+	TOP_GE,
+	TOP_AndLogical,
+	TOP_OrLogical,
+	TOP_AndBitwise,
+	TOP_OrBitwise,
+	TOP_EorBitwise,
+	TOP_LShift,
+	TOP_RShift,
+	TOP_UnaryMinus,
+	TOP_NegateLogical,
+	TOP_NegateBinary,
+	TOP_Dup,
+	TOP_Swap,
+	TOP_Drop,
+	TOP_Goto,
+	TOP_IfGoto,
+	TOP_IfNotGoto,
+	TOP_Delay,
+	TOP_DelayDirect,
+};
+
+enum
+{
+	MAX_TRANSLATED_BLOCK = 256,
+	MAX_RUNAWAY = 2000000,
+
+	NO_BLOCK = -1,			// the p-code at this offset cannot be translated
+	UNKNOWN_BLOCK = -2,		// not looked up yet
+};
+
+//==========================================================================
+//
+// FBehavior :: GetTranslatedBlock
+//
+// Returns the translated block starting at the given offset, translating
+// it first if needed. NO_BLOCK means that the p-code at this offset must
+// go through the generic loop. Such offsets are only flagged so that the
+// generic loop does not pay for a map lookup on every p-code.
+//
+//==========================================================================
+
+int FBehavior::GetTranslatedBlock(uint32_t ofs)
+{
+	if (Untranslatable.Size() != (unsigned)DataSize)
+	{
+		Untranslatable.Resize(DataSize);
+		Untranslatable.Zero();
+	}
+	if (ofs >= (uint32_t)DataSize || Untranslatable[ofs])
+	{
+		return NO_BLOCK;
+	}
+
+	int *found = TranslatedBlockIndex.CheckKey(ofs);
+	if (found != nullptr)
+	{
+		return *found;
+	}
+
+	FTranslatedBlock block = { ofs, ofs, TranslatedOps.Size(), 0, UNKNOWN_BLOCK };
+	ACSFormat fmt = Format;
+	int *pc = Ofs2PC(ofs);
+	bool done = false;
+	unsigned pcodes = 0;
+
+	// Every op of a p-code records the p-codes up to and including its own,
+	// so the runaway and profiling counters count source p-codes.
+	auto addop = [&](int op, int arg, uint32_t target)
+	{
+		TranslatedOps.Push({ op, arg, PC2Ofs(pc), target, UNKNOWN_BLOCK, pcodes + 1 });
+		block.NumOps++;
+	};
+
+	// None of the translated p-codes is longer than 16 bytes.
+	while (!done && block.NumOps + 5 <= MAX_TRANSLATED_BLOCK && PC2Ofs(pc) + 16 <= (uint32_t)DataSize)
+	{
+		int *start = pc;
+		unsigned numops = block.NumOps;
+		int pcd, arg;
+		uint32_t target;
+
+		if (fmt == ACS_LittleEnhanced)
+		{
+			pcd = getbyte(pc);
+			if (pcd >= 256-16)
+			{
+				pcd = (256-16) + ((pcd - (256-16)) << 8) + getbyte(pc);
+			}
+		}
+		else
+		{
+			pcd = NEXTWORD;
+		}
+
+		switch (pcd)
+		{
+		case PCD_PUSHNUMBER:
+			arg = uallong(pc[0]);
+			pc++;
+			addop(TOP_Push, arg, 0);
+			break;
+
+		case PCD_PUSHBYTE:
+		case PCD_PUSH2BYTES:
+		case PCD_PUSH3BYTES:
+		case PCD_PUSH4BYTES:
+		case PCD_PUSH5BYTES:
+		{
+			int count = pcd == PCD_PUSHBYTE ? 1 : pcd - PCD_PUSH2BYTES + 2;
+			uint8_t *bytes = (uint8_t *)pc;
+			pc = (int *)(bytes + count);
+			for (int i = 0; i < count; i++)
+			{
+				addop(TOP_Push, bytes[i], 0);
+			}
+			break;
+		}
+
+		case PCD_PUSHSCRIPTVAR:		addop(TOP_PushLocal, NEXTBYTE, 0); break;
+		case PCD_PUSHMAPVAR:		addop(TOP_PushMapVar, NEXTBYTE, 0); break;
+		case PCD_PUSHWORLDVAR:		addop(TOP_PushWorldVar, NEXTBYTE, 0); break;
+		case PCD_PUSHGLOBALVAR:		addop(TOP_PushGlobalVar, NEXTBYTE, 0); break;
+		case PCD_ASSIGNSCRIPTVAR:	addop(TOP_AssignLocal, NEXTBYTE, 0); break;
+		case PCD_ASSIGNMAPVAR:		addop(TOP_AssignMapVar, NEXTBYTE, 0); break;
+		case PCD_ASSIGNWORLDVAR:	addop(TOP_AssignWorldVar, NEXTBYTE, 0); break;
+		case PCD_ASSIGNGLOBALVAR:	addop(TOP_AssignGlobalVar, NEXTBYTE, 0); break;
+		case PCD_ADDSCRIPTVAR:		addop(TOP_AddLocal, NEXTBYTE, 0); break;
+		case PCD_SUBSCRIPTVAR:		addop(TOP_SubLocal, NEXTBYTE, 0); break;
+		case PCD_INCSCRIPTVAR:		addop(TOP_IncLocal, NEXTBYTE, 0); break;
+		case PCD_DECSCRIPTVAR:		addop(TOP_DecLocal, NEXTBYTE, 0); break;
+		case PCD_INCMAPVAR:			addop(TOP_IncMapVar, NEXTBYTE, 0); break;
+		case PCD_DECMAPVAR:			addop(TOP_DecMapVar, NEXTBYTE, 0); break;
+
+		case PCD_ADD:				addop(TOP_Add, 0, 0); break;
+		case PCD_SUBTRACT:			addop(TOP_Subtract, 0, 0); break;
+		case PCD_MULTIPLY:			addop(TOP_Multiply, 0, 0); break;
+		case PCD_EQ:				addop(TOP_EQ, 0, 0); break;
+		case PCD_NE:				addop(TOP_NE, 0, 0); break;
+		case PCD_LT:				addop(TOP_LT, 0, 0); break;
+		case PCD_GT:				addop(TOP_GT, 0, 0); break;
+		case PCD_LE:				addop(TOP_LE, 0, 0); break;
+		case PCD_GE:				addop(TOP_GE, 0, 0); break;
+		case PCD_ANDLOGICAL:		addop(TOP_AndLogical, 0, 0); break;
+		case PCD_ORLOGICAL:			addop(TOP_OrLogical, 0, 0); break;
+		case PCD_ANDBITWISE:		addop(TOP_AndBitwise, 0, 0); break;
+		case PCD_ORBITWISE:			addop(TOP_OrBitwise, 0, 0); break;
+		case PCD_EORBITWISE:		addop(TOP_EorBitwise, 0, 0); break;
+		case PCD_LSHIFT:			addop(TOP_LShift, 0, 0); break;
+		case PCD_RSHIFT:			addop(TOP_RShift, 0, 0); break;
+		case PCD_UNARYMINUS:		addop(TOP_UnaryMinus, 0, 0); break;
+		case PCD_NEGATELOGICAL:		addop(TOP_NegateLogical, 0, 0); break;
+		case PCD_NEGATEBINARY:		addop(TOP_NegateBinary, 0, 0); break;
+		case PCD_DUP:				addop(TOP_Dup, 0, 0); break;
+		case PCD_SWAP:				addop(TOP_Swap, 0, 0); break;
+		case PCD_DROP:				addop(TOP_Drop, 0, 0); break;
+		case PCD_DELAY:				addop(TOP_Delay, 0, 0); break;
+
+		case PCD_DELAYDIRECT:
+			arg = uallong(pc[0]);
+			pc++;
+			addop(TOP_DelayDirect, arg, 0);
+			break;
+
+		case PCD_DELAYDIRECTB:
+			arg = *(uint8_t *)pc;
+			pc = (int *)((uint8_t *)pc + 1);
+			addop(TOP_DelayDirect, arg, 0);
+			break;
+
+		case PCD_GOTO:
+		case PCD_IFGOTO:
+		case PCD_IFNOTGOTO:
+			target = LittleLong(*pc);
+			pc++;
+			if (target >= (uint32_t)DataSize)
+			{
+				pc = start;
+				done = true;
+				break;
+			}
+			addop(pcd == PCD_GOTO ? TOP_Goto : pcd == PCD_IFGOTO ? TOP_IfGoto : TOP_IfNotGoto, 0, target);
+			done = pcd == PCD_GOTO;
+			break;
+
+		default:
+			pc = start;
+			done = true;
+			break;
+		}
+		if (block.NumOps > numops) pcodes++;
+	}
+	block.End = PC2Ofs(pc);
+
+	if (block.NumOps == 0)
+	{
+		Untranslatable.Set(ofs);
+		return NO_BLOCK;
+	}
+
+	int index = TranslatedBlocks.Push(block);
+	TranslatedBlockIndex[ofs] = index;
+	return index;
+}
+
 PClass *DLevelScript::GetClassForIndex(int index) const
 {
 	return PClass::FindActor(Level->Behaviors.LookupString(index));
@@ -6857,7 +7143,132 @@ int DLevelScript::RunScript()
 
 	while (state == SCRIPT_Running)
 	{
-		if (++runaway > 2000000)
+		if (acs_translate)
+		{
+			FBehavior *module = activeBehavior;
+			const int hexendelay = (fmt == ACS_Old && gameinfo.gametype == GAME_Hexen);
+			int blocknum = module->GetTranslatedBlock(module->PC2Ofs(pc));
+
+			// pc always points to the start of the current block here.
+			while (runaway < MAX_RUNAWAY && blocknum != NO_BLOCK)
+			{
+				const FBehavior::FTranslatedBlock block = module->TranslatedBlocks[blocknum];
+				const FBehavior::FTranslatedOp *ops = &module->TranslatedOps[block.FirstOp];
+				int jump = -1;
+				unsigned i = 0;
+
+				while (i < block.NumOps)
+				{
+					const auto &op = ops[i++];
+					switch (op.Op)
+					{
+					case TOP_Push:				PushToStack(op.Arg); break;
+					case TOP_PushLocal:			PushToStack(locals[op.Arg]); break;
+					case TOP_PushMapVar:		PushToStack(*(module->MapVars[op.Arg])); break;
+					case TOP_PushWorldVar:		PushToStack(ACS_WorldVars[op.Arg]); break;
+					case TOP_PushGlobalVar:		PushToStack(ACS_GlobalVars[op.Arg]); break;
+					case TOP_AssignLocal:		locals[op.Arg] = STACK(1); sp--; break;
+					case TOP_AssignMapVar:		*(module->MapVars[op.Arg]) = STACK(1); sp--; break;
+					case TOP_AssignWorldVar:	ACS_WorldVars[op.Arg] = STACK(1); sp--; break;
+					case TOP_AssignGlobalVar:	ACS_GlobalVars[op.Arg] = STACK(1); sp--; break;
+					case TOP_AddLocal:			locals[op.Arg] += STACK(1); sp--; break;
+					case TOP_SubLocal:			locals[op.Arg] -= STACK(1); sp--; break;
+					case TOP_IncLocal:			++locals[op.Arg]; break;
+					case TOP_DecLocal:			--locals[op.Arg]; break;
+					case TOP_IncMapVar:			*(module->MapVars[op.Arg]) += 1; break;
+					case TOP_DecMapVar:			*(module->MapVars[op.Arg]) -= 1; break;
+					case TOP_Add:				STACK(2) = STACK(2) + STACK(1); sp--; break;
+					case TOP_Subtract:			STACK(2) = STACK(2) - STACK(1); sp--; break;
+					case TOP_Multiply:			STACK(2) = STACK(2) * STACK(1); sp--; break;
+					case TOP_EQ:				STACK(2) = (STACK(2) == STACK(1)); sp--; break;
+					case TOP_NE:				STACK(2) = (STACK(2) != STACK(1)); sp--; break;
+					case TOP_LT:				STACK(2) = (STACK(2) < STACK(1)); sp--; break;
+					case TOP_GT:				STACK(2) = (STACK(2) > STACK(1)); sp--; break;
+					case TOP_LE:				STACK(2) = (STACK(2) <= STACK(1)); sp--; break;
+					case TOP_GE:				STACK(2) = (STACK(2) >= STACK(1)); sp--; break;
+					case TOP_AndLogical:		STACK(2) = (STACK(2) && STACK(1)); sp--; break;
+					case TOP_OrLogical:			STACK(2) = (STACK(2) || STACK(1)); sp--; break;
+					case TOP_AndBitwise:		STACK(2) = (STACK(2) & STACK(1)); sp--; break;
+					case TOP_OrBitwise:			STACK(2) = (STACK(2) | STACK(1)); sp--; break;
+					case TOP_EorBitwise:		STACK(2) = (STACK(2) ^ STACK(1)); sp--; break;
+					case TOP_LShift:			STACK(2) = (STACK(2) << STACK(1)); sp--; break;
+					case TOP_RShift:			STACK(2) = (STACK(2) >> STACK(1)); sp--; break;
+					case TOP_UnaryMinus:		STACK(1) = -STACK(1); break;
+					case TOP_NegateLogical:		STACK(1) = !STACK(1); break;
+					case TOP_NegateBinary:		STACK(1) = ~STACK(1); break;
+					case TOP_Dup:				Stack[sp] = Stack[sp-1]; sp++; break;
+					case TOP_Swap:				std::swap(Stack[sp-2], Stack[sp-1]); break;
+					case TOP_Drop:				sp--; break;
+
+					case TOP_Goto:
+						jump = block.FirstOp + i - 1;
+						break;
+
+					case TOP_IfGoto:
+						if (STACK(1)) jump = block.FirstOp + i - 1;
+						sp--;
+						break;
+
+					case TOP_IfNotGoto:
+						if (!STACK(1)) jump = block.FirstOp + i - 1;
+						sp--;
+						break;
+
+					case TOP_Delay:
+						statedata = STACK(1) + hexendelay;
+						if (statedata > 0)
+						{
+							state = SCRIPT_Delayed;
+						}
+						sp--;
+						break;
+
+					case TOP_DelayDirect:
+						statedata = op.Arg + hexendelay;
+						if (statedata > 0)
+						{
+							state = SCRIPT_Delayed;
+						}
+						break;
+					}
+					if (jump >= 0 || state != SCRIPT_Running) break;
+				}
+				runaway += ops[i - 1].PCodes;
+
+				if (jump >= 0)
+				{
+					uint32_t target = module->TranslatedOps[jump].Target;
+					if (module->TranslatedOps[jump].TargetBlock == UNKNOWN_BLOCK)
+					{
+						int targetblock = module->GetTranslatedBlock(target);
+						module->TranslatedOps[jump].TargetBlock = targetblock;
+					}
+					pc = module->Ofs2PC(target);
+					blocknum = module->TranslatedOps[jump].TargetBlock;
+				}
+				else if (state != SCRIPT_Running)
+				{
+					pc = module->Ofs2PC(ops[i - 1].Next);
+					break;
+				}
+				else
+				{
+					if (block.NextBlock == UNKNOWN_BLOCK)
+					{
+						int nextblock = module->GetTranslatedBlock(block.End);
+						module->TranslatedBlocks[blocknum].NextBlock = nextblock;
+					}
+					pc = module->Ofs2PC(block.End);
+					blocknum = module->TranslatedBlocks[blocknum].NextBlock;
+				}
+			}
+			if (state != SCRIPT_Running)
+			{
+				break;
+			}
+		}
+
+		if (++runaway > MAX_RUNAWAY)
 		{
 			Printf ("Runaway %s terminated\n", ScriptPresentation(script).GetChars());
 			state = SCRIPT_PleaseRemove;
@@ -103,7 +103,9 @@ public:
 	ACSStringPool();
 	int AddString(const char *str);
 	int AddString(FString &str);
+	int AddName(FName name);
 	const char *GetString(int strnum);
+	const FString *GetFString(int strnum);
 	void LockString(int levelnum, int strnum);
 	void UnlockAll();
 	void MarkString(int strnum);
@@ -382,6 +384,31 @@ public:
 
 	BoundsCheckingArray<int32_t *, NUM_MAPVARS> MapVars;
 
+	// Runs of simple p-codes, decoded once so the script loop can skip the
+	// generic decoder and dispatcher for them. See DLevelScript::RunScript.
+	struct FTranslatedOp
+	{
+		int Op;
+		int Arg;
+		uint32_t Next;			// offset of the following p-code
+		uint32_t Target;		// jump target offset
+		int TargetBlock;		// block at Target, -2 until the jump was first taken
+		unsigned PCodes;		// number of p-codes in the block up to and including this op's
+	};
+
+	struct FTranslatedBlock
+	{
+		uint32_t Start;
+		uint32_t End;			// offset of the first p-code that was not translated
+		unsigned FirstOp;
+		unsigned NumOps;
+		int NextBlock;			// block at End, -2 until first reached
+	};
+
+	TArray<FTranslatedOp> TranslatedOps;
+	TArray<FTranslatedBlock> TranslatedBlocks;
+	int GetTranslatedBlock(uint32_t ofs);
+
 
 private:
 	struct ArrayInfo;
@@ -410,6 +437,8 @@ private:
 	TArray<FBehavior *> Imports;
 	char ModuleName[9];
 	TArray<int> JumpPoints;
+	TMap<uint32_t, int> TranslatedBlockIndex;
+	BitArray Untranslatable;	// offsets whose p-code must go through the generic loop
 
 	void LoadScriptsDirectory ();
 
@@ -49,6 +49,7 @@
 #include "g_levellocals.h"
 #include "vm.h"
 #include "actorinlines.h"
+#include "stats.h"
 
 #include "gi.h"
 
@@ -108,15 +109,6 @@ double yspeed[8] = {0,SQRTHALF,1,SQRTHALF,0,-SQRTHALF,-1,-SQRTHALF};
 //
 
 
-//----------------------------------------------------------------------------
-//
-// PROC P_RecursiveSound
-//
-// Called by P_NoiseAlert.
-// Traverses adjacent sectors,
-// sound blocking lines cut off traversal.
-//----------------------------------------------------------------------------
-
 struct NoiseTarget
 {
 	sector_t *sec;
@@ -149,55 +141,220 @@ static void NoiseMarkSector(sector_t *sec, AActor *soundtarget, bool splash, AAc
 	NoiseList.Push({ sec, soundblocks });
 }
 
+//----------------------------------------------------------------------------
+//
+// Sound propagation graph
+//
+// Evaluating the closed door check for every line of every flooded sector
+// and probing plane portals with PointInSector is what made noise alerts
+// expensive on large maps. The graph caches these per sector and only
+// recomputes them for sectors whose planes or portals have changed since
+// they were last looked at, so a moving door or lift only invalidates the
+// lines around it.
+//
+// On top of that the most recent floods are kept by source sector and
+// replayed without traversing the graph again as long as none of the
+// sectors and lines they depended on have changed.
+//
+//----------------------------------------------------------------------------
 
-static void P_RecursiveSound(sector_t *sec, AActor *soundtarget, bool splash, AActor *emitter, int soundblocks, double maxdist)
+class FSoundGraph
 {
-	bool checkabove = !sec->PortalBlocksSound(sector_t::ceiling);
-	bool checkbelow = !sec->PortalBlocksSound(sector_t::floor);
+	struct Node
+	{
+		secplane_t floorplane, ceilingplane;	// the state 'version' refers to
+		DVector2 abovedisp, belowdisp;
+		bool checkabove, checkbelow;
+		bool portalsvalid;
+		int version;
+		int validated;			// flood in which the state above was last compared
+		int recorded;			// flood which last recorded this sector's version
+		int traced;				// flood which last recorded this sector's lines
+		unsigned firstedge;
+		TArray<sector_t *> portalsectors;
+	};
 
-	for (auto check : sec->Lines)
+	// One per entry in sector_t::Lines
+	struct Edge
 	{
-		// check sector portals
-		// I wish there was a better method to do this than randomly looking through the portal at a few places...
-		if (checkabove)
-		{
-			sector_t *upper = sec->Level->PointInSector(check->v1->fPos() + check->Delta() / 2 + sec->GetPortalDisplacement(sector_t::ceiling));
-			NoiseMarkSector(upper, soundtarget, splash, emitter, soundblocks, maxdist);
-		}
-		if (checkbelow)
-		{
-			sector_t *lower = sec->Level->PointInSector(check->v1->fPos() + check->Delta() / 2 + sec->GetPortalDisplacement(sector_t::floor));
-			NoiseMarkSector(lower, soundtarget, splash, emitter, soundblocks, maxdist);
-		}
+		sector_t *other;		// nullptr if the line cannot connect two sectors
+		int secversion;
+		int otherversion;
+		bool closed;
+	};
 
-		// ... and line portals;
+	struct SectorState
+	{
+		sector_t *sec;
+		int version;
+	};
+
+	struct LineState
+	{
+		line_t *line;
+		uint32_t flags;
+		sector_t *portaldest;
+	};
+
+	struct Flood
+	{
+		sector_t *source = nullptr;
+		TArray<NoiseTarget> marks;
+		TArray<SectorState> sectors;
+		TArray<LineState> lines;
+	};
+
+	enum { NUM_FLOODS = 8 };
+
+	FLevelLocals *Level = nullptr;
+	TArray<Node> Nodes;
+	TArray<Edge> Edges;
+	Flood Floods[NUM_FLOODS];
+	int NextFlood = 0;
+	int FloodCount = 0;
+
+	int Validate(sector_t *sec);
+	bool EdgeClosed(sector_t *sec, unsigned index);
+	void UpdatePortalSectors(sector_t *sec);
+	void Record(Flood *flood, sector_t *sec);
+	bool IsCurrent(Flood &flood);
+	void Traverse(sector_t *sec, AActor *soundtarget, bool splash, AActor *emitter, int soundblocks, double maxdist);
+
+	static sector_t *LinePortalDest(line_t *check)
+	{
 		FLinePortal *port = check->getPortal();
-		if (port && (port->mFlags & PORTF_SOUNDTRAVERSE))
+		if (port && (port->mFlags & PORTF_SOUNDTRAVERSE) && port->mDestination)
 		{
-			if (port->mDestination)
+			return port->mDestination->frontsector;
+		}
+		return nullptr;
+	}
+
+public:
+	int Replayed = 0, Traversed = 0, EdgeUpdates = 0;
+
+	void Clear();
+	void Build(FLevelLocals *Level);
+	void NoiseAlert(AActor *emitter, AActor *target, bool splash, double maxdist);
+};
+
+static FSoundGraph SoundGraph;
+
+//----------------------------------------------------------------------------
+//
+//
+//
+//----------------------------------------------------------------------------
+
+void FSoundGraph::Clear()
+{
+	Level = nullptr;
+	Nodes.Reset();
+	Edges.Reset();
+	for (auto &flood : Floods)
+	{
+		flood.source = nullptr;
+		flood.marks.Reset();
+		flood.sectors.Reset();
+		flood.lines.Reset();
+	}
+	NextFlood = 0;
+	FloodCount = 0;
+}
+
+void FSoundGraph::Build(FLevelLocals *l)
+{
+	Clear();
+	Level = l;
+	Nodes.Resize(l->sectors.Size());
+	for (auto &sec : l->sectors)
+	{
+		auto &node = Nodes[sec.Index()];
+		node.floorplane = sec.floorplane;
+		node.ceilingplane = sec.ceilingplane;
+		node.checkabove = !sec.PortalBlocksSound(sector_t::ceiling);
+		node.checkbelow = !sec.PortalBlocksSound(sector_t::floor);
+		node.abovedisp = node.checkabove ? sec.GetPortalDisplacement(sector_t::ceiling) : DVector2(0, 0);
+		node.belowdisp = node.checkbelow ? sec.GetPortalDisplacement(sector_t::floor) : DVector2(0, 0);
+		node.portalsvalid = false;
+		node.version = 0;
+		node.validated = 0;
+		node.recorded = 0;
+		node.traced = 0;
+		node.firstedge = Edges.Size();
+
+		for (auto check : sec.Lines)
+		{
+			Edge edge = { nullptr, -1, -1, false };
+
+			// Early out for one-sided and intra-sector lines
+			if (check->sidedef[1] != nullptr && check->sidedef[0]->sector != check->sidedef[1]->sector)
 			{
-				NoiseMarkSector(port->mDestination->frontsector, soundtarget, splash, emitter, soundblocks, maxdist);
+				edge.other = check->sidedef[0]->sector == &sec ? check->sidedef[1]->sector : check->sidedef[0]->sector;
 			}
+			Edges.Push(edge);
 		}
+	}
+}
 
+//----------------------------------------------------------------------------
+//
+// Compares a sector against its snapshot once per flood and bumps its
+// version if anything the traversal depends on has changed.
+//
+//----------------------------------------------------------------------------
 
-		if (check->sidedef[1] == NULL ||
-			!(check->flags & ML_TWOSIDED))
+int FSoundGraph::Validate(sector_t *sec)
+{
+	auto &node = Nodes[sec->Index()];
+	if (node.validated != FloodCount)
+	{
+		node.validated = FloodCount;
+
+		bool checkabove = !sec->PortalBlocksSound(sector_t::ceiling);
+		bool checkbelow = !sec->PortalBlocksSound(sector_t::floor);
+		DVector2 abovedisp = checkabove ? sec->GetPortalDisplacement(sector_t::ceiling) : DVector2(0, 0);
+		DVector2 belowdisp = checkbelow ? sec->GetPortalDisplacement(sector_t::floor) : DVector2(0, 0);
+
+		if (checkabove != node.checkabove || checkbelow != node.checkbelow || abovedisp != node.abovedisp || belowdisp != node.belowdisp)
 		{
-			continue;
+			node.checkabove = checkabove;
+			node.checkbelow = checkbelow;
+			node.abovedisp = abovedisp;
+			node.belowdisp = belowdisp;
+			node.portalsvalid = false;
+			node.version++;
 		}
+		if (sec->floorplane != node.floorplane || sec->ceilingplane != node.ceilingplane)
+		{
+			node.floorplane = sec->floorplane;
+			node.ceilingplane = sec->ceilingplane;
+			node.version++;
+		}
+	}
+	return node.version;
+}
 
-		// Early out for intra-sector lines
-		if (check->sidedef[0]->sector == check->sidedef[1]->sector) continue;
+//----------------------------------------------------------------------------
+//
+// check for closed door
+//
+//----------------------------------------------------------------------------
 
-		sector_t *other;
-		if (check->sidedef[0]->sector == sec)
-			other = check->sidedef[1]->sector;
-		else
-			other = check->sidedef[0]->sector;
+bool FSoundGraph::EdgeClosed(sector_t *sec, unsigned index)
+{
+	auto &edge = Edges[Nodes[sec->Index()].firstedge + index];
+	int secversion = Validate(sec);
+	int otherversion = Validate(edge.other);
 
-		// check for closed door
-		if ((sec->floorplane.ZatPoint(check->v1->fPos()) >=
+	if (edge.secversion != secversion || edge.otherversion != otherversion)
+	{
+		line_t *check = sec->Lines[index];
+		sector_t *other = edge.other;
+
+		edge.secversion = secversion;
+		edge.otherversion = otherversion;
+		edge.closed = (sec->floorplane.ZatPoint(check->v1->fPos()) >=
 			other->ceilingplane.ZatPoint(check->v1->fPos()) &&
 			sec->floorplane.ZatPoint(check->v2->fPos()) >=
 			other->ceilingplane.ZatPoint(check->v2->fPos()))
@@ -208,7 +365,126 @@ static void P_RecursiveSound(sector_t *sec, AActor *soundtarget, bool splash, AA
 			|| (other->floorplane.ZatPoint(check->v1->fPos()) >=
 				other->ceilingplane.ZatPoint(check->v1->fPos()) &&
 				other->floorplane.ZatPoint(check->v2->fPos()) >=
-				other->ceilingplane.ZatPoint(check->v2->fPos())))
+				other->ceilingplane.ZatPoint(check->v2->fPos()));
+		EdgeUpdates++;
+	}
+	return edge.closed;
+}
+
+//----------------------------------------------------------------------------
+//
+// check sector portals
+// I wish there was a better method to do this than randomly looking through the portal at a few places...
+// At least the result only needs to be looked up again when the portal changes.
+//
+//----------------------------------------------------------------------------
+
+void FSoundGraph::UpdatePortalSectors(sector_t *sec)
+{
+	auto &node = Nodes[sec->Index()];
+	if (node.portalsvalid) return;
+
+	node.portalsvalid = true;
+	node.portalsectors.Clear();
+	for (auto check : sec->Lines)
+	{
+		if (node.checkabove)
+		{
+			sector_t *upper = Level->PointInSector(check->v1->fPos() + check->Delta() / 2 + node.abovedisp);
+			if (node.portalsectors.Find(upper) == node.portalsectors.Size()) node.portalsectors.Push(upper);
+		}
+		if (node.checkbelow)
+		{
+			sector_t *lower = Level->PointInSector(check->v1->fPos() + check->Delta() / 2 + node.belowdisp);
+			if (node.portalsectors.Find(lower) == node.portalsectors.Size()) node.portalsectors.Push(lower);
+		}
+	}
+}
+
+//----------------------------------------------------------------------------
+//
+// Stores everything a flood through this sector depended on, so that
+// IsCurrent can tell whether the flood would still have the same outcome.
+//
+//----------------------------------------------------------------------------
+
+void FSoundGraph::Record(Flood *flood, sector_t *sec)
+{
+	auto &node = Nodes[sec->Index()];
+	if (node.traced == FloodCount) return;
+	node.traced = FloodCount;
+
+	auto addsector = [=](sector_t *s)
+	{
+		auto &n = Nodes[s->Index()];
+		if (n.recorded != FloodCount)
+		{
+			n.recorded = FloodCount;
+			flood->sectors.Push({ s, Validate(s) });
+		}
+	};
+
+	addsector(sec);
+	for (unsigned i = 0; i < sec->Lines.Size(); i++)
+	{
+		line_t *check = sec->Lines[i];
+		sector_t *other = Edges[node.firstedge + i].other;
+		if (other != nullptr) addsector(other);
+		flood->lines.Push({ check, check->flags & (ML_TWOSIDED | ML_SOUNDBLOCK), LinePortalDest(check) });
+	}
+}
+
+bool FSoundGraph::IsCurrent(Flood &flood)
+{
+	for (auto &s : flood.sectors)
+	{
+		if (Validate(s.sec) != s.version) return false;
+	}
+	for (auto &l : flood.lines)
+	{
+		if ((l.line->flags & (ML_TWOSIDED | ML_SOUNDBLOCK)) != l.flags || LinePortalDest(l.line) != l.portaldest) return false;
+	}
+	return true;
+}
+
+//----------------------------------------------------------------------------
+//
+// PROC P_RecursiveSound
+//
+// Called by P_NoiseAlert.
+// Traverses adjacent sectors,
+// sound blocking lines cut off traversal.
+//----------------------------------------------------------------------------
+
+void FSoundGraph::Traverse(sector_t *sec, AActor *soundtarget, bool splash, AActor *emitter, int soundblocks, double maxdist)
+{
+	auto &node = Nodes[sec->Index()];
+
+	Validate(sec);
+	UpdatePortalSectors(sec);
+	for (auto portalsec : node.portalsectors)
+	{
+		NoiseMarkSector(portalsec, soundtarget, splash, emitter, soundblocks, maxdist);
+	}
+
+	for (unsigned i = 0; i < sec->Lines.Size(); i++)
+	{
+		line_t *check = sec->Lines[i];
+
+		// ... and line portals;
+		sector_t *portaldest = LinePortalDest(check);
+		if (portaldest != nullptr)
+		{
+			NoiseMarkSector(portaldest, soundtarget, splash, emitter, soundblocks, maxdist);
+		}
+
+		sector_t *other = Edges[node.firstedge + i].other;
+		if (other == nullptr || !(check->flags & ML_TWOSIDED))
+		{
+			continue;
+		}
+
+		if (EdgeClosed(sec, i))
 		{
 			continue;
 		}
@@ -225,7 +501,76 @@ static void P_RecursiveSound(sector_t *sec, AActor *soundtarget, bool splash, AA
 	}
 }
 
+//----------------------------------------------------------------------------
+//
+//
+//
+//----------------------------------------------------------------------------
+
+void FSoundGraph::NoiseAlert(AActor *emitter, AActor *target, bool splash, double maxdist)
+{
+	sector_t *source = emitter->Sector;
+
+	if (Level != emitter->Level || Nodes.Size() != Level->sectors.Size())
+	{
+		Build(emitter->Level);
+	}
+	FloodCount++;
+	validcount++;
+	NoiseList.Clear();
+
+	Flood *flood = nullptr;
+	for (auto &f : Floods)
+	{
+		if (f.source == source)
+		{
+			flood = &f;
+			break;
+		}
+	}
+
+	if (flood != nullptr && IsCurrent(*flood))
+	{
+		// The sound would take the same way as last time so only the actors need to be alerted.
+		for (auto &mark : flood->marks)
+		{
+			NoiseMarkSector(mark.sec, target, splash, emitter, mark.soundblocks, maxdist);
+		}
+		Replayed++;
+		return;
+	}
+
+	if (flood == nullptr)
+	{
+		flood = &Floods[NextFlood];
+		NextFlood = (NextFlood + 1) % NUM_FLOODS;
+		flood->source = source;
+	}
+	flood->sectors.Clear();
+	flood->lines.Clear();
+
+	NoiseMarkSector(source, target, splash, emitter, 0, maxdist);
+	for (unsigned i = 0; i < NoiseList.Size(); i++)
+	{
+		Record(flood, NoiseList[i].sec);
+		Traverse(NoiseList[i].sec, target, splash, emitter, NoiseList[i].soundblocks, maxdist);
+	}
+	flood->marks = NoiseList;
+	Traversed++;
+}
+
+void P_ClearSoundGraph()
+{
+	SoundGraph.Clear();
+}
 
+ADD_STAT(soundgraph)
+{
+	FString out;
+	out.Format("Noise alerts: %d traversed, %d replayed, %d line checks\n",
+		SoundGraph.Traversed, SoundGraph.Replayed, SoundGraph.EdgeUpdates);
+	return out;
+}
 
 
 //----------------------------------------------------------------------------
@@ -245,13 +590,7 @@ void P_NoiseAlert (AActor *emitter, AActor *target, bool splash, double maxdist)
 	if (target != NULL && target->player && (target->player->cheats & CF_NOTARGET))
 		return;
 
-	validcount++;
-	NoiseList.Clear();
-	NoiseMarkSector(emitter->Sector, target, splash, emitter, 0, maxdist);
-	for (unsigned i = 0; i < NoiseList.Size(); i++)
-	{
-		P_RecursiveSound(NoiseList[i].sec, target, splash, emitter, NoiseList[i].soundblocks, maxdist);
-	}
+	SoundGraph.NoiseAlert(emitter, target, splash, maxdist);
 }
 
 //----------------------------------------------------------------------------
@@ -1254,13 +1593,14 @@ int P_LookForMonsters (AActor *actor)
 AActor *LookForTIDInBlock (AActor *lookee, int index, void *extparams)
 {
 	FLookExParams *params = (FLookExParams *)extparams;
-	FBlockNode *block;
 	AActor *link;
 	AActor *other;
 	
-	for (block = lookee->Level->blockmap.blocklinks[index]; block != NULL; block = block->NextActor)
+	auto &blockmap = lookee->Level->blockmap;
+	int x = index % blockmap.bmapwidth, y = index / blockmap.bmapwidth;
+	FBlockThingsIterator it(lookee->Level, x, y, x, y);
+	while ((link = it.Next()))
 	{
-		link = block->Me;
 
         if (!(link->flags & MF_SHOOTABLE))
 			continue;			// not shootable (observer or dead)
@@ -1424,14 +1764,15 @@ int P_LookForTID (AActor *actor, INTBOOL allaround, FLookExParams *params)
 
 AActor *LookForEnemiesInBlock (AActor *lookee, int index, void *extparam)
 {
-	FBlockNode *block;
 	AActor *link;
 	AActor *other;
 	FLookExParams *params = (FLookExParams *)extparam;
 	
-	for (block = lookee->Level->blockmap.blocklinks[index]; block != NULL; block = block->NextActor)
+	auto &blockmap = lookee->Level->blockmap;
+	int x = index % blockmap.bmapwidth, y = index / blockmap.bmapwidth;
+	FBlockThingsIterator it(lookee->Level, x, y, x, y);
+	while ((link = it.Next()))
 	{
-		link = block->Me;
 
         if (!(link->flags & MF_SHOOTABLE))
 			continue;			// not shootable (observer or dead)
@@ -1751,14 +2092,12 @@ int P_LookForPlayers (AActor *actor, INTBOOL allaround, FLookExParams *params)
 // Stay in state until a player is sighted.
 // [RH] Will also leave state to move to goal.
 //
-DEFINE_ACTION_FUNCTION(AActor, A_Look)
+static void A_Look(AActor *self)
 {
-	PARAM_SELF_PROLOGUE(AActor);
-
 	AActor *targ;
 
 	if (self->flags5 & MF5_INCONVERSATION)
-		return 0;
+		return;
 
 	// [RH] Set goal now if appropriate
 	if (self->special == Thing_SetGoal && self->args[0] == 0) 
@@ -1790,7 +2129,7 @@ DEFINE_ACTION_FUNCTION(AActor, A_Look)
 
 		if (targ && targ->player && ((targ->player->cheats & CF_NOTARGET) || !(targ->flags & MF_FRIENDLY)))
 		{
-			return 0;
+			return;
 		}
 	}
 
@@ -1834,7 +2173,7 @@ DEFINE_ACTION_FUNCTION(AActor, A_Look)
 	}
 	
 	if (!P_LookForPlayers (self, self->flags4 & MF4_LOOKALLAROUND, NULL))
-		return 0;
+		return;
 				
 	// go into chase state
   seeyou:
@@ -1860,6 +2199,12 @@ DEFINE_ACTION_FUNCTION(AActor, A_Look)
 	{
 		self->SetState (self->SeeState);
 	}
+}
+
+DEFINE_ACTION_FUNCTION_NATIVE(AActor, A_Look, A_Look)
+{
+	PARAM_SELF_PROLOGUE(AActor);
+	A_Look(self);
 	return 0;
 }
 
@@ -2769,13 +3114,8 @@ void A_Chase(AActor *self)
 	A_DoChase(self, false, self->MeleeState, self->MissileState, true, gameinfo.nightmarefast, false, 0);
 }
 
-DEFINE_ACTION_FUNCTION(AActor, A_Chase)
+static void A_ChaseNative(AActor *self, int meleelabel, int missilelabel, int flags)
 {
-	PARAM_SELF_PROLOGUE(AActor);
-	PARAM_STATELABEL(meleelabel);
-	PARAM_STATELABEL(missilelabel);
-	PARAM_INT(flags);
-
 	FName meleename = ENamedName(meleelabel - 0x10000000);
 	FName missilename = ENamedName(missilelabel - 0x10000000);
 	if (meleename != NAME__a_chase_default || missilename != NAME__a_chase_default)
@@ -2783,7 +3123,7 @@ DEFINE_ACTION_FUNCTION(AActor, A_Chase)
 		FState *melee = StateLabels.GetState(meleelabel, self->GetClass());
 		FState *missile = StateLabels.GetState(missilelabel, self->GetClass());
 		if ((flags & CHF_RESURRECT) && P_CheckForResurrection(self, false))
-			return 0;
+			return;
 
 		A_DoChase(self, !!(flags&CHF_FASTCHASE), melee, missile, !(flags&CHF_NOPLAYACTIVE),
 			!!(flags&CHF_NIGHTMAREFAST), !!(flags&CHF_DONTMOVE), flags & 0x3fffffff);
@@ -2792,6 +3132,15 @@ DEFINE_ACTION_FUNCTION(AActor, A_Chase)
 	{
 		A_DoChase(self, false, self->MeleeState, self->MissileState, true, gameinfo.nightmarefast, false, 0);
 	}
+}
+
+DEFINE_ACTION_FUNCTION_NATIVE(AActor, A_Chase, A_ChaseNative)
+{
+	PARAM_SELF_PROLOGUE(AActor);
+	PARAM_STATELABEL(meleelabel);
+	PARAM_STATELABEL(missilelabel);
+	PARAM_INT(flags);
+	A_ChaseNative(self, meleelabel, missilelabel, flags);
 	return 0;
 }
 
@@ -2986,10 +3335,8 @@ AActor *P_DropItem (AActor *source, PClassActor *type, int dropamount, int chanc
 	return NULL;
 }
 
-DEFINE_ACTION_FUNCTION(AActor, A_Pain)
+static void A_Pain(AActor *self)
 {
-	PARAM_SELF_PROLOGUE(AActor);
-
 	// [RH] Vary player pain sounds depending on health (ala Quake2)
 	if (self->player && self->player->morphTics == 0)
 	{
@@ -3031,6 +3378,12 @@ DEFINE_ACTION_FUNCTION(AActor, A_Pain)
 	{
 		S_Sound (self, CHAN_VOICE, 0, self->PainSound, 1, ATTN_NORM);
 	}
+}
+
+DEFINE_ACTION_FUNCTION_NATIVE(AActor, A_Pain, A_Pain)
+{
+	PARAM_SELF_PROLOGUE(AActor);
+	A_Pain(self);
 	return 0;
 }
 
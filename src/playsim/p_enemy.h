@@ -48,6 +48,7 @@ struct FLookExParams
 
 int P_HitFriend (AActor *self);
 void P_NoiseAlert (AActor *emmiter, AActor *target, bool splash=false, double maxdist=0);
+void P_ClearSoundGraph();
 
 bool P_CheckMeleeRange2 (AActor *actor);
 int P_Move (AActor *actor);
@@ -227,6 +227,7 @@ enum PCM
 
 AActor *P_BlockmapSearch (AActor *mo, int distance, AActor *(*check)(AActor*, int, void *), void *params = NULL);
 AActor *P_RoughMonsterSearch (AActor *mo, int distance, bool onlyseekable=false, bool frontonly = false);
+void P_FinishThingGrid(FLevelLocals *Level);
 
 //
 // P_MAP
@@ -92,6 +92,8 @@
 #include "r_sky.h"
 #include "g_levellocals.h"
 #include "actorinlines.h"
+#include "gamestate.h"
+#include "stats.h"
 
 CVAR(Bool, cl_bloodsplats, true, CVAR_ARCHIVE)
 CVAR(Int, sv_smartaim, 0, CVAR_ARCHIVE | CVAR_SERVERINFO)
@@ -379,6 +381,67 @@ CCMD(ffcf)
 	P_FindFloorCeiling(players[0].mo, 0);
 	ffcf_verbose = false;
 }
+
+//==========================================================================
+//
+// CCMD benchmovement [passes]
+//
+// Microbenchmark for the data access pattern of P_CheckPosition: every
+// actor in the blockmap walks the things around it and runs the same
+// bounding box and flag tests. Nothing gets modified, so this can be run
+// on a live level to compare how actor layout changes affect the cost of
+// touching thousands of actors per tic.
+//
+//==========================================================================
+
+CCMD(benchmovement)
+{
+	if (gamestate != GS_LEVEL)
+	{
+		Printf("benchmovement can only be used in a level\n");
+		return;
+	}
+
+	int passes = argv.argc() > 1 ? std::max(1, atoi(argv[1])) : 10;
+	auto Level = primaryLevel;
+	int checks = 0, contacts = 0;
+	cycle_t timer;
+
+	timer.Reset();
+	timer.Clock();
+	for (int i = 0; i < passes; i++)
+	{
+		auto it = Level->GetThinkerIterator<AActor>();
+		AActor *thing;
+		while ((thing = it.Next()))
+		{
+			if (thing->flags & MF_NOBLOCKMAP) continue;
+
+			FPortalGroupArray pcheck;
+			FMultiBlockThingsIterator it2(pcheck, Level, thing->X(), thing->Y(), thing->Z(), thing->Height, thing->radius, false, thing->Sector);
+			FMultiBlockThingsIterator::CheckResult cres;
+			checks++;
+
+			while (it2.Next(&cres))
+			{
+				AActor *other = cres.thing;
+				if (other == thing) continue;
+				if (!((other->flags & (MF_SOLID | MF_SPECIAL | MF_SHOOTABLE)) || other->flags6 & MF6_TOUCHY)) continue;
+
+				double blockdist = other->radius + thing->radius;
+				if (fabs(other->X() - cres.Position.X) >= blockdist || fabs(other->Y() - cres.Position.Y) >= blockdist) continue;
+				if ((other->flags2 | thing->flags2) & MF2_THRUACTORS) continue;
+				if (other->Top() < thing->Z() || other->Z() > thing->Top()) continue;
+				contacts++;
+			}
+		}
+	}
+	timer.Unclock();
+
+	Printf("%d position checks, %d contacts in %.3f ms (%.1f ns per check)\n", checks, contacts,
+		timer.TimeMS(), checks > 0 ? timer.TimeMS() * 1e6 / checks : 0.);
+	Printf("sizeof(AActor) = %zu, movement data ends at offset %zu\n", sizeof(AActor), myoffsetof(AActor, Friction) + sizeof(double));
+}
 //==========================================================================
 //
 // TELEPORT MOVE
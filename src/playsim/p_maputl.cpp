@@ -273,6 +273,32 @@ void P_LineOpening (FLineOpening &open, AActor *actor, const line_t *linedef, co
 // THING POSITION SETTING
 //
 
+//==========================================================================
+//
+// UnlinkFromBlocks
+//
+// [RH] Unlink from all blocks this actor uses
+//
+//==========================================================================
+
+static void UnlinkFromBlocks(AActor *actor)
+{
+	FBlockNode *block = actor->BlockNode;
+
+	while (block != NULL)
+	{
+		if (block->NextActor != NULL)
+		{
+			block->NextActor->PrevActor = block->PrevActor;
+		}
+		*(block->PrevActor) = block->NextActor;
+		FBlockNode *next = block->NextBlock;
+		block->Release ();
+		block = next;
+	}
+	actor->BlockNode = NULL;
+}
+
 //==========================================================================
 //
 // P_UnsetThingPosition
@@ -328,23 +354,10 @@ void AActor::UnlinkFromWorld (FLinkContext *ctx)
 		}
 	}
 		
+	Level->blockmap.thinggrid.Unlink(this);
 	if (!(flags & MF_NOBLOCKMAP))
 	{
-		// [RH] Unlink from all blocks this actor uses
-		FBlockNode *block = this->BlockNode;
-
-		while (block != NULL)
-		{
-			if (block->NextActor != NULL)
-			{
-				block->NextActor->PrevActor = block->PrevActor;
-			}
-			*(block->PrevActor) = block->NextActor;
-			FBlockNode *next = block->NextBlock;
-			block->Release ();
-			block = next;
-		}
-		BlockNode = NULL;
+		UnlinkFromBlocks(this);
 	}
 	ClearRenderSectorList();
 	ClearRenderLineList();
@@ -531,6 +544,11 @@ void AActor::LinkToWorld(FLinkContext *ctx, bool spawningmapthing, sector_t *sec
 				y1 = MAX(0, y1);
 				x2 = MIN(Level->blockmap.bmapwidth - 1, x2);
 				y2 = MIN(Level->blockmap.bmapheight - 1, y2);
+				if (i == -1 && Level->blockmap.thinggrid.isActive())
+				{
+					Level->blockmap.thinggrid.Link(this, x1, y1, x2, y2);
+					if (Level->blockmap.thinggrid.ReplacesChains) continue;
+				}
 				for (int y = y1; y <= y2; ++y)
 				{
 					for (int x = x1; x <= x2; ++x)
@@ -570,6 +588,41 @@ void AActor::SetOrigin(double x, double y, double z, bool moving)
 	if (!moving) ClearInterpolation();
 }
 
+//==========================================================================
+//
+// P_FinishThingGrid
+//
+// Called once the level is set up. Without portal groups the thing grid
+// serves all thing queries, so the block chains of the actors that were
+// spawned so far are released and no new ones get created. Levels with
+// portal groups need the chains, so the grid is dropped.
+//
+//==========================================================================
+
+void P_FinishThingGrid(FLevelLocals *Level)
+{
+	auto &grid = Level->blockmap.thinggrid;
+	if (!grid.isActive() || grid.ReplacesChains) return;
+
+	bool usechains = Level->Displacements.size > 1;
+	auto it = Level->GetThinkerIterator<AActor>();
+	AActor *ac;
+	while ((ac = it.Next()))
+	{
+		if (usechains)
+		{
+			ac->gnext = NULL;
+			ac->gprev = NULL;
+		}
+		else
+		{
+			UnlinkFromBlocks(ac);
+		}
+	}
+	if (usechains) grid.Clear();
+	else grid.ReplacesChains = true;
+}
+
 
 
 //
@@ -894,6 +947,10 @@ FBlockThingsIterator::FBlockThingsIterator(FLevelLocals *l)
 	Level = l;
 	minx = maxx = 0;
 	miny = maxy = 0;
+	usegrid = Level->blockmap.thinggrid.ReplacesChains;
+	gridhash = true;
+	gridthing = NULL;
+	gridlevel = FThingGrid::NUM_LEVELS;
 	ClearHash();
 	block = NULL;
 }
@@ -906,8 +963,7 @@ FBlockThingsIterator::FBlockThingsIterator(FLevelLocals *l, int _minx, int _miny
 	maxx = _maxx;
 	miny = _miny;
 	maxy = _maxy;
-	ClearHash();
-	Reset();
+	StartArea();
 }
 
 void FBlockThingsIterator::init(const FBoundingBox &box)
@@ -916,10 +972,66 @@ void FBlockThingsIterator::init(const FBoundingBox &box)
 	miny = Level->blockmap.GetBlockY(box.Bottom());
 	maxx = Level->blockmap.GetBlockX(box.Right());
 	minx = Level->blockmap.GetBlockX(box.Left());
-	ClearHash();
+	StartArea();
+}
+
+//===========================================================================
+//
+// FBlockThingsIterator :: StartArea
+//
+// If the thing grid replaces the block chains it returns the same actors,
+// just in a different order and without the need to weed out duplicates.
+//
+//===========================================================================
+
+void FBlockThingsIterator::StartArea()
+{
+	usegrid = Level->blockmap.thinggrid.ReplacesChains;
+	gridhash = false;
+	if (usegrid)
+	{
+		SetGridBox();
+		block = NULL;
+	}
+	else
+	{
+		ClearHash();
+	}
 	Reset();
 }
 
+void FBlockThingsIterator::SetGridBox()
+{
+	gridbox[0] = MAX(minx, 0);
+	gridbox[1] = MAX(miny, 0);
+	gridbox[2] = MIN(maxx, Level->blockmap.bmapwidth - 1);
+	gridbox[3] = MIN(maxy, Level->blockmap.bmapheight - 1);
+}
+
+//===========================================================================
+//
+// FBlockThingsIterator :: Reset
+//
+//===========================================================================
+
+void FBlockThingsIterator::Reset()
+{
+	if (!usegrid)
+	{
+		StartBlock(minx, miny);
+	}
+	else if (gridbox[0] > gridbox[2] || gridbox[1] > gridbox[3])
+	{
+		// area is off the map
+		gridlevel = FThingGrid::NUM_LEVELS;
+		gridthing = NULL;
+	}
+	else
+	{
+		StartGridLevel(0);
+	}
+}
+
 //===========================================================================
 //
 // FBlockThingsIterator :: ClearHash
@@ -964,7 +1076,61 @@ void FBlockThingsIterator::SwitchBlock(int x, int y)
 {
 	minx = maxx = x;
 	miny = maxy = y;
-	StartBlock(x, y);
+	if (usegrid)
+	{
+		SetGridBox();
+		Reset();
+	}
+	else
+	{
+		StartBlock(x, y);
+	}
+}
+
+//===========================================================================
+//
+// FBlockThingsIterator :: CheckHash
+//
+// Returns true if the actor was already returned. Otherwise it gets added
+// to the hash table.
+//
+//===========================================================================
+
+bool FBlockThingsIterator::CheckHash(AActor *me)
+{
+	HashEntry *entry;
+	int i;
+
+	size_t hash = ((size_t)me >> 3) % countof(Buckets);
+	for (i = Buckets[hash]; i >= 0; )
+	{
+		entry = GetHashEntry(i);
+		if (entry->Actor == me)
+		{ // I've already been checked. Skip to the next actor.
+			return true;
+		}
+		i = entry->Next;
+	}
+	// Add me to the hash table.
+	if (NumFixedHash < (int)countof(FixedHash))
+	{
+		entry = &FixedHash[NumFixedHash];
+		entry->Next = Buckets[hash];
+		Buckets[hash] = NumFixedHash++;
+	}
+	else
+	{
+		if (DynHash.Size() == 0)
+		{
+			DynHash.Grow(50);
+		}
+		i = DynHash.Reserve(1);
+		entry = &DynHash[i];
+		entry->Next = Buckets[hash];
+		Buckets[hash] = i + countof(FixedHash);
+	}
+	entry->Actor = me;
+	return false;
 }
 
 //===========================================================================
@@ -975,14 +1141,16 @@ void FBlockThingsIterator::SwitchBlock(int x, int y)
 
 AActor *FBlockThingsIterator::Next(bool centeronly)
 {
+	if (usegrid)
+	{
+		return NextInGrid(centeronly);
+	}
 	for (;;)
 	{
 		while (block != NULL)
 		{
 			AActor *me = block->Me;
 			FBlockNode *mynode = block;
-			HashEntry *entry;
-			int i;
 
 			block = block->NextActor;
 			// Don't recheck things that were already checked
@@ -1005,40 +1173,9 @@ AActor *FBlockThingsIterator::Next(bool centeronly)
 					return me;
 				}
 			}
-			else
+			else if (!CheckHash(me))
 			{
-				size_t hash = ((size_t)me >> 3) % countof(Buckets);
-				for (i = Buckets[hash]; i >= 0; )
-				{
-					entry = GetHashEntry(i);
-					if (entry->Actor == me)
-					{ // I've already been checked. Skip to the next actor.
-						break;
-					}
-					i = entry->Next;
-				}
-				if (i < 0)
-				{ // Add me to the hash table and return me.
-					if (NumFixedHash < (int)countof(FixedHash))
-					{
-						entry = &FixedHash[NumFixedHash];
-						entry->Next = Buckets[hash];
-						Buckets[hash] = NumFixedHash++;
-					}
-					else
-					{
-						if (DynHash.Size() == 0)
-						{
-							DynHash.Grow(50);
-						}
-						i = DynHash.Reserve(1);
-						entry = &DynHash[i];
-						entry->Next = Buckets[hash];
-						Buckets[hash] = i + countof(FixedHash);
-					}
-					entry->Actor = me;
-					return me;
-				}
+				return me;
 			}
 		}
 
@@ -1052,6 +1189,97 @@ AActor *FBlockThingsIterator::Next(bool centeronly)
 }
 
 
+//===========================================================================
+//
+// FBlockThingsIterator :: StartGridLevel
+//
+// An actor at a grid level is linked into the cell of its first block and
+// spans at most one cell's width, so the cells to the left and below the
+// area need to be checked as well.
+//
+//===========================================================================
+
+void FBlockThingsIterator::StartGridLevel(int level)
+{
+	auto &grid = Level->blockmap.thinggrid;
+
+	gridlevel = level;
+	if (level >= FThingGrid::NUM_LEVELS)
+	{
+		gridthing = grid.Oversized;
+		return;
+	}
+
+	int cellblocks = grid.Levels[level].CellBlocks;
+	cellminx = MAX(gridbox[0] / cellblocks - 1, 0);
+	cellminy = MAX(gridbox[1] / cellblocks - 1, 0);
+	cellmaxx = gridbox[2] / cellblocks;
+	cellmaxy = gridbox[3] / cellblocks;
+	cellx = cellminx;
+	celly = cellminy;
+	gridthing = grid.Levels[level].Cells[celly * grid.Levels[level].Width + cellx];
+}
+
+//===========================================================================
+//
+// FBlockThingsIterator :: NextInGrid
+//
+// An area query sees every actor only once. The path traverser queries
+// one block after the other and needs the hash to skip actors that span
+// several blocks, like it does with the block chains. In compatibility
+// mode an actor is only returned for the block its center is in.
+//
+//===========================================================================
+
+AActor *FBlockThingsIterator::NextInGrid(bool centeronly)
+{
+	auto &grid = Level->blockmap.thinggrid;
+
+	for (;;)
+	{
+		while (gridthing != NULL)
+		{
+			AActor *me = gridthing;
+			gridthing = me->gnext;
+
+			if (centeronly)
+			{
+				int x = Level->blockmap.GetBlockX(me->X());
+				int y = Level->blockmap.GetBlockY(me->Y());
+				if (x >= gridbox[0] && x <= gridbox[2] && y >= gridbox[1] && y <= gridbox[3])
+				{
+					return me;
+				}
+			}
+			else if (me->GridBox[0] <= gridbox[2] && me->GridBox[2] >= gridbox[0] &&
+				me->GridBox[1] <= gridbox[3] && me->GridBox[3] >= gridbox[1])
+			{
+				if (gridhash && (me->GridBox[0] != me->GridBox[2] || me->GridBox[1] != me->GridBox[3]))
+				{
+					// may be found again in the next block
+					if (CheckHash(me)) continue;
+				}
+				return me;
+			}
+		}
+
+		if (gridlevel >= FThingGrid::NUM_LEVELS)
+		{
+			return NULL;
+		}
+		if (++cellx > cellmaxx)
+		{
+			cellx = cellminx;
+			if (++celly > cellmaxy)
+			{
+				StartGridLevel(gridlevel + 1);
+				continue;
+			}
+		}
+		gridthing = grid.Levels[gridlevel].Cells[celly * grid.Levels[gridlevel].Width + cellx];
+	}
+}
+
 
 //===========================================================================
 //
@@ -1706,6 +1934,18 @@ AActor *P_BlockmapSearch (AActor *mo, int distance, AActor *(*check)(AActor*, in
 	startX = Level->blockmap.GetBlockX(mo->X());
 	startY = Level->blockmap.GetBlockY(mo->Y());
 	validcount++;
+
+	if (distance > 0)
+	{
+		// Don't walk all the blocks if the searcher is the only thing within range.
+		FBlockThingsIterator it(Level, startX - distance, startY - distance, startX + distance, startY + distance);
+		if (it.UsesGrid())
+		{
+			AActor *other;
+			while ((other = it.Next()) == mo);
+			if (other == NULL) return NULL;
+		}
+	}
 	
 	if (Level->blockmap.isValidBlock(startX, startY))
 	{
@@ -1796,23 +2036,26 @@ static AActor *RoughBlockCheck (AActor *mo, int index, void *param)
 {
 	BlockCheckInfo *info = (BlockCheckInfo *)param;
 
-	FBlockNode *link;
+	auto &blockmap = mo->Level->blockmap;
+	int x = index % blockmap.bmapwidth, y = index / blockmap.bmapwidth;
+	FBlockThingsIterator it(mo->Level, x, y, x, y);
+	AActor *link;
 
-	for (link = mo->Level->blockmap.blocklinks[index]; link != NULL; link = link->NextActor)
+	while ((link = it.Next()))
 	{
-		if (link->Me != mo)
+		if (link != mo)
 		{
-			if (info->onlyseekable && !mo->CanSeek(link->Me))
+			if (info->onlyseekable && !mo->CanSeek(link))
 			{
 				continue;
 			}
-			if (info->frontonly && P_PointOnDivlineSide(link->Me->X(), link->Me->Y(), &info->frontline) != 0)
+			if (info->frontonly && P_PointOnDivlineSide(link->X(), link->Y(), &info->frontline) != 0)
 			{
 				continue;
 			}
-			if (mo->IsOkayToAttack (link->Me))
+			if (mo->IsOkayToAttack (link))
 			{
-				return link->Me;
+				return link;
 			}
 		}
 	}
@@ -301,9 +301,24 @@ class FBlockThingsIterator
 
 	HashEntry *GetHashEntry(int i) { return i < (int)countof(FixedHash) ? &FixedHash[i] : &DynHash[i - countof(FixedHash)]; }
 
+	// Queries walk the thing grid instead of the blocks if it replaces the block chains.
+	bool usegrid;
+	bool gridhash;		// set for the path traverser, see NextInGrid
+	int gridlevel;
+	int gridbox[4];
+	int cellx, celly;
+	int cellminx, cellmaxx;
+	int cellminy, cellmaxy;
+	AActor *gridthing;
+
 	void StartBlock(int x, int y);
 	void SwitchBlock(int x, int y);
 	void ClearHash();
+	bool CheckHash(AActor *me);
+	void StartArea();
+	void SetGridBox();
+	void StartGridLevel(int level);
+	AActor *NextInGrid(bool centeronly);
 
 	// The following is only for use in the path traverser 
 	// and therefore declared private.
@@ -321,7 +336,8 @@ public:
 	}
 	void init(const FBoundingBox &box);
 	AActor *Next(bool centeronly = false);
-	void Reset() { StartBlock(minx, miny); }
+	void Reset();
+	bool UsesGrid() const { return usegrid; }
 };
 
 class FMultiBlockThingsIterator
@@ -480,3 +480,67 @@ void FBlockNode::Release()
 	NextBlock = FreeBlocks;
 	FreeBlocks = this;
 }
+
+//===========================================================================
+//
+// FThingGrid
+//
+//===========================================================================
+
+void FThingGrid::Create(int bmapwidth, int bmapheight, int cellblocks)
+{
+	Clear();
+	if (cellblocks <= 0) return;
+
+	for (auto &level : Levels)
+	{
+		level.CellBlocks = cellblocks;
+		level.Width = (bmapwidth + cellblocks - 1) / cellblocks;
+		level.Height = (bmapheight + cellblocks - 1) / cellblocks;
+		level.Cells.Resize(level.Width * level.Height);
+		memset(level.Cells.Data(), 0, level.Cells.Size() * sizeof(AActor *));
+		cellblocks *= LEVEL_SCALE;
+	}
+}
+
+//===========================================================================
+//
+// The block range must already be clipped to the blockmap.
+//
+//===========================================================================
+
+void FThingGrid::Link(AActor *actor, int x1, int y1, int x2, int y2)
+{
+	AActor **link = &Oversized;
+	int size = MAX(x2 - x1, y2 - y1) + 1;
+
+	for (auto &level : Levels)
+	{
+		if (size <= level.CellBlocks)
+		{
+			link = &level.Cells[(y1 / level.CellBlocks) * level.Width + x1 / level.CellBlocks];
+			break;
+		}
+	}
+
+	actor->GridBox[0] = x1;
+	actor->GridBox[1] = y1;
+	actor->GridBox[2] = x2;
+	actor->GridBox[3] = y2;
+
+	if ((actor->gnext = *link))
+		actor->gnext->gprev = &actor->gnext;
+	actor->gprev = link;
+	*link = actor;
+}
+
+void FThingGrid::Unlink(AActor *actor)
+{
+	if (actor->gprev != nullptr)
+	{
+		if ((*actor->gprev = actor->gnext))
+			actor->gnext->gprev = actor->gprev;
+		actor->gnext = nullptr;
+		actor->gprev = nullptr;
+	}
+}
@@ -1458,6 +1458,15 @@ void P_PredictPlayer (player_t *player)
 	}
 	act->BlockNode = NULL;
 
+	// The same for the thing grid link.
+	if (act->gprev != NULL)
+	{
+		if ((*act->gprev = act->gnext))
+			act->gnext->gprev = act->gprev;
+		act->gnext = NULL;
+		act->gprev = NULL;
+	}
+
 	// Values too small to be usable for lerping can be considered "off".
 	bool CanLerp = (!(cl_predict_lerpscale < 0.01f)), DoLerp = false, NoInterpolateOld = R_GetViewInterpolationStatus();
 	for (int i = gametic; i < maxtic; ++i)
@@ -1599,6 +1608,14 @@ void P_UnPredictPlayer ()
 			}
 			block = block->NextBlock;
 		}
+		if (act->gprev != NULL)
+		{
+			*act->gprev = act;
+			if (act->gnext != NULL)
+			{
+				act->gnext->gprev = &act->gnext;
+			}
+		}
 
 		actInvSel = InvSel;
 		player->inventorytics = inventorytics;
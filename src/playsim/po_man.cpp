@@ -1057,6 +1057,98 @@ bool FPolyObj::CheckMobjBlocking (side_t *sd)
 	right = right < 0 ? 0 : right;
 	right = right >= bmapwidth ?  bmapwidth-1 : right;
 
+	// Checks one actor. The block chain loop below must not change, because
+	// ThrustMobj can relink the actor while its block node is being used.
+	auto check = [&](AActor *mobj)
+	{
+		if ((mobj->flags&MF_SOLID) && !(mobj->flags&MF_NOCLIP))
+		{
+			FLineOpening open;
+			open.top = LINEOPEN_MAX;
+			open.bottom = LINEOPEN_MIN;
+			// [TN] Check wether this actor gets blocked by the line.
+			if (ld->backsector != nullptr &&
+				!(ld->flags & (ML_BLOCKING|ML_BLOCKEVERYTHING))
+				&& !(ld->flags & ML_BLOCK_PLAYERS && (mobj->player || (mobj->flags8 & MF8_BLOCKASPLAYER))) 
+				&& !(ld->flags & ML_BLOCKMONSTERS && mobj->flags3 & MF3_ISMONSTER)
+				&& !((mobj->flags & MF_FLOAT) && (ld->flags & ML_BLOCK_FLOATERS))
+				&& (!(ld->flags & ML_3DMIDTEX) ||
+					(!P_LineOpening_3dMidtex(mobj, ld, open) &&
+						(mobj->Top() < open.top)
+					) || (open.abovemidtex && mobj->Z() > mobj->floorz))
+				)
+			{
+				// [BL] We can't just continue here since we must
+				// determine if the line's backsector is going to
+				// be blocked.
+				performBlockingThrust = false;
+			}
+			else
+			{
+				performBlockingThrust = true;
+			}
+
+			DVector2 pos = mobj->PosRelative(ld);
+			FBoundingBox box(pos.X, pos.Y, mobj->radius);
+
+			if (!inRange(box, ld) || BoxOnLineSide(box, ld) != -1)
+			{
+				return;
+			}
+
+			if (ld->isLinePortal())
+			{
+				// Fixme: this still needs to figure out if the polyobject move made the player cross the portal line.
+				if (P_TryMove(mobj, mobj->Pos(), false))
+				{
+					return;
+				}
+			}
+			// We have a two-sided linedef so we should only check one side
+			// so that the thrust from both sides doesn't cancel each other out.
+			// Best use the one facing the player and ignore the back side.
+			if (ld->sidedef[1] != nullptr)
+			{
+				int side = P_PointOnLineSidePrecise(mobj->Pos(), ld);
+				if (ld->sidedef[side] != sd)
+				{
+					return;
+				}
+				// [BL] See if we hit below the floor/ceiling of the poly.
+				else if(!performBlockingThrust && (
+						mobj->Z() < ld->sidedef[!side]->sector->GetSecPlane(sector_t::floor).ZatPoint(mobj) ||
+						mobj->Top() > ld->sidedef[!side]->sector->GetSecPlane(sector_t::ceiling).ZatPoint(mobj)
+					))
+				{
+					performBlockingThrust = true;
+				}
+			}
+
+			if(performBlockingThrust)
+			{
+				ThrustMobj (mobj, sd);
+				blocked = true;
+			}
+			else
+				return;
+		}
+	};
+
+	if (Level->blockmap.thinggrid.ReplacesChains)
+	{
+		FBlockThingsIterator it(Level, left, bottom, right, top);
+		while ((mobj = it.Next()))
+		{
+			// A thrust can move an actor into a cell that was not reached yet.
+			if (checker.Find(mobj) == checker.Size())
+			{
+				checker.Push (mobj);
+				check(mobj);
+			}
+		}
+		return blocked;
+	}
+
 	for (j = bottom*bmapwidth; j <= top*bmapwidth; j += bmapwidth)
 	{
 		for (i = left; i <= right; i++)
@@ -1074,77 +1166,7 @@ bool FPolyObj::CheckMobjBlocking (side_t *sd)
 				if (k < 0)
 				{
 					checker.Push (mobj);
-					if ((mobj->flags&MF_SOLID) && !(mobj->flags&MF_NOCLIP))
-					{
-						FLineOpening open;
-						open.top = LINEOPEN_MAX;
-						open.bottom = LINEOPEN_MIN;
-						// [TN] Check wether this actor gets blocked by the line.
-						if (ld->backsector != nullptr &&
-							!(ld->flags & (ML_BLOCKING|ML_BLOCKEVERYTHING))
-							&& !(ld->flags & ML_BLOCK_PLAYERS && (mobj->player || (mobj->flags8 & MF8_BLOCKASPLAYER))) 
-							&& !(ld->flags & ML_BLOCKMONSTERS && mobj->flags3 & MF3_ISMONSTER)
-							&& !((mobj->flags & MF_FLOAT) && (ld->flags & ML_BLOCK_FLOATERS))
-							&& (!(ld->flags & ML_3DMIDTEX) ||
-								(!P_LineOpening_3dMidtex(mobj, ld, open) &&
-									(mobj->Top() < open.top)
-								) || (open.abovemidtex && mobj->Z() > mobj->floorz))
-							)
-						{
-							// [BL] We can't just continue here since we must
-							// determine if the line's backsector is going to
-							// be blocked.
-							performBlockingThrust = false;
-						}
-						else
-						{
-							performBlockingThrust = true;
-						}
-
-						DVector2 pos = mobj->PosRelative(ld);
-						FBoundingBox box(pos.X, pos.Y, mobj->radius);
-
-						if (!inRange(box, ld) || BoxOnLineSide(box, ld) != -1)
-						{
-							continue;
-						}
-
-						if (ld->isLinePortal())
-						{
-							// Fixme: this still needs to figure out if the polyobject move made the player cross the portal line.
-							if (P_TryMove(mobj, mobj->Pos(), false))
-							{
-								continue;
-							}
-						}
-						// We have a two-sided linedef so we should only check one side
-						// so that the thrust from both sides doesn't cancel each other out.
-						// Best use the one facing the player and ignore the back side.
-						if (ld->sidedef[1] != nullptr)
-						{
-							int side = P_PointOnLineSidePrecise(mobj->Pos(), ld);
-							if (ld->sidedef[side] != sd)
-							{
-								continue;
-							}
-							// [BL] See if we hit below the floor/ceiling of the poly.
-							else if(!performBlockingThrust && (
-									mobj->Z() < ld->sidedef[!side]->sector->GetSecPlane(sector_t::floor).ZatPoint(mobj) ||
-									mobj->Top() > ld->sidedef[!side]->sector->GetSecPlane(sector_t::ceiling).ZatPoint(mobj)
-								))
-							{
-								performBlockingThrust = true;
-							}
-						}
-
-						if(performBlockingThrust)
-						{
-							ThrustMobj (mobj, sd);
-							blocked = true;
-						}
-						else
-							continue;
-					}
+					check(mobj);
 				}
 			}
 		}
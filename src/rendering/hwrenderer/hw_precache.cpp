@@ -217,6 +217,35 @@ void hw_PrecacheTexture(uint8_t *texhitlist, TMap<PClassActor*, bool> &actorhitl
 	screen->StartPrecaching();
 	int cnt = TexMan.NumTextures();
 
+	// Start inflating the image lumps of everything that is about to be loaded, using the same checks as the precaching below.
+	if (gl_precache)
+	{
+		TArray<int> imagelumps;
+		for (int i = 1; i < cnt; i++)
+		{
+			auto gtex = TexMan.GameByIndex(i);
+			auto tex = gtex != nullptr ? gtex->GetTexture() : nullptr;
+			if (tex == nullptr || tex->GetImage() == nullptr) continue;
+
+			bool load = false;
+			if (texhitlist[i] & (FTextureManager::HIT_Wall | FTextureManager::HIT_Flat | FTextureManager::HIT_Sky))
+			{
+				// Skip textures that are still uploaded from the last level.
+				int flags = shouldUpscale(gtex, UF_Texture);
+				load = tex->GetHardwareTexture(0, flags) == nullptr;
+			}
+			if (spritehitlist[i] != nullptr && (*spritehitlist[i]).CheckKey(0))
+			{
+				int flags = CTF_Expand;
+				if (shouldUpscale(gtex, UF_Sprite)) flags |= CTF_Upscale;
+				load |= tex->GetHardwareTexture(0, flags) == nullptr;
+			}
+			int lump = load ? gtex->GetSourceLump() : -1;
+			if (lump >= 0) imagelumps.Push(lump);
+		}
+		fileSystem.PrefetchFiles(imagelumps);
+	}
+
 	// prepare the textures for precaching. First mark all used layer textures so that we know which ones should not be deleted.
 	for (int i = cnt - 1; i >= 0; i--)
 	{
@@ -299,6 +328,8 @@ void hw_PrecacheTexture(uint8_t *texhitlist, TMap<PClassActor*, bool> &actorhitl
 			}
 		}
 
+		FImageSource::DecodeForPrecache();
+
 		// cache all used textures
 		for (int i = cnt - 1; i >= 0; i--)
 		{
@@ -316,6 +347,9 @@ void hw_PrecacheTexture(uint8_t *texhitlist, TMap<PClassActor*, bool> &actorhitl
 
 		FImageSource::EndPrecaching();
 
+		// Don't keep whatever was prefetched but not needed after all.
+		fileSystem.ClearPrefetched();
+
 		// cache all used models
 		FModelRenderer* renderer = new FHWModelRenderer(nullptr, *screen->RenderState(), -1);
 		for (unsigned i = 0; i < Models.Size(); i++)
@@ -176,6 +176,7 @@ void FSoftwareRenderer::Precache(uint8_t *texhitlist, TMap<PClassActor*, bool> &
 	{
 		PreparePrecache(TexMan.GameByIndex(i), texhitlist[i]);
 	}
+	FImageSource::DecodeForPrecache();
 
 	for (int i = cnt - 1; i >= 0; i--)
 	{
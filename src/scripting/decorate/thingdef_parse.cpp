@@ -48,6 +48,7 @@
 #include "filesystem.h"
 #include "v_text.h"
 #include "m_argv.h"
+#include "vmcodecache.h"
 #include "v_video.h"
 #ifndef _MSC_VER
 #include "i_system.h"  // for strlwr()
@@ -1259,6 +1260,8 @@ static void ParseDamageDefinition(FScanner &sc)
 
 void ParseDecorate (FScanner &sc, PNamespace *ns)
 {
+	VMCodeCache.AddSource(sc.LumpNum);
+
 	// Get actor class name.
 	for(;;)
 	{
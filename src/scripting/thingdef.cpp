@@ -55,6 +55,7 @@
 #include "thingdef.h"
 #include "zcc_parser.h"
 #include "zcc_compile_doom.h"
+#include "vmcodecache.h"
 
 // EXTERNAL FUNCTION PROTOTYPES --------------------------------------------
 void InitThingdef();
@@ -454,6 +455,15 @@ void LoadActors()
 	ParseAllDecorate();
 	SynthesizeFlagFields();
 
+	// State pointers in generated code get cached relative to their owning class.
+	for (auto cls : PClass::AllClasses)
+	{
+		if (cls->IsDescendantOf(RUNTIME_CLASS(AActor)) && cls->Size != TentativeClass && GetDefaultByType(cls) != nullptr)
+		{
+			auto info = static_cast<PClassActor *>(cls)->ActorInfo();
+			VMCodeCache.AddAddressRange(cls->TypeName.GetChars(), info->OwnedStates, info->NumOwnedStates * sizeof(FState));
+		}
+	}
 	FunctionBuildList.Build();
 
 	if (FScriptPosition::ErrorCounter > 0)